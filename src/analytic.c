@@ -0,0 +1,135 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <string.h>
+#include <math.h>
+#include <liquid/liquid.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "analytic.h"
+
+void analytic_init(analytic_t *analytic) {
+    const uint16_t  len = ANALYTIC_HIST + 1;
+    const float     beta = kaiser_beta_As(60.0f);
+
+    /* Hilbert response 2 / (pi * n) for odd n. Tap k is at n = 2 * k + 1 - 2 * ANALYTIC_M */
+
+    for (uint8_t k = 0; k < ANALYTIC_TAPS; k++) {
+        int16_t n = 2 * k + 1 - 2 * ANALYTIC_M;
+
+        analytic->coef[k] = 2.0f / (M_PI * n) * liquid_kaiser(n + 2 * ANALYTIC_M, len, beta);
+    }
+
+    analytic_reset(analytic);
+}
+
+void analytic_reset(analytic_t *analytic) {
+    memset(analytic->buf, 0, sizeof(analytic->buf));
+}
+
+#ifdef __ARM_NEON
+
+void analytic_s16_to_float(const int16_t *in, float *out, size_t n) {
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t   x = vld1q_s16(&in[i]);
+
+        vst1q_f32(&out[i], vcvtq_n_f32_s32(vmovl_s16(vget_low_s16(x)), 15));
+        vst1q_f32(&out[i + 4], vcvtq_n_f32_s32(vmovl_s16(vget_high_s16(x)), 15));
+    }
+
+    for (; i < n; i++)
+        out[i] = in[i] / 32768.0f;
+}
+
+/* Four outputs at once. y(i) = x(i - 2M) + j * sum coef(k) * x(i - 1 - 2k) */
+
+static void filter_block(const float *coef, const float *x, float complex *out, size_t n) {
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const float     *p = &x[i + ANALYTIC_HIST];
+        float32x4x2_t   y;
+
+        y.val[0] = vld1q_f32(p - 2 * ANALYTIC_M);
+        y.val[1] = vdupq_n_f32(0.0f);
+
+        for (uint8_t k = 0; k < ANALYTIC_TAPS; k++)
+            y.val[1] = vmlaq_n_f32(y.val[1], vld1q_f32(p - 1 - 2 * k), coef[k]);
+
+        vst2q_f32((float *) &out[i], y);
+    }
+
+    for (; i < n; i++) {
+        const float *p = &x[i + ANALYTIC_HIST];
+        float       im = 0.0f;
+
+        for (uint8_t k = 0; k < ANALYTIC_TAPS; k++)
+            im += coef[k] * p[-1 - 2 * k];
+
+        out[i] = p[-2 * ANALYTIC_M] + im * I;
+    }
+}
+
+#else
+
+void analytic_s16_to_float(const int16_t *in, float *out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = in[i] / 32768.0f;
+}
+
+static void filter_block(const float *coef, const float *x, float complex *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const float *p = &x[i + ANALYTIC_HIST];
+        float       im = 0.0f;
+
+        for (uint8_t k = 0; k < ANALYTIC_TAPS; k++)
+            im += coef[k] * p[-1 - 2 * k];
+
+        out[i] = p[-2 * ANALYTIC_M] + im * I;
+    }
+}
+
+#endif
+
+/* Input is already in buf after the history */
+
+static void execute_block(analytic_t *analytic, size_t n, float complex *out) {
+    filter_block(analytic->coef, analytic->buf, out, n);
+    memmove(analytic->buf, &analytic->buf[n], ANALYTIC_HIST * sizeof(float));
+}
+
+void analytic_execute(analytic_t *analytic, const float *in, size_t n, float complex *out) {
+    while (n) {
+        size_t part = n < ANALYTIC_BLOCK ? n : ANALYTIC_BLOCK;
+
+        memcpy(&analytic->buf[ANALYTIC_HIST], in, part * sizeof(float));
+        execute_block(analytic, part, out);
+
+        in += part;
+        out += part;
+        n -= part;
+    }
+}
+
+void analytic_execute_s16(analytic_t *analytic, const int16_t *in, size_t n, float complex *out) {
+    while (n) {
+        size_t part = n < ANALYTIC_BLOCK ? n : ANALYTIC_BLOCK;
+
+        analytic_s16_to_float(in, &analytic->buf[ANALYTIC_HIST], part);
+        execute_block(analytic, part, out);
+
+        in += part;
+        out += part;
+        n -= part;
+    }
+}
@@ -0,0 +1,37 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <complex.h>
+
+#define ANALYTIC_M      7                       /* As firhilbf_create(7, 60.0f) */
+#define ANALYTIC_TAPS   (ANALYTIC_M * 2)        /* Non-zero (odd) taps */
+#define ANALYTIC_HIST   (ANALYTIC_M * 4)
+#define ANALYTIC_BLOCK  1024
+
+/* Real to analytic signal by a Kaiser windowed Hilbert FIR, delay is 2 * ANALYTIC_M samples */
+
+typedef struct {
+    float   coef[ANALYTIC_TAPS];
+    float   buf[ANALYTIC_HIST + ANALYTIC_BLOCK];
+} analytic_t;
+
+void analytic_init(analytic_t *analytic);
+void analytic_reset(analytic_t *analytic);
+
+/* Any number of samples, out should hold n items */
+
+void analytic_execute(analytic_t *analytic, const float *in, size_t n, float complex *out);
+void analytic_execute_s16(analytic_t *analytic, const int16_t *in, size_t n, float complex *out);
+
+/* x / 32768 */
+
+void analytic_s16_to_float(const int16_t *in, float *out, size_t n);
@@ -22,6 +22,7 @@
 #include "params.h"
 
 #define AUDIO_RATE_MS   100
+#define PLAY_QUEUE      AUDIO_PLAY_RATE     /* 1 second */
 
 static pa_threaded_mainloop *mloop;
 static pa_mainloop_api      *mlapi;
@@ -30,6 +31,16 @@ static pa_context           *ctx;
 static pa_stream            *play_stm;
 static char                 *play_device = "alsa_output.platform-sound.stereo-fallback";
 
+/* Playback queue, guarded by the mainloop lock and drained by play_callback() */
+
+static int16_t              play_queue[PLAY_QUEUE];
+static size_t               play_head = 0;
+static size_t               play_size = 0;
+static audio_play_cb_t      play_done_cb = NULL;
+static void                 *play_done_user = NULL;
+static bool                 play_drained = true;
+static bool                 play_draining = false;
+
 static pa_stream            *capture_stm;
 static char                 *capture_device = "alsa_input.platform-sound.stereo-fallback";
 
@@ -45,6 +56,86 @@ static void read_callback(pa_stream *s, size_t nbytes, void *udata) {
     pa_stream_drop(capture_stm);
 }
 
+static void drain_callback(pa_stream *s, int success, void *udata) {
+    play_draining = false;
+
+    if (play_size > 0) {
+        pa_threaded_mainloop_signal(mloop, 0);
+        return;
+    }
+
+    audio_play_cb_t cb = play_done_cb;
+    void            *user = play_done_user;
+
+    play_done_cb = NULL;
+    play_drained = true;
+    pa_threaded_mainloop_signal(mloop, 0);
+
+    if (cb) {
+        cb(user);
+    }
+}
+
+/* Write up to nbytes from the queue, mainloop lock is held */
+
+static void play_fill(size_t nbytes) {
+    if (pa_stream_get_state(play_stm) != PA_STREAM_READY) {
+        pa_threaded_mainloop_signal(mloop, 0);
+        return;
+    }
+
+    while (play_size > 0 && nbytes >= 2) {
+        size_t n = PLAY_QUEUE - play_head;
+
+        if (n > play_size) {
+            n = play_size;
+        }
+
+        if (n > nbytes / 2) {
+            n = nbytes / 2;
+        }
+
+        if (pa_stream_write(play_stm, &play_queue[play_head], n * 2, NULL, 0, PA_SEEK_RELATIVE) < 0) {
+            LV_LOG_ERROR("pa_stream_write() failed: %s", pa_strerror(pa_context_errno(ctx)));
+            break;
+        }
+
+        play_head = (play_head + n) % PLAY_QUEUE;
+        play_size -= n;
+        nbytes -= n * 2;
+    }
+
+    if (play_size == 0 && !play_drained && !play_draining) {
+        pa_operation *op = pa_stream_drain(play_stm, drain_callback, NULL);
+
+        if (op) {
+            play_draining = true;
+            pa_operation_unref(op);
+        }
+    }
+
+    pa_threaded_mainloop_signal(mloop, 0);
+}
+
+static void play_callback(pa_stream *s, size_t nbytes, void *udata) {
+    play_fill(nbytes);
+}
+
+/*
+ * Players are stopped with pthread_cancel(). A thread cancelled while holding
+ * the mainloop lock would leave it locked, so cancellation waits for the unlock
+ */
+
+static void play_lock(int *cancel) {
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, cancel);
+    pa_threaded_mainloop_lock(mloop);
+}
+
+static void play_unlock(int cancel) {
+    pa_threaded_mainloop_unlock(mloop);
+    pthread_setcancelstate(cancel, NULL);
+}
+
 void audio_init() {
     mloop = pa_threaded_mainloop_new();
     pa_threaded_mainloop_start(mloop);
@@ -81,7 +172,9 @@ void audio_init() {
     play_stm = pa_stream_new(ctx, "X6100 GUI Play", &spec, NULL);
 
     pa_threaded_mainloop_lock(mloop);
-    pa_stream_connect_playback(play_stm, play_device, &attr, PA_STREAM_ADJUST_LATENCY, NULL, NULL);
+    pa_stream_set_write_callback(play_stm, play_callback, NULL);
+    pa_stream_connect_playback(play_stm, play_device, &attr,
+        PA_STREAM_ADJUST_LATENCY | PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE, NULL, NULL);
     pa_threaded_mainloop_unlock(mloop);
     
     /* Capture */
@@ -97,73 +190,126 @@ void audio_init() {
     pa_threaded_mainloop_unlock(mloop);
 }
 
+size_t audio_play_queue(const int16_t *samples_buf, size_t samples) {
+    int cancel;
+
+    play_lock(&cancel);
+
+    size_t n = PLAY_QUEUE - play_size;
+
+    if (n > samples) {
+        n = samples;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        play_queue[(play_head + play_size + i) % PLAY_QUEUE] = samples_buf[i];
+
+    play_size += n;
+
+    if (n > 0) {
+        play_drained = false;
+        play_fill(pa_stream_writable_size(play_stm));
+    }
+
+    play_unlock(cancel);
+
+    return n;
+}
+
 int audio_play(int16_t *samples_buf, size_t samples) {
+    int cancel;
+
     while (true) {
-        size_t size;
-    
-        pa_threaded_mainloop_lock(mloop);
-        size = pa_stream_writable_size(play_stm);
-        pa_threaded_mainloop_unlock(mloop);
-        
-        if (size >= (samples * 2)) {
+        size_t n = audio_play_queue(samples_buf, samples);
+
+        samples_buf += n;
+        samples -= n;
+
+        if (samples == 0) {
+            break;
+        }
+
+        play_lock(&cancel);
+
+        bool ready = pa_stream_get_state(play_stm) == PA_STREAM_READY;
+
+        while (ready && play_size == PLAY_QUEUE) {
+            pa_threaded_mainloop_wait(mloop);
+            ready = pa_stream_get_state(play_stm) == PA_STREAM_READY;
+        }
+
+        play_unlock(cancel);
+
+        if (!ready) {
             break;
         }
-        
-        usleep(1000);
     }
 
-    pa_threaded_mainloop_lock(mloop);
-    int res = pa_stream_write(play_stm, samples_buf, samples * 2, NULL, 0, PA_SEEK_RELATIVE);
-    pa_threaded_mainloop_unlock(mloop);
-    
-    if (res < 0) {
-        LV_LOG_ERROR("pa_stream_write() failed: %s", pa_strerror(pa_context_errno(ctx)));
+    return 0;
+}
+
+void audio_play_done(audio_play_cb_t cb, void *user) {
+    int cancel;
+
+    play_lock(&cancel);
+
+    if (play_drained || pa_stream_get_state(play_stm) != PA_STREAM_READY) {
+        play_unlock(cancel);
+        cb(user);
+        return;
     }
-    
-    return res;
+
+    play_done_cb = cb;
+    play_done_user = user;
+    play_fill(0);
+    play_unlock(cancel);
 }
 
 void audio_play_wait() {
-    pa_operation *op;
-    int r;
+    int cancel;
 
-    pa_threaded_mainloop_lock(mloop);
-    op = pa_stream_drain(play_stm, NULL, NULL);
-    pa_threaded_mainloop_unlock(mloop);
+    play_lock(&cancel);
+    play_fill(0);
 
-    while (true) {
-        pa_threaded_mainloop_lock(mloop);
-        r = pa_operation_get_state(op);
-        pa_threaded_mainloop_unlock(mloop);
-      
-        if (r == PA_OPERATION_DONE || r == PA_OPERATION_CANCELLED) {
-            break;
-        }
+    while (!play_drained && pa_stream_get_state(play_stm) == PA_STREAM_READY) {
+        pa_threaded_mainloop_wait(mloop);
+    }
+
+    play_unlock(cancel);
+}
 
-        usleep(1000);
+void audio_play_flush() {
+    int cancel;
+
+    play_lock(&cancel);
+
+    play_size = 0;
+
+    pa_operation *op = pa_stream_flush(play_stm, NULL, NULL);
+
+    if (op) {
+        pa_operation_unref(op);
     }
 
-    pa_operation_unref(op);
+    play_fill(0);
+    play_unlock(cancel);
 }
 
-int16_t* audio_gain(int16_t *buf, size_t samples, uint16_t gain) {
-    int16_t *out_samples = malloc(samples * sizeof(int16_t));
+uint32_t audio_play_latency() {
+    pa_usec_t   usec = 0;
+    int         neg = 0;
+    int         cancel;
 
-    for (uint16_t i = 0; i < samples; i++) {
-        int32_t x = buf[i] * gain / 100;
-        
-        if (x > 32767) {
-            x = 32767;
-        }
-        
-        if (x < -32767) {
-            x = -32767;
-        }
-    
-        out_samples[i] = x;
+    play_lock(&cancel);
+
+    if (pa_stream_get_latency(play_stm, &usec, &neg) < 0 || neg) {
+        usec = 0;
     }
-    
-    return out_samples;
+
+    usec += (pa_usec_t) play_size * PA_USEC_PER_SEC / AUDIO_PLAY_RATE;
+    play_unlock(cancel);
+
+    return usec / PA_USEC_PER_MSEC;
 }
 
 void audio_play_en(bool on) {
@@ -10,13 +10,40 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #define AUDIO_PLAY_RATE     (44100)
 #define AUDIO_CAPTURE_RATE  (44100)
 
+typedef void (*audio_play_cb_t)(void *user);
+
 void audio_init();
+
+/* Copy as many samples as fit into the playback queue, return their count. Never blocks */
+
+size_t audio_play_queue(const int16_t *buf, size_t samples);
+
+/* Queue all samples, waiting for free space */
+
 int audio_play(int16_t *buf, size_t samples);
+
+/* Call cb once everything queued has been played: at once when idle, else from the audio thread (no audio_play_* there) */
+
+void audio_play_done(audio_play_cb_t cb, void *user);
 void audio_play_wait();
+void audio_play_flush();
+
+/* Queued and device latency, ms */
+
+uint32_t audio_play_latency();
 void audio_play_en(bool on);
 
-int16_t* audio_gain(int16_t *buf, size_t samples, uint16_t gain);
+/* Saturating gain stage, 1.0 is unity, up to 127. In and out may be the same buffer */
+
+void audio_gain(const int16_t *in, int16_t *out, size_t samples, float gain);
+void audio_fade(const int16_t *in, int16_t *out, size_t samples, float gain_from, float gain_to);
+
+/* out += in * gain */
+
+void audio_mix(int16_t *out, const int16_t *in, size_t samples, float gain);
+int16_t audio_peak(const int16_t *buf, size_t samples);
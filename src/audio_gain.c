@@ -0,0 +1,153 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "audio.h"
+
+/* Gains are Q8 fixed point, fades step a Q16 accumulator. NEON and scalar results are bit exact */
+
+#define GAIN_MAX    (32767.0f / 256.0f)
+
+static int32_t gain_q16(float gain) {
+    if (gain < 0.0f) {
+        gain = 0.0f;
+    } else if (gain > GAIN_MAX) {
+        gain = GAIN_MAX;
+    }
+
+    return gain * 65536.0f;
+}
+
+static inline int16_t scale(int16_t x, int16_t q8) {
+    int32_t y = (x * q8 + 128) >> 8;
+
+    if (y > 32767) {
+        y = 32767;
+    } else if (y < -32768) {
+        y = -32768;
+    }
+
+    return y;
+}
+
+static inline int16_t add(int16_t a, int16_t b) {
+    int32_t y = a + b;
+
+    if (y > 32767) {
+        y = 32767;
+    } else if (y < -32768) {
+        y = -32768;
+    }
+
+    return y;
+}
+
+void audio_gain(const int16_t *in, int16_t *out, size_t samples, float gain) {
+    int16_t q8 = gain_q16(gain) >> 8;
+    size_t  i = 0;
+
+#ifdef __ARM_NEON
+    int16x4_t g = vdup_n_s16(q8);
+
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t   x = vld1q_s16(&in[i]);
+        int32x4_t   lo = vmull_s16(vget_low_s16(x), g);
+        int32x4_t   hi = vmull_s16(vget_high_s16(x), g);
+
+        vst1q_s16(&out[i], vcombine_s16(vqrshrn_n_s32(lo, 8), vqrshrn_n_s32(hi, 8)));
+    }
+#endif
+
+    for (; i < samples; i++)
+        out[i] = scale(in[i], q8);
+}
+
+void audio_fade(const int16_t *in, int16_t *out, size_t samples, float gain_from, float gain_to) {
+    if (samples == 0) {
+        return;
+    }
+
+    int32_t acc = gain_q16(gain_from);
+    int32_t step = (gain_q16(gain_to) - acc) / (int32_t) samples;
+    size_t  i = 0;
+
+#ifdef __ARM_NEON
+    static const int32_t    lanes[4] = { 0, 1, 2, 3 };
+    int32x4_t               lane_step = vmulq_n_s32(vld1q_s32(lanes), step);
+
+    for (; i + 8 <= samples; i += 8) {
+        int32x4_t   acc_lo = vaddq_s32(vdupq_n_s32(acc), lane_step);
+        int32x4_t   acc_hi = vaddq_s32(vdupq_n_s32(acc + step * 4), lane_step);
+        int16x8_t   x = vld1q_s16(&in[i]);
+        int32x4_t   lo = vmull_s16(vget_low_s16(x), vshrn_n_s32(acc_lo, 8));
+        int32x4_t   hi = vmull_s16(vget_high_s16(x), vshrn_n_s32(acc_hi, 8));
+
+        vst1q_s16(&out[i], vcombine_s16(vqrshrn_n_s32(lo, 8), vqrshrn_n_s32(hi, 8)));
+        acc += step * 8;
+    }
+#endif
+
+    for (; i < samples; i++) {
+        out[i] = scale(in[i], acc >> 8);
+        acc += step;
+    }
+}
+
+void audio_mix(int16_t *out, const int16_t *in, size_t samples, float gain) {
+    int16_t q8 = gain_q16(gain) >> 8;
+    size_t  i = 0;
+
+#ifdef __ARM_NEON
+    int16x4_t g = vdup_n_s16(q8);
+
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t   x = vld1q_s16(&in[i]);
+        int32x4_t   lo = vmull_s16(vget_low_s16(x), g);
+        int32x4_t   hi = vmull_s16(vget_high_s16(x), g);
+        int16x8_t   y = vcombine_s16(vqrshrn_n_s32(lo, 8), vqrshrn_n_s32(hi, 8));
+
+        vst1q_s16(&out[i], vqaddq_s16(vld1q_s16(&out[i]), y));
+    }
+#endif
+
+    for (; i < samples; i++)
+        out[i] = add(out[i], scale(in[i], q8));
+}
+
+int16_t audio_peak(const int16_t *buf, size_t samples) {
+    int16_t peak = 0;
+    size_t  i = 0;
+
+#ifdef __ARM_NEON
+    int16x8_t max = vdupq_n_s16(0);
+
+    for (; i + 8 <= samples; i += 8)
+        max = vmaxq_s16(max, vqabsq_s16(vld1q_s16(&buf[i])));
+
+    int16x4_t m = vmax_s16(vget_low_s16(max), vget_high_s16(max));
+
+    m = vpmax_s16(m, m);
+    m = vpmax_s16(m, m);
+    peak = vget_lane_s16(m, 0);
+#endif
+
+    for (; i < samples; i++) {
+        int16_t x = buf[i] == -32768 ? 32767 : abs(buf[i]);
+
+        if (x > peak) {
+            peak = x;
+        }
+    }
+
+    return peak;
+}
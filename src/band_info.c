@@ -14,9 +14,11 @@
 
 static lv_obj_t         *obj;
 
+#define BANDS_VISIBLE   8
+
 static lv_coord_t       band_info_height = 24;
 static int32_t          width_hz = 100000;
-static band_t           *bands = NULL;
+static const band_t     *bands[BANDS_VISIBLE];
 static uint16_t         bands_count = 0;
 static uint64_t         freq;
 static lv_anim_t        fade;
@@ -35,7 +37,7 @@ static void band_info_draw_cb(lv_event_t * e) {
     lv_obj_t            *obj = lv_event_get_target(e);
     lv_draw_ctx_t       *draw_ctx = lv_event_get_draw_ctx(e);
     
-    if (!bands) {
+    if (!bands_count) {
         return;
     }
 
@@ -46,7 +48,7 @@ static void band_info_draw_cb(lv_event_t * e) {
     lv_coord_t h = lv_obj_get_height(obj) - 1;
 
     for (uint16_t i = 0; i < bands_count; i++) {
-        band_t *band = &bands[i];
+        const band_t *band = bands[i];
 
         /* Rect */
 
@@ -139,14 +141,7 @@ lv_obj_t * band_info_init(lv_obj_t *parent) {
 }
 
 void band_info_update(uint64_t f) {
-    if (bands != NULL) {
-        for (uint16_t i = 0; i < bands_count; i++)
-            free(bands[i].name);
-
-        free(bands);
-    }
-
-    bands = params_bands_find_all(f, width_hz / 2, &bands_count);
+    bands_count = params_bands_find_all(f, width_hz / 2, bands, BANDS_VISIBLE);
     freq = f;
 
     if (backlight_is_on()) {
@@ -0,0 +1,176 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  CW tone tracker: Hann window leakage at every hop position, and timing
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "cw.h"
+#include "cw_decoder.h"
+#include "cw_skimmer.h"
+#include "morse.h"
+#include "pannel.h"
+#include "params.h"
+#include "audio.h"
+
+#define WINDOW          512
+#define HOP             128
+#define LEAKAGE_BINS    7
+#define LEAKAGE_MAX_DB  -40.0f  /* Hann sidelobes are below -60 dB that far, no window gives about -27 dB */
+
+/* Stubs for the parts of the GUI used by cw.c */
+
+params_t                params;
+params_mode_t           params_mode;
+
+void params_lock() {
+}
+
+void params_unlock(bool *durty) {
+}
+
+void params_bool_set(params_bool_t *var, bool x) {
+    var->x = x;
+}
+
+void pannel_add_text(const char * text) {
+}
+
+void pannel_visible() {
+}
+
+void morse_init() {
+}
+
+void cw_decoder_init(cw_decoder_t *decoder, cw_decoder_text_cb_t text_cb, void *user) {
+}
+
+void cw_decoder_signal(cw_decoder_t *decoder, bool on, float ms) {
+}
+
+void cw_skimmer_init(float bin_hz) {
+}
+
+void cw_skimmer_reset() {
+}
+
+void cw_skimmer_process(const float *bin_db, uint16_t bin_start, uint16_t bin_stop, float noise_db, float ms) {
+}
+
+/* * */
+
+static uint64_t get_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static float complex tone(float freq, uint32_t n) {
+    return cexpf(I * 2.0f * M_PI * freq * n / AUDIO_CAPTURE_RATE);
+}
+
+/*
+ * A tone between bins, started at an arbitrary sample. Every hop after the window is full
+ * is checked, so the window start goes through all positions modulo WINDOW
+ */
+
+static uint32_t check_leakage(float bin, uint32_t offset) {
+    float           freq = bin * AUDIO_CAPTURE_RATE / WINDOW;
+    float complex   x[HOP];
+    uint32_t        n = 0;
+    uint32_t        errors = 0;
+    uint16_t        start, stop;
+
+    /* Arbitrary start: silence first */
+
+    for (uint32_t i = 0; i < offset; i++) {
+        x[0] = 0;
+        cw_put_audio_samples(1, x);
+    }
+
+    for (uint8_t hop = 0; hop < WINDOW / HOP * 3; hop++) {
+        for (uint16_t i = 0; i < HOP; i++)
+            x[i] = tone(freq, n++);
+
+        cw_put_audio_samples(HOP, x);
+
+        if (n < WINDOW + HOP) {
+            continue;
+        }
+
+        const float *db = cw_get_bins(&start, &stop);
+        uint16_t    k = lrintf(bin);
+        float       leakage = fmaxf(db[k - LEAKAGE_BINS], db[k + LEAKAGE_BINS]) - db[k];
+
+        if (leakage > LEAKAGE_MAX_DB) {
+            printf("bin %.2f, offset %u, hop %u: leakage %.1f dB\n", bin, offset, hop, leakage);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+static void bench(uint32_t seconds) {
+    float complex   *x = malloc(AUDIO_CAPTURE_RATE * sizeof(float complex));
+
+    for (uint32_t i = 0; i < AUDIO_CAPTURE_RATE; i++)
+        x[i] = tone(700.0f, i) + 0.1f * (randnf() + randnf() * I);
+
+    uint64_t start = get_ns();
+
+    for (uint32_t i = 0; i < seconds; i++)
+        cw_put_audio_samples(AUDIO_CAPTURE_RATE, x);
+
+    double ns = (double) (get_ns() - start) / seconds;
+
+    printf("tracker     %.3f ms per second of audio, %.3f %% of one core\n", ns * 1e-6, ns * 1e-7);
+
+    free(x);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t    seconds = 10;
+    uint32_t    errors = 0;
+    uint32_t    checks = 0;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n':
+                seconds = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n seconds]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    params_mode.filter_low = 100;
+    params_mode.filter_high = 3000;
+
+    cw_init();
+
+    for (float bin = 15.0f; bin < 25.0f; bin += 0.37f) {
+        errors += check_leakage(bin, rand() % WINDOW);
+        checks++;
+    }
+
+    printf("leakage     %u tones, %u errors\n", checks, errors);
+
+    bench(seconds);
+
+    return errors ? 1 : 0;
+}
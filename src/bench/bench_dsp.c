@@ -0,0 +1,489 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Offline IQ replay and benchmark for dsp_samples()
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "dsp.h"
+#include "psd.h"
+#include "radio.h"
+#include "params.h"
+#include "meter.h"
+#include "rtty.h"
+#include "cw.h"
+#include "dialog.h"
+#include "dialog_msg_voice.h"
+#include "recorder.h"
+#include "audio.h"
+#include "iq_recorder.h"
+#include "analytic.h"
+
+#define SAMPLE_RATE     100000
+#define SYNTH_BLOCKS    (SAMPLE_RATE / RADIO_SAMPLES)
+#define AUDIO_CALLBACK  (AUDIO_CAPTURE_RATE / 10)
+#define ANALYTIC_MAX_ERR 1e-5f      /* Float rounding, against a 0.3 amplitude tone */
+
+typedef enum {
+    FORMAT_CF32 = 0,
+    FORMAT_CS16,
+    FORMAT_IQ
+} format_t;
+
+/* Stubs for the parts of the GUI used by dsp.c */
+
+params_mode_t           params_mode = { .spectrum_factor = 1 };
+params_t                params;
+params_band_t           params_band;
+char                    *recorder_path = ".";
+
+float                   spectrum_auto_min;
+float                   spectrum_auto_max;
+float                   waterfall_auto_min;
+float                   waterfall_auto_max;
+
+static uint32_t         spectrum_count = 0;
+static uint32_t         waterfall_count = 0;
+static uint32_t         meter_count = 0;
+
+static FILE             *spectrum_file = NULL;
+static FILE             *waterfall_file = NULL;
+
+static uint64_t         virtual_usec = 0;
+static bool             real_clock = false;
+
+static x6100_mode_t     mode = x6100_mode_usb;
+static bool             dialog_audio = false;
+static uint32_t         audio_consumers = 0;
+static float            audio_sum = 0.0f;
+
+uint64_t __real_get_time();
+
+uint64_t __wrap_get_time() {
+    if (real_clock) {
+        return __real_get_time();
+    }
+
+    return virtual_usec / 1000;
+}
+
+void spectrum_data(const psd_traces_t *traces) {
+    spectrum_count++;
+
+    if (spectrum_file) {
+        fwrite(traces->main, sizeof(float), traces->nfft, spectrum_file);
+    }
+}
+
+void msg_set_text_fmt(const char * fmt, ...) {
+}
+
+void waterfall_data(float *data_buf, uint16_t size) {
+    waterfall_count++;
+
+    if (waterfall_file) {
+        fwrite(data_buf, sizeof(float), size, waterfall_file);
+    }
+}
+
+void meter_update(int16_t db, float beta) {
+    meter_count++;
+}
+
+void radio_filter_get(int32_t *from_freq, int32_t *to_freq) {
+    *from_freq = 50;
+    *to_freq = 2950;
+}
+
+x6100_mode_t radio_current_mode() {
+    return mode;
+}
+
+msg_voice_state_t dialog_msg_voice_get_state() {
+    return MSG_VOICE_OFF;
+}
+
+void dialog_msg_voice_put_audio_samples(size_t nsamples, int16_t *samples) {
+}
+
+bool recorder_is_on() {
+    return false;
+}
+
+void recorder_put_audio_samples(size_t nsamples, int16_t *samples) {
+}
+
+rtty_state_t rtty_get_state() {
+    return RTTY_OFF;
+}
+
+void rtty_put_audio_samples(unsigned int n, const float complex *samples) {
+}
+
+void cw_put_audio_samples(unsigned int n, const float complex *samples) {
+    audio_consumers++;
+    audio_sum += crealf(samples[n - 1]);
+}
+
+bool dialog_audio_enabled() {
+    return dialog_audio;
+}
+
+void dialog_audio_samples(unsigned int n, const float complex *samples) {
+    audio_consumers++;
+    audio_sum += cimagf(samples[n - 1]);
+}
+
+/* * */
+
+static uint64_t get_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* Recording of the IQ recorder, see iq_recorder.h */
+
+static float complex * load_iq(FILE *f, const char *filename, size_t *blocks) {
+    iq_header_t header;
+
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, IQ_MAGIC, 4) != 0 || header.block_samples != RADIO_SAMPLES ||
+        (header.format != IQ_FORMAT_CS16 && header.format != IQ_FORMAT_CF16))
+    {
+        fprintf(stderr, "%s: not an IQ recording\n", filename);
+        fclose(f);
+        return NULL;
+    }
+
+    if (header.rate != SAMPLE_RATE) {
+        fprintf(stderr, "%s: rate %u, timing assumes %u\n", filename, header.rate, SAMPLE_RATE);
+    }
+
+    printf("recording   %llu Hz, mode %u, %s\n", (unsigned long long) header.freq, header.mode,
+        header.format == IQ_FORMAT_CF16 ? "cf16" : "cs16");
+
+    iq_block_header_t   block;
+    uint16_t            data[RADIO_SAMPLES * 2];
+    float complex       *buf = NULL;
+
+    *blocks = 0;
+
+    while (fread(&block, sizeof(block), 1, f) == 1 && fread(data, sizeof(data), 1, f) == 1) {
+        buf = realloc(buf, (*blocks + 1) * RADIO_SAMPLES * sizeof(float complex));
+        iq_block_decode(&block, data, RADIO_SAMPLES, header.format, buf + *blocks * RADIO_SAMPLES);
+        (*blocks)++;
+    }
+
+    fclose(f);
+
+    if (*blocks == 0) {
+        fprintf(stderr, "%s: less than one block of samples\n", filename);
+    }
+
+    return buf;
+}
+
+static float complex * load_file(const char *filename, format_t format, size_t *blocks) {
+    FILE    *f = fopen(filename, "rb");
+
+    if (!f) {
+        perror(filename);
+        return NULL;
+    }
+
+    if (format == FORMAT_IQ) {
+        return load_iq(f, filename, blocks);
+    }
+
+    fseek(f, 0, SEEK_END);
+
+    long            size = ftell(f);
+    size_t          sample_size = (format == FORMAT_CF32) ? sizeof(float complex) : sizeof(int16_t) * 2;
+    size_t          samples = size / sample_size;
+
+    fseek(f, 0, SEEK_SET);
+
+    *blocks = samples / RADIO_SAMPLES;
+
+    if (*blocks == 0) {
+        fprintf(stderr, "%s: less than one block of samples\n", filename);
+        fclose(f);
+        return NULL;
+    }
+
+    samples = *blocks * RADIO_SAMPLES;
+
+    float complex   *buf = malloc(samples * sizeof(float complex));
+
+    if (format == FORMAT_CF32) {
+        if (fread(buf, sizeof(float complex), samples, f) != samples) {
+            perror(filename);
+        }
+    } else {
+        int16_t iq[2];
+
+        for (size_t i = 0; i < samples; i++) {
+            if (fread(iq, sizeof(iq), 1, f) != 1) {
+                perror(filename);
+                break;
+            }
+
+            buf[i] = (iq[0] + iq[1] * I) / 32768.0f;
+        }
+    }
+
+    fclose(f);
+
+    return buf;
+}
+
+/* One second of a few CW-like carriers and a wideband noise floor */
+
+static float complex * synth_samples(size_t *blocks) {
+    static const float  freqs[] = { -31250.0f, -2000.0f, 700.0f, 1500.0f, 18000.0f };
+    static const float  levels[] = { 1e-3f, 1e-2f, 1e-4f, 3e-3f, 1e-5f };
+    const float         noise = 1e-5f;
+
+    size_t          samples = SYNTH_BLOCKS * RADIO_SAMPLES;
+    float complex   *buf = malloc(samples * sizeof(float complex));
+
+    for (size_t i = 0; i < samples; i++) {
+        float complex x = (randnf() + randnf() * I) * noise;
+
+        for (uint8_t n = 0; n < sizeof(freqs) / sizeof(freqs[0]); n++)
+            x += levels[n] * cexpf(I * 2.0f * M_PI * freqs[n] * i / SAMPLE_RATE);
+
+        buf[i] = x;
+    }
+
+    *blocks = SYNTH_BLOCKS;
+
+    return buf;
+}
+
+/*
+ * dsp_put_audio_samples() with the CW decoder and a dialog sharing the analytic signal, against the per-sample firhilbf.
+ * The block filter must give the firhilbf output, return false if it does not
+ */
+
+static bool bench_audio(uint32_t count) {
+    int16_t         *samples = malloc(AUDIO_CAPTURE_RATE * sizeof(int16_t));
+    float complex   *ref = malloc(AUDIO_CALLBACK * sizeof(float complex));
+    firhilbf        hilb = firhilbf_create(7, 60.0f);
+
+    for (uint32_t i = 0; i < AUDIO_CAPTURE_RATE; i++) {
+        float x = 0.3f * sinf(2.0f * M_PI * 700.0f * i / AUDIO_CAPTURE_RATE) + 0.01f * randnf();
+
+        samples[i] = x * 32767.0f;
+    }
+
+    /* Both from a reset state, over callback sized chunks as the capture gives them */
+
+    analytic_t      *analytic = malloc(sizeof(analytic_t));
+    float complex   *out = malloc(AUDIO_CALLBACK * sizeof(float complex));
+    float           max_err = 0.0f;
+
+    analytic_init(analytic);
+
+    for (uint32_t i = 0; i < 10; i++) {
+        int16_t *p = samples + i * AUDIO_CALLBACK;
+
+        analytic_execute_s16(analytic, p, AUDIO_CALLBACK, out);
+
+        for (uint32_t n = 0; n < AUDIO_CALLBACK; n++) {
+            firhilbf_r2c_execute(hilb, p[n] / 32768.0f, &ref[n]);
+            max_err = fmaxf(max_err, cabsf(out[n] - ref[n]));
+        }
+    }
+
+    firhilbf_reset(hilb);
+    free(analytic);
+    free(out);
+
+    mode = x6100_mode_cw;
+    dialog_audio = true;
+
+    uint64_t start = get_ns();
+
+    for (uint32_t i = 0; i < count; i++)
+        dsp_put_audio_samples(AUDIO_CALLBACK, samples + (i % 10) * AUDIO_CALLBACK);
+
+    double ns = (double) (get_ns() - start) / count;
+
+    start = get_ns();
+
+    for (uint32_t i = 0; i < count; i++) {
+        int16_t *p = samples + (i % 10) * AUDIO_CALLBACK;
+
+        for (uint32_t n = 0; n < AUDIO_CALLBACK; n++)
+            firhilbf_r2c_execute(hilb, p[n] / 32768.0f, &ref[n]);
+
+        audio_sum += crealf(ref[AUDIO_CALLBACK - 1]);
+    }
+
+    double ref_ns = (double) (get_ns() - start) / count;
+
+    printf("\n");
+    printf("audio       %u callbacks x %u samples, %u consumer calls\n", count, AUDIO_CALLBACK, audio_consumers);
+    printf("hilbert     %.0f ns/callback (firhilbf %.0f ns/callback), speedup %.2f\n", ns, ref_ns, ref_ns / ns);
+    printf("max error   %.2e against firhilbf%s\n", max_err, max_err > ANALYTIC_MAX_ERR ? ", MISMATCH" : "");
+    printf("load        %.3f %% of one core\n", ns * 100.0 / 100e6);
+
+    firhilbf_destroy(hilb);
+    free(samples);
+    free(ref);
+
+    return max_err <= ANALYTIC_MAX_ERR;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+        "Usage: %s [options] [file]\n"
+        "  -f cf32|cs16|iq  input format (default cf32), iq is a file of the IQ recorder\n"
+        "  -n blocks      number of blocks to process, file is looped (default 10000)\n"
+        "  -z factor      spectrum zoom factor (default 1)\n"
+        "  -o prefix      capture spectrum and waterfall frames to prefix.spectrum, prefix.waterfall\n"
+        "  -r             use the real clock for the spectrum and waterfall frame rate\n"
+        "  -a             also time the audio callback (analytic signal for the decoders)\n"
+        "  -p             spectrum peak hold on\n"
+        "Without a file a synthetic signal is used\n",
+        name
+    );
+}
+
+int main(int argc, char *argv[]) {
+    format_t    format = FORMAT_CF32;
+    uint32_t    count = 10000;
+    const char  *prefix = NULL;
+    bool        audio = false;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "f:n:z:o:raph")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (strcmp(optarg, "cf32") == 0) {
+                    format = FORMAT_CF32;
+                } else if (strcmp(optarg, "cs16") == 0) {
+                    format = FORMAT_CS16;
+                } else if (strcmp(optarg, "iq") == 0) {
+                    format = FORMAT_IQ;
+                } else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+
+            case 'n':
+                count = atoi(optarg);
+                break;
+
+            case 'z':
+                params_mode.spectrum_factor = atoi(optarg);
+                break;
+
+            case 'o':
+                prefix = optarg;
+                break;
+
+            case 'r':
+                real_clock = true;
+                break;
+
+            case 'a':
+                audio = true;
+                break;
+
+            case 'p':
+                params.spectrum_peak = true;
+                params.spectrum_peak_hold = 5000;
+                params.spectrum_peak_speed = 0.5f;
+                break;
+
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    float complex   *samples;
+    size_t          blocks;
+
+    if (optind < argc) {
+        samples = load_file(argv[optind], format, &blocks);
+    } else {
+        samples = synth_samples(&blocks);
+    }
+
+    if (!samples) {
+        return 1;
+    }
+
+    if (prefix) {
+        char filename[256];
+
+        snprintf(filename, sizeof(filename), "%s.spectrum", prefix);
+        spectrum_file = fopen(filename, "wb");
+
+        snprintf(filename, sizeof(filename), "%s.waterfall", prefix);
+        waterfall_file = fopen(filename, "wb");
+    }
+
+    dsp_init();
+
+    uint64_t start = get_ns();
+
+    for (uint32_t i = 0; i < count; i++) {
+        dsp_samples(samples + (i % blocks) * RADIO_SAMPLES, RADIO_SAMPLES);
+        virtual_usec += RADIO_SAMPLES * 1000000LL / SAMPLE_RATE;
+    }
+
+    uint64_t    total = get_ns() - start;
+    double      block_ns = (double) total / count;
+    double      realtime_ns = RADIO_SAMPLES * 1e9 / SAMPLE_RATE;
+
+    static const char *stages[DSP_STAGE_NUM] = {
+        "dc_block", "fft", "spectrum", "waterfall", "meter", "auto"
+    };
+
+    printf("blocks      %u x %u samples\n", count, RADIO_SAMPLES);
+    printf("total       %.3f s\n", total * 1e-9);
+    printf("rate        %.1f blocks/s (realtime %.1f blocks/s)\n", 1e9 / block_ns, 1e9 / realtime_ns);
+    printf("load        %.2f %% of one core\n", block_ns * 100.0 / realtime_ns);
+    printf("frames      spectrum %u, waterfall %u, meter %u\n", spectrum_count, waterfall_count, meter_count);
+    printf("\n");
+
+    for (uint8_t i = 0; i < DSP_STAGE_NUM; i++)
+        printf("%-11s %10.0f ns/block\n", stages[i], (double) dsp_stage_ns[i] / count);
+
+    printf("%-11s %10.0f ns/block\n", "total", block_ns);
+
+    bool ok = true;
+
+    if (audio) {
+        ok = bench_audio(count / 10);
+    }
+
+    if (spectrum_file) {
+        fclose(spectrum_file);
+    }
+
+    if (waterfall_file) {
+        fclose(waterfall_file);
+    }
+
+    free(samples);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Flush throughput on a memory framebuffer: LVGL sw_rotate with fbdev_flush() against fb_write()
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "lvgl/lvgl.h"
+#include "fb.h"
+
+#define GUI_WIDTH       800
+#define GUI_HEIGHT      480
+#define DISP_BUF_SIZE   (128 * 1024)        /* As in main.c */
+
+typedef struct {
+    const char  *label;
+    lv_area_t   area;
+} region_t;
+
+static const region_t regions[] = {
+    { "screen",     { 0, 0, GUI_WIDTH - 1, GUI_HEIGHT - 1 } },
+    { "spectrum",   { 0, 0, GUI_WIDTH - 1, 160 - 1 } },
+    { "waterfall",  { 0, 196, GUI_WIDTH - 1, GUI_HEIGHT - 1 } },
+};
+
+static uint64_t get_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* draw_buf_rotate_90() of lv_refr.c, not inverted */
+
+static void rotate_90(lv_coord_t area_w, lv_coord_t area_h, const lv_color_t *src, lv_color_t *rot_buf) {
+    uint32_t initial_i = ((area_w - 1) * area_h);
+
+    for (lv_coord_t y = 0; y < area_h; y++) {
+        uint32_t i = initial_i + y;
+
+        for (lv_coord_t x = 0; x < area_w; x++) {
+            rot_buf[i] = *(src++);
+            i -= area_h;
+        }
+    }
+}
+
+/* fbdev_flush() of lv_drivers, 32 bpp */
+
+static void fbdev_copy(const fb_t *fb, const lv_area_t *area, const lv_color_t *color_p) {
+    lv_coord_t w = lv_area_get_width(area);
+
+    for (int32_t y = area->y1; y <= area->y2; y++) {
+        memcpy(fb->mem + y * fb->stride + area->x1 * 4, color_p, w * 4);
+        color_p += w;
+    }
+}
+
+/* The sw_rotate part of draw_buf_rotate() in lv_refr.c: chunks of LV_DISP_ROT_MAX_BUF */
+
+static void sw_rotate_flush(const fb_t *fb, const lv_area_t *gui_area, const lv_color_t *color_p, lv_color_t *rot_buf) {
+    lv_area_t   area = *gui_area;
+    lv_coord_t  area_w = lv_area_get_width(&area);
+    lv_coord_t  area_h = lv_area_get_height(&area);
+    lv_coord_t  max_row = LV_MIN((lv_coord_t) ((LV_DISP_ROT_MAX_BUF / sizeof(lv_color_t)) / area_w), area_h);
+    lv_coord_t  init_y_off = area.y1;
+    lv_coord_t  row = 0;
+
+    area.y2 = fb->height - area.x1 - 1;
+    area.y1 = area.y2 - area_w + 1;
+
+    while (row < area_h) {
+        lv_coord_t height = LV_MIN(max_row, area_h - row);
+
+        rotate_90(area_w, height, color_p, rot_buf);
+
+        area.x1 = init_y_off + row;
+        area.x2 = init_y_off + row + height - 1;
+
+        fbdev_copy(fb, &area, rot_buf);
+
+        color_p += area_w * height;
+        row += height;
+    }
+}
+
+/* Region is flushed in draw buffer sized parts, as lv_refr.c splits it */
+
+static double run(const fb_t *fb, const region_t *region, const lv_color_t *src, bool sw, uint32_t frames) {
+    lv_color_t  *rot_buf = malloc(LV_DISP_ROT_MAX_BUF);
+    lv_coord_t  w = lv_area_get_width(&region->area);
+    lv_coord_t  h = lv_area_get_height(&region->area);
+    lv_coord_t  max_row = DISP_BUF_SIZE / w;
+    uint64_t    start = get_ns();
+
+    for (uint32_t i = 0; i < frames; i++)
+        for (lv_coord_t row = 0; row < h; row += max_row) {
+            lv_area_t area = region->area;
+
+            area.y1 += row;
+            area.y2 = LV_MIN(area.y1 + max_row - 1, region->area.y2);
+
+            if (sw) {
+                sw_rotate_flush(fb, &area, src + row * w, rot_buf);
+            } else {
+                fb_write(fb, &area, src + row * w);
+            }
+        }
+
+    free(rot_buf);
+
+    return (double) (get_ns() - start) / frames;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t    frames = 200;
+    int         opt;
+    int         errors = 0;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n':
+                frames = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n frames]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    lv_color_t  *src = malloc(GUI_WIDTH * GUI_HEIGHT * sizeof(lv_color_t));
+    uint32_t    stride = GUI_HEIGHT * 4;
+    uint8_t     *mem = calloc(GUI_WIDTH, stride);
+    uint8_t     *ref = calloc(GUI_WIDTH, stride);
+
+    for (uint32_t i = 0; i < GUI_WIDTH * GUI_HEIGHT; i++)
+        src[i].full = 0xFF000000 | (rand() & 0xFFFFFF);
+
+    printf("%ux%u GUI on a %ux%u memory framebuffer, %u frames\n", GUI_WIDTH, GUI_HEIGHT, GUI_HEIGHT, GUI_WIDTH, frames);
+
+    for (uint8_t bpp = 32; bpp >= 16; bpp -= 8) {
+        fb_t fb = { .mem = mem, .width = GUI_HEIGHT, .height = GUI_WIDTH, .stride = GUI_HEIGHT * bpp / 8, .bpp = bpp };
+
+        printf("\n%u bpp\n", bpp);
+
+        for (uint8_t n = 0; n < sizeof(regions) / sizeof(regions[0]); n++) {
+            const region_t  *region = &regions[n];
+            double          bytes = lv_area_get_size(&region->area) * sizeof(lv_color_t);
+            double          ns = run(&fb, region, src, false, frames);
+
+            if (bpp == 32) {
+                fb_t    ref_fb = fb;
+
+                ref_fb.mem = ref;
+
+                double  sw_ns = run(&ref_fb, region, src, true, frames);
+
+                if (memcmp(mem, ref, GUI_WIDTH * stride) != 0) {
+                    printf("%-10s framebuffer differs from sw_rotate\n", region->label);
+                    errors++;
+                }
+
+                printf("%-10s sw_rotate %7.3f ms %8.1f MB/s, fb_write %7.3f ms %8.1f MB/s, speedup %.2f\n",
+                    region->label, sw_ns * 1e-6, bytes * 1e3 / sw_ns, ns * 1e-6, bytes * 1e3 / ns, sw_ns / ns);
+            } else {
+                printf("%-10s fb_write %7.3f ms %8.1f MB/s\n", region->label, ns * 1e-6, bytes * 1e3 / ns);
+            }
+        }
+    }
+
+    free(src);
+    free(mem);
+    free(ref);
+
+    return errors ? 1 : 0;
+}
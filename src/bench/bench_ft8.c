@@ -0,0 +1,211 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  FT8/FT4 slot decode benchmark for the decoder pool
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "ft8_rx.h"
+#include "ft8_mag.h"
+#include "ft8_wav.h"
+
+static uint64_t get_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* Waterfall magnitude kernel against the plain log10f version on random spectra */
+
+static void bench_mag(uint16_t num_bins, uint32_t repeats) {
+    float complex   *freq = malloc(num_bins * 2 * sizeof(float complex));
+    uint8_t         *mag = malloc(num_bins * 2);
+    uint8_t         *mag_ref = malloc(num_bins * 2);
+    uint32_t        diff = 0;
+    uint32_t        max_diff = 0;
+
+    srand(1);
+
+    for (uint32_t i = 0; i < num_bins * 2; i++) {
+        float db = (float) rand() / RAND_MAX * 160.0f - 140.0f;
+        float phase = (float) rand() / RAND_MAX * 2.0f * M_PI;
+
+        freq[i] = powf(10.0f, db / 20.0f) * cexpf(I * phase);
+    }
+
+    uint64_t start = get_ns();
+
+    for (uint32_t i = 0; i < repeats; i++)
+        ft8_mag_block_ref(freq, mag_ref, num_bins);
+
+    double ref_ns = (double) (get_ns() - start) / repeats;
+
+    start = get_ns();
+
+    for (uint32_t i = 0; i < repeats; i++)
+        ft8_mag_block(freq, mag, num_bins);
+
+    double ns = (double) (get_ns() - start) / repeats;
+
+    for (uint32_t i = 0; i < num_bins * 2; i++) {
+        uint32_t d = abs(mag[i] - mag_ref[i]);
+
+        if (d) {
+            diff++;
+
+            if (d > max_diff) {
+                max_diff = d;
+            }
+        }
+    }
+
+    printf("magnitude   %.0f ns/fft (log10f %.0f ns/fft), speedup %.2f\n", ns, ref_ns, ref_ns / ns);
+    printf("            %u of %u bins differ, max %u LSB\n\n", diff, num_bins * 2, max_diff);
+
+    free(freq);
+    free(mag);
+    free(mag_ref);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+        "Usage: %s [options] file.wav\n"
+        "  -4             FT4 slot (default FT8)\n"
+        "  -t threads     maximum number of decoder threads (default one per core)\n"
+        "  -n repeats     decodes of the slot per thread count (default 10)\n"
+        "  -b ms          time budget for subtraction passes (default 0, a single pass)\n"
+        "  -v             print decoded messages\n",
+        name
+    );
+}
+
+int main(int argc, char *argv[]) {
+    ftx_protocol_t  protocol = PROTO_FT8;
+    long            max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t        repeats = 10;
+    uint32_t        budget_ms = 0;
+    bool            verbose = false;
+    int             opt;
+
+    while ((opt = getopt(argc, argv, "4t:n:b:vh")) != -1) {
+        switch (opt) {
+            case '4':
+                protocol = PROTO_FT4;
+                break;
+
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+
+            case 'n':
+                repeats = atoi(optarg);
+                break;
+
+            case 'b':
+                budget_ms = atoi(optarg);
+                break;
+
+            case 'v':
+                verbose = true;
+                break;
+
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc || max_threads < 1 || repeats < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t          samples;
+    uint64_t        start = get_ns();
+    float complex   *buf = ft8_wav_load(argv[optind], &samples);
+
+    if (!buf) {
+        return 1;
+    }
+
+    double load_ms = (get_ns() - start) * 1e-6;
+
+    ft8_rx_t    rx;
+
+    ft8_rx_init(&rx, protocol, FT8_WAV_RATE);
+    start = get_ns();
+
+    for (size_t pos = 0; pos + rx.block_size <= samples; pos += rx.block_size)
+        if (ft8_rx_process(&rx, buf + pos)) {
+            break;
+        }
+
+    double waterfall_ms = (get_ns() - start) * 1e-6;
+
+    if (rx.wf.num_blocks < rx.wf.max_blocks) {
+        fprintf(stderr, "Warning: short slot, %i of %i blocks\n", rx.wf.num_blocks, rx.wf.max_blocks);
+    }
+
+    printf("load        %.2f ms (resample, hilbert, decimation)\n", load_ms);
+    printf("waterfall   %.2f ms, %.1f us/block\n\n", waterfall_ms, waterfall_ms * 1e3 / rx.wf.num_blocks);
+
+    bench_mag(rx.wf.num_bins, repeats * 1000);
+
+    ft8_rx_result_t results[FT8_RX_MAX_DECODED];
+    uint16_t        num = 0;
+    double          single_ms = 0;
+
+    printf("threads       sync ms   decode ms  subtract ms   speedup   decodes\n");
+
+    for (long threads = 1; threads <= max_threads; threads++) {
+        uint64_t    sync_ns = 0;
+        uint64_t    decode_ns = 0;
+        uint64_t    subtract_ns = 0;
+
+        ft8_rx_pool_init(threads);
+
+        for (uint32_t i = 0; i < repeats; i++) {
+            num = ft8_rx_decode(&rx, results, FT8_RX_MAX_DECODED, budget_ms);
+
+            sync_ns += rx.sync_ns;
+            decode_ns += rx.decode_ns;
+            subtract_ns += rx.subtract_ns;
+        }
+
+        ft8_rx_pool_done();
+
+        double ms = decode_ns * 1e-6 / repeats;
+
+        if (threads == 1) {
+            single_ms = ms;
+        }
+
+        printf("%-11li %9.2f %11.2f %12.2f %9.2f %9u\n", threads, sync_ns * 1e-6 / repeats, ms, subtract_ns * 1e-6 / repeats, single_ms / ms, num);
+    }
+
+    printf("\ncandidates  %u, passes %u\n", rx.candidates, rx.passes);
+
+    if (verbose) {
+        printf("\n");
+
+        for (uint16_t i = 0; i < num; i++)
+            printf("%+4i %5.1f %5.0f  %s\n", results[i].snr, results[i].time_sec, results[i].freq_hz, results[i].message.text);
+    }
+
+    ft8_rx_done(&rx);
+    free(buf);
+
+    return 0;
+}
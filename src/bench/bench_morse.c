@@ -0,0 +1,214 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Morse table lookups: check of every entry and timing against the plain table walk
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "morse.h"
+
+static uint64_t get_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static uint16_t code_of(const char *morse) {
+    uint16_t code = MORSE_CODE_EMPTY;
+
+    for (; *morse; morse++)
+        code = morse_code_add(code, *morse == '-');
+
+    return code;
+}
+
+/* Table walks, as the decoder and the encoder did before */
+
+static const char * walk_decode(const char *morse) {
+    for (cw_characters_t *character = &cw_characters[0]; character->morse; character++)
+        if (strcmp(morse, character->morse) == 0) {
+            return character->character;
+        }
+
+    return NULL;
+}
+
+static uint8_t walk_encode(const char *str, const char **morse) {
+    for (cw_characters_t *character = &cw_characters[0]; character->morse; character++) {
+        uint8_t len = strlen(character->character);
+
+        if (strncasecmp(character->character, str, len) == 0) {
+            *morse = character->morse;
+            return len;
+        }
+    }
+
+    return 0;
+}
+
+/* Every entry must give the same answer as the table walk */
+
+static uint32_t check() {
+    uint32_t    errors = 0;
+    uint32_t    entries = 0;
+
+    for (cw_characters_t *character = &cw_characters[0]; character->morse; character++) {
+        const char  *decoded = morse_decode(code_of(character->morse));
+        const char  *ref_decoded = walk_decode(character->morse);
+        const char  *morse = NULL;
+        const char  *ref_morse = NULL;
+        uint8_t     len = morse_encode(character->character, &morse);
+        uint8_t     ref_len = walk_encode(character->character, &ref_morse);
+
+        if (decoded != ref_decoded) {
+            printf("decode %-10s %s, expected %s\n", character->morse, decoded ? decoded : "NULL", ref_decoded);
+            errors++;
+        }
+
+        if (len != ref_len || morse != ref_morse) {
+            printf("encode %-10s %s, expected %s\n", character->character, morse ? morse : "NULL", ref_morse);
+            errors++;
+        }
+
+        /* Lower case */
+
+        char lower[16];
+
+        for (uint8_t i = 0; i < sizeof(lower); i++) {
+            lower[i] = tolower(character->character[i]);
+
+            if (lower[i] == 0) {
+                break;
+            }
+        }
+
+        len = morse_encode(lower, &morse);
+
+        if (len != ref_len || morse != ref_morse) {
+            printf("encode %-10s %s, expected %s\n", lower, morse ? morse : "NULL", ref_morse);
+            errors++;
+        }
+
+        entries++;
+    }
+
+    /* Unknown and too long codes */
+
+    if (morse_decode(code_of("--------")) || morse_decode(code_of("..........-"))) {
+        printf("decode of unknown code\n");
+        errors++;
+    }
+
+    const char *morse;
+
+    if (morse_encode("#", &morse) || morse_encode("<XX>", &morse)) {
+        printf("encode of unknown character\n");
+        errors++;
+    }
+
+    printf("check       %u entries, %u errors\n", entries, errors);
+
+    return errors;
+}
+
+static void bench(uint32_t repeats) {
+    uint16_t    codes[128];
+    const char  *morse[128];
+    uint16_t    num = 0;
+    volatile uint32_t   found = 0;
+    const char  *text = "CQ CQ DE R1CBU R1CBU KO85 PSE K <AR> <SK> 5NN TU 73";
+
+    for (cw_characters_t *character = &cw_characters[0]; character->morse && num < 128; character++) {
+        codes[num] = code_of(character->morse);
+        morse[num] = character->morse;
+        num++;
+    }
+
+    uint64_t start = get_ns();
+
+    for (uint32_t r = 0; r < repeats; r++)
+        for (uint16_t i = 0; i < num; i++)
+            found += walk_decode(morse[i]) != NULL;
+
+    double walk_ns = (double) (get_ns() - start) / repeats / num;
+
+    start = get_ns();
+
+    for (uint32_t r = 0; r < repeats; r++)
+        for (uint16_t i = 0; i < num; i++)
+            found += morse_decode(codes[i]) != NULL;
+
+    double ns = (double) (get_ns() - start) / repeats / num;
+
+    printf("decode      %.1f ns/char (table walk %.1f ns/char)\n", ns, walk_ns);
+
+    uint32_t chars = 0;
+
+    start = get_ns();
+
+    for (uint32_t r = 0; r < repeats; r++)
+        for (const char *p = text; *p; ) {
+            const char  *m;
+            uint8_t     len = walk_encode(p, &m);
+
+            p += len ? len : 1;
+            chars++;
+        }
+
+    walk_ns = (double) (get_ns() - start) / chars;
+    chars = 0;
+    start = get_ns();
+
+    for (uint32_t r = 0; r < repeats; r++)
+        for (const char *p = text; *p; ) {
+            const char  *m;
+            uint8_t     len = morse_encode(p, &m);
+
+            p += len ? len : 1;
+            chars++;
+        }
+
+    ns = (double) (get_ns() - start) / chars;
+
+    printf("encode      %.1f ns/char (table walk %.1f ns/char)\n", ns, walk_ns);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t    repeats = 10000;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                repeats = atoi(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n repeats]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    morse_init();
+
+    if (check()) {
+        return 1;
+    }
+
+    bench(repeats);
+
+    return 0;
+}
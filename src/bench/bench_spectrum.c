@@ -0,0 +1,267 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Spectrum trace drawing: per bin lv_draw_line() against the column renderer, headless
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "lvgl/lvgl.h"
+#include "spectrum_render.h"
+
+#define WIDTH       800
+#define HEIGHT      160
+#define BINS        400
+#define MIN_DB      -120.0f
+#define MAX_DB      -40.0f
+
+typedef enum {
+    DRAW_LINES = 0,
+    DRAW_RENDER,
+} draw_t;
+
+static lv_color_t           disp_buf[WIDTH * HEIGHT];
+static lv_disp_draw_buf_t   draw_buf;
+static lv_disp_drv_t        disp_drv;
+static lv_disp_t            *disp;
+
+static lv_obj_t             *obj;
+static draw_t               draw;
+static bool                 filled;
+
+static float                bins[BINS];
+static float                peak[BINS];
+
+static spectrum_render_t    render;
+static spectrum_run_t       runs[32];
+
+static uint64_t get_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    lv_disp_flush_ready(drv);
+}
+
+/* The spectrum_draw_cb() trace part before the renderer */
+
+static void draw_lines(lv_draw_ctx_t *draw_ctx) {
+    lv_draw_line_dsc_t  main_line_dsc;
+    lv_draw_line_dsc_t  peak_line_dsc;
+
+    lv_draw_line_dsc_init(&main_line_dsc);
+
+    main_line_dsc.color = lv_color_hex(0xAAAAAA);
+    main_line_dsc.width = 2;
+
+    lv_draw_line_dsc_init(&peak_line_dsc);
+
+    peak_line_dsc.color = lv_color_hex(0x555555);
+    peak_line_dsc.width = 1;
+
+    lv_coord_t x1 = obj->coords.x1;
+    lv_coord_t y1 = obj->coords.y1;
+
+    lv_coord_t w = lv_obj_get_width(obj);
+    lv_coord_t h = lv_obj_get_height(obj);
+
+    lv_point_t main_a, main_b;
+    lv_point_t peak_a, peak_b;
+
+    main_b.x = x1;
+    main_b.y = y1 + h;
+    peak_b = main_b;
+
+    for (uint16_t i = 0; i < BINS; i++) {
+        float       v = (bins[i] - MIN_DB) / (MAX_DB - MIN_DB);
+        float       v_peak = (peak[i] - MIN_DB) / (MAX_DB - MIN_DB);
+        uint16_t    x = i * w / BINS;
+
+        peak_a.x = x1 + x;
+        peak_a.y = y1 + (1.0f - v_peak) * h;
+
+        lv_draw_line(draw_ctx, &peak_line_dsc, &peak_a, &peak_b);
+
+        peak_b = peak_a;
+
+        main_a.x = x1 + x;
+        main_a.y = y1 + (1.0f - v) * h;
+
+        if (filled) {
+            main_b.x = main_a.x;
+            main_b.y = y1 + h;
+        }
+
+        lv_draw_line(draw_ctx, &main_line_dsc, &main_a, &main_b);
+
+        if (!filled) {
+            main_b = main_a;
+        }
+    }
+}
+
+static void draw_cb(lv_event_t * e) {
+    lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+
+    if (draw == DRAW_LINES) {
+        draw_lines(draw_ctx);
+    } else {
+        spectrum_render_draw(&render, draw_ctx->buf, draw_ctx->buf_area, draw_ctx->clip_area, obj->coords.x1, obj->coords.y1);
+    }
+}
+
+/* Noise floor, a few carriers and a slow sweep. Every frame moves only some bins, as on a quiet band */
+
+static void next_frame(uint32_t frame, float changed) {
+    for (uint16_t i = 0; i < BINS; i++) {
+        if ((float) rand() / RAND_MAX > changed) {
+            continue;
+        }
+
+        float v = -110.0f + (float) rand() / RAND_MAX * 8.0f;
+
+        if (i % 97 == 13) {
+            v = -60.0f;
+        }
+
+        if (abs((int) i - (int) (frame % BINS)) < 3) {
+            v = -70.0f;
+        }
+
+        bins[i] = v;
+
+        if (v > peak[i]) {
+            peak[i] = v;
+        } else {
+            peak[i] -= 0.5f;
+        }
+    }
+}
+
+static void invalidate(bool dirty) {
+    if (draw == DRAW_LINES) {
+        lv_obj_invalidate(obj);
+        return;
+    }
+
+    render.filled = filled;
+
+    uint16_t n = spectrum_render_update(&render, bins, peak, BINS, MIN_DB, MAX_DB, runs, 32);
+
+    if (!dirty) {
+        lv_obj_invalidate(obj);
+        return;
+    }
+
+    for (uint16_t i = 0; i < n; i++) {
+        lv_area_t area = {
+            .x1 = obj->coords.x1 + runs[i].from,
+            .y1 = obj->coords.y1,
+            .x2 = obj->coords.x1 + runs[i].to,
+            .y2 = obj->coords.y2
+        };
+
+        lv_obj_invalidate_area(obj, &area);
+    }
+}
+
+static void run(const char *label, draw_t d, bool f, bool aa, bool dirty, uint32_t frames, float changed) {
+    draw = d;
+    filled = f;
+    render.aa = aa;
+
+    srand(1);
+
+    for (uint16_t i = 0; i < BINS; i++) {
+        bins[i] = -110.0f;
+        peak[i] = -110.0f;
+    }
+
+    lv_obj_invalidate(obj);
+    lv_refr_now(disp);
+
+    uint64_t start = get_ns();
+
+    for (uint32_t i = 0; i < frames; i++) {
+        next_frame(i, changed);
+        invalidate(dirty);
+        lv_refr_now(disp);
+    }
+
+    uint64_t ns = get_ns() - start;
+
+    printf("%-24s %8.3f ms/frame\n", label, ns / 1e6 / frames);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t    frames = 1000;
+    float       changed = 0.25f;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "n:c:")) != -1) {
+        switch (opt) {
+            case 'n':
+                frames = atoi(optarg);
+                break;
+
+            case 'c':
+                changed = atof(optarg);
+                break;
+
+            default:
+                fprintf(stderr, "Usage: %s [-n frames] [-c changed bins part]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    lv_init();
+
+    lv_disp_draw_buf_init(&draw_buf, disp_buf, NULL, WIDTH * HEIGHT);
+    lv_disp_drv_init(&disp_drv);
+
+    disp_drv.draw_buf = &draw_buf;
+    disp_drv.flush_cb = flush_cb;
+    disp_drv.hor_res = WIDTH;
+    disp_drv.ver_res = HEIGHT;
+
+    disp = lv_disp_drv_register(&disp_drv);
+
+    obj = lv_obj_create(lv_scr_act());
+
+    lv_obj_remove_style_all(obj);
+    lv_obj_set_size(obj, WIDTH, HEIGHT);
+    lv_obj_set_style_bg_color(obj, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(obj, LV_OPA_COVER, 0);
+    lv_obj_add_event_cb(obj, draw_cb, LV_EVENT_DRAW_MAIN_END, NULL);
+    lv_obj_update_layout(obj);
+
+    spectrum_render_init(&render);
+    spectrum_render_resize(&render, WIDTH, HEIGHT);
+
+    printf("%ux%u, %u bins, %u frames, %.0f%% bins changed per frame\n", WIDTH, HEIGHT, BINS, frames, changed * 100.0f);
+
+    run("lines filled", DRAW_LINES, true, false, false, frames, changed);
+    run("lines", DRAW_LINES, false, false, false, frames, changed);
+    run("render filled", DRAW_RENDER, true, false, false, frames, changed);
+    run("render", DRAW_RENDER, false, false, false, frames, changed);
+    run("render aa", DRAW_RENDER, false, true, false, frames, changed);
+    run("render filled, dirty", DRAW_RENDER, true, false, true, frames, changed);
+    run("render aa, dirty", DRAW_RENDER, false, true, true, frames, changed);
+
+    spectrum_render_free(&render);
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+#!/bin/sh
+#
+# Generate the synthetic slot corpus and decode it: ./ft8_corpus.sh [build dir]
+#
+
+set -e
+
+BUILD=${1:-.}
+CORPUS=$(dirname "$0")/ft8_corpus.txt
+DIR=$(mktemp -d)
+
+trap 'rm -rf "$DIR"' EXIT
+
+"$BUILD/ft8_gen_slot" -o "$DIR" "$CORPUS"
+"$BUILD/ft8_decode_file" "$DIR"/ft8_*.wav
+"$BUILD/ft8_decode_file" -4 "$DIR"/ft4_*.wav
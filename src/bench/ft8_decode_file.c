@@ -0,0 +1,134 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Offline FT8/FT4 decoder for recorded slots
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "ft8_rx.h"
+#include "ft8_wav.h"
+
+static uint64_t get_ns(clockid_t clock) {
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+        "Usage: %s [options] file.wav ...\n"
+        "  -4             FT4 slots (default FT8)\n"
+        "  -t threads     decoder threads (default one per core)\n"
+        "  -b ms          time budget for subtraction passes, 0 for a single pass (default 1000)\n"
+        "  -q             print only the timing and the totals\n",
+        name
+    );
+}
+
+int main(int argc, char *argv[]) {
+    ftx_protocol_t  protocol = PROTO_FT8;
+    uint8_t         threads = 0;
+    uint32_t        budget_ms = 1000;
+    bool            quiet = false;
+    int             opt;
+
+    while ((opt = getopt(argc, argv, "4t:b:qh")) != -1) {
+        switch (opt) {
+            case '4':
+                protocol = PROTO_FT4;
+                break;
+
+            case 't':
+                threads = atoi(optarg);
+                break;
+
+            case 'b':
+                budget_ms = atoi(optarg);
+                break;
+
+            case 'q':
+                quiet = true;
+                break;
+
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ft8_rx_t        rx;
+    ft8_rx_result_t results[FT8_RX_MAX_DECODED];
+    uint32_t        total_decodes = 0;
+    uint32_t        total_files = 0;
+    uint64_t        wall_start = get_ns(CLOCK_MONOTONIC);
+    uint64_t        cpu_start = get_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+    ft8_rx_init(&rx, protocol, FT8_WAV_RATE);
+    ft8_rx_pool_init(threads);
+
+    for (int i = optind; i < argc; i++) {
+        const char      *filename = argv[i];
+        size_t          samples;
+        uint64_t        start = get_ns(CLOCK_MONOTONIC);
+        float complex   *buf = ft8_wav_load(filename, &samples);
+
+        if (!buf) {
+            continue;
+        }
+
+        uint64_t load_ns = get_ns(CLOCK_MONOTONIC) - start;
+
+        ft8_rx_reset(&rx);
+        start = get_ns(CLOCK_MONOTONIC);
+
+        for (size_t pos = 0; pos + rx.block_size <= samples; pos += rx.block_size)
+            if (ft8_rx_process(&rx, buf + pos)) {
+                break;
+            }
+
+        uint64_t    waterfall_ns = get_ns(CLOCK_MONOTONIC) - start;
+        uint16_t    num = ft8_rx_decode(&rx, results, FT8_RX_MAX_DECODED, budget_ms);
+
+        printf("%s\n", filename);
+
+        if (!quiet) {
+            for (uint16_t n = 0; n < num; n++)
+                printf("%+4i %5.1f %5.0f ~  %s\n", results[n].snr, results[n].time_sec, results[n].freq_hz, results[n].message.text);
+        }
+
+        printf("    decodes %u, candidates %u, passes %u, blocks %u of %u\n", num, rx.candidates, rx.passes, rx.wf.num_blocks, rx.wf.max_blocks);
+        printf("    load %.2f ms, waterfall %.2f ms, sync %.2f ms, decode %.2f ms, subtract %.2f ms\n",
+            load_ns * 1e-6, waterfall_ns * 1e-6, rx.sync_ns * 1e-6, rx.decode_ns * 1e-6, rx.subtract_ns * 1e-6);
+
+        total_decodes += num;
+        total_files++;
+
+        free(buf);
+    }
+
+    ft8_rx_pool_done();
+    ft8_rx_done(&rx);
+
+    printf("\ntotal       %u slots, %u decodes, %.1f ms wall, %.1f ms cpu\n",
+        total_files, total_decodes,
+        (get_ns(CLOCK_MONOTONIC) - wall_start) * 1e-6,
+        (get_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start) * 1e-6);
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Synthetic FT8/FT4 slots for the decoder corpus
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sndfile.h>
+#include <liquid/liquid.h>
+
+#include "gfsk.h"
+#include "ft8/pack.h"
+#include "ft8/encode.h"
+#include "ft8/constants.h"
+
+#define RATE        12000
+#define NOISE       0.02f
+#define NOISE_BW    2500.0f
+
+typedef struct {
+    char            name[64];
+    ftx_protocol_t  protocol;
+    float           *buf;
+    size_t          size;
+    uint16_t        signals;
+} slot_t;
+
+static const char   *out_dir = ".";
+static slot_t       slot = { .buf = NULL };
+
+static bool slot_write() {
+    char        filename[512];
+    SF_INFO     sfinfo = {
+        .samplerate = RATE,
+        .channels = 1,
+        .format = SF_FORMAT_WAV | SF_FORMAT_PCM_16
+    };
+
+    snprintf(filename, sizeof(filename), "%s/%s.wav", out_dir, slot.name);
+
+    SNDFILE *file = sf_open(filename, SFM_WRITE, &sfinfo);
+
+    if (!file) {
+        fprintf(stderr, "%s: %s\n", filename, sf_strerror(NULL));
+        return false;
+    }
+
+    sf_writef_float(file, slot.buf, slot.size);
+    sf_close(file);
+
+    printf("%s: %u signals\n", filename, slot.signals);
+
+    return true;
+}
+
+static void slot_start(const char *name, ftx_protocol_t protocol) {
+    float slot_time = (protocol == PROTO_FT4) ? FT4_SLOT_TIME : FT8_SLOT_TIME;
+
+    snprintf(slot.name, sizeof(slot.name), "%s", name);
+    slot.protocol = protocol;
+    slot.size = slot_time * RATE;
+    slot.buf = realloc(slot.buf, slot.size * sizeof(float));
+    slot.signals = 0;
+
+    for (size_t i = 0; i < slot.size; i++)
+        slot.buf[i] = randnf() * NOISE;
+}
+
+/* SNR is in 2500 Hz bandwidth, as in WSJT-X */
+
+static bool slot_add(float freq, float snr, float dt, const char *msg) {
+    uint8_t     packed[FTX_LDPC_K_BYTES];
+    uint8_t     tones[FT4_NN];      /* Longer than FT8_NN */
+    uint16_t    num_tones;
+    float       symbol_period;
+    float       symbol_bt;
+
+    if (pack77(msg, packed) < 0) {
+        fprintf(stderr, "Cannot pack message \"%s\"\n", msg);
+        return false;
+    }
+
+    if (slot.protocol == PROTO_FT4) {
+        ft4_encode(packed, tones);
+        num_tones = FT4_NN;
+        symbol_period = FT4_SYMBOL_PERIOD;
+        symbol_bt = FT4_SYMBOL_BT;
+    } else {
+        ft8_encode(packed, tones);
+        num_tones = FT8_NN;
+        symbol_period = FT8_SYMBOL_PERIOD;
+        symbol_bt = FT8_SYMBOL_BT;
+    }
+
+    uint32_t    n_samples;
+    int16_t     *samples = gfsk_synth(tones, num_tones, freq, symbol_bt, symbol_period, RATE, &n_samples);
+    float       noise_power = NOISE * NOISE * NOISE_BW / (RATE / 2);
+    float       amp = sqrtf(2.0f * noise_power * powf(10.0f, snr / 10.0f));
+    float       scale = amp / (32767.0f * 0.8f);
+    int32_t     offset = dt * RATE;
+
+    for (uint32_t i = 0; i < n_samples; i++) {
+        int32_t pos = offset + i;
+
+        if (pos >= 0 && pos < (int32_t) slot.size) {
+            slot.buf[pos] += samples[i] * scale;
+        }
+    }
+
+    free(samples);
+    slot.signals++;
+
+    return true;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+        "Usage: %s [options] corpus.txt\n"
+        "  -o dir         output directory (default .)\n"
+        "  -s seed        noise seed (default 1)\n"
+        "Every corpus line is: slot ft8|ft4 freq snr dt message\n",
+        name
+    );
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int    seed = 1;
+    int             opt;
+
+    while ((opt = getopt(argc, argv, "o:s:h")) != -1) {
+        switch (opt) {
+            case 'o':
+                out_dir = optarg;
+                break;
+
+            case 's':
+                seed = atoi(optarg);
+                break;
+
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(argv[optind], "r");
+
+    if (!f) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    char    line[256];
+    int     res = 0;
+
+    srand(seed);
+
+    while (fgets(line, sizeof(line), f)) {
+        char    name[64];
+        char    proto[8];
+        float   freq, snr, dt;
+        int     msg_pos = 0;
+
+        line[strcspn(line, "\r\n")] = 0;
+
+        if (line[0] == '#' || line[0] == 0) {
+            continue;
+        }
+
+        if (sscanf(line, "%63s %7s %f %f %f %n", name, proto, &freq, &snr, &dt, &msg_pos) != 5 || msg_pos == 0) {
+            fprintf(stderr, "Wrong line: %s\n", line);
+            res = 1;
+            continue;
+        }
+
+        if (slot.buf == NULL || strcmp(slot.name, name) != 0) {
+            if (slot.buf && !slot_write()) {
+                res = 1;
+            }
+
+            slot_start(name, strcmp(proto, "ft4") == 0 ? PROTO_FT4 : PROTO_FT8);
+        }
+
+        if (!slot_add(freq, snr, dt, line + msg_pos)) {
+            res = 1;
+        }
+    }
+
+    if (slot.buf && !slot_write()) {
+        res = 1;
+    }
+
+    fclose(f);
+    free(slot.buf);
+
+    return res;
+}
@@ -0,0 +1,78 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sndfile.h>
+#include <liquid/liquid.h>
+
+#include "ft8_wav.h"
+#include "analytic.h"
+
+float complex * ft8_wav_load(const char *filename, size_t *samples) {
+    SF_INFO     sfinfo = { 0 };
+    SNDFILE     *file = sf_open(filename, SFM_READ, &sfinfo);
+
+    if (!file) {
+        fprintf(stderr, "%s: %s\n", filename, sf_strerror(NULL));
+        return NULL;
+    }
+
+    float   *frames = malloc(sfinfo.frames * sfinfo.channels * sizeof(float));
+    size_t  n = sf_readf_float(file, frames, sfinfo.frames);
+
+    sf_close(file);
+
+    for (size_t i = 0; i < n; i++)
+        frames[i] = frames[i * sfinfo.channels];
+
+    /* Capture rate */
+
+    float   *audio;
+    size_t  audio_n;
+
+    if (sfinfo.samplerate == FT8_WAV_CAPTURE_RATE) {
+        audio = frames;
+        audio_n = n;
+    } else {
+        float           rate = (float) FT8_WAV_CAPTURE_RATE / sfinfo.samplerate;
+        msresamp_rrrf   resamp = msresamp_rrrf_create(rate, 60.0f);
+        unsigned int    written;
+
+        audio = malloc((n * rate + 256) * sizeof(float));
+        msresamp_rrrf_execute(resamp, frames, n, audio, &written);
+        msresamp_rrrf_destroy(resamp);
+        free(frames);
+
+        audio_n = written;
+    }
+
+    /* Analytic signal and decimation, as in dsp.c and dialog_ft8.c */
+
+    analytic_t      *hilb = malloc(sizeof(analytic_t));
+    firdecim_crcf   decim = firdecim_crcf_create_kaiser(FT8_WAV_DECIM, 16, 40.0f);
+    float complex   *analytic = malloc(audio_n * sizeof(float complex));
+
+    analytic_init(hilb);
+    analytic_execute(hilb, audio, audio_n, analytic);
+
+    size_t          out_n = audio_n / FT8_WAV_DECIM;
+    float complex   *buf = malloc(out_n * sizeof(float complex));
+
+    firdecim_crcf_execute_block(decim, analytic, out_n, buf);
+
+    free(hilb);
+    firdecim_crcf_destroy(decim);
+    free(analytic);
+    free(audio);
+
+    *samples = out_n;
+
+    return buf;
+}
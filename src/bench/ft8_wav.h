@@ -0,0 +1,23 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <complex.h>
+
+#define FT8_WAV_CAPTURE_RATE    44100
+#define FT8_WAV_DECIM           4
+#define FT8_WAV_RATE            (FT8_WAV_CAPTURE_RATE / FT8_WAV_DECIM)
+
+/*
+ * Audio slot from a file, the way dialog_ft8.c gets it: resampled to the capture rate,
+ * made analytic and decimated to FT8_WAV_RATE. The first channel is used
+ */
+
+float complex * ft8_wav_load(const char *filename, size_t *samples);
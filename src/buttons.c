@@ -115,7 +115,7 @@ static button_item_t    buttons[] = {
 
     /* CW */
     
-    { .label = "(KEY 1:2)",         .press = button_next_page_cb,   .hold = button_prev_page_cb,    .next = PAGE_KEY_2, .prev = PAGE_CW_DECODER_1, .voice = "Key|page 1" },
+    { .label = "(KEY 1:2)",         .press = button_next_page_cb,   .hold = button_prev_page_cb,    .next = PAGE_KEY_2, .prev = PAGE_CW_DECODER_2, .voice = "Key|page 1" },
     { .label = "Speed",             .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_KEY_SPEED },
     { .label = "Volume",            .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_KEY_VOL },
     { .label = "Train",             .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_KEY_TRAIN },
@@ -127,11 +127,17 @@ static button_item_t    buttons[] = {
     { .label = "QSK\nTime",         .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_QSK_TIME },
     { .label = "Ratio",             .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_KEY_RATIO },
 
-    { .label = "(CW 1:1)",          .press = button_next_page_cb,   .hold = button_prev_page_cb,    .next = PAGE_KEY_1, .prev = PAGE_KEY_2, .voice = "CW page" },
+    { .label = "(CW 1:2)",          .press = button_next_page_cb,   .hold = button_prev_page_cb,    .next = PAGE_CW_DECODER_2, .prev = PAGE_KEY_2, .voice = "CW page 1" },
     { .label = "CW\nDecoder",       .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_CW_DECODER },
     { .label = "CW\nSNR",           .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_CW_DECODER_SNR },
     { .label = "CW Peak\nBeta",     .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_CW_DECODER_PEAK_BETA },
     { .label = "CW Noise\nBeta",    .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_CW_DECODER_NOISE_BETA },
+
+    { .label = "(CW 2:2)",          .press = button_next_page_cb,   .hold = button_prev_page_cb,    .next = PAGE_KEY_1, .prev = PAGE_CW_DECODER_1, .voice = "CW page 2" },
+    { .label = "CW\nSkimmer",       .press = button_mfk_update_cb,  .hold = button_mfk_hold_cb,     .data = MFK_CW_SKIMMER },
+    { .label = "",                  .press = NULL },
+    { .label = "",                  .press = NULL },
+    { .label = "",                  .press = NULL },
     
     /* DSP */
 
@@ -162,7 +168,7 @@ static button_item_t    buttons[] = {
     { .label = "GPS",               .press = button_app_page_cb,    .data = PAGE_GPS },
 
     { .label = "(APP 2:2)",         .press = button_next_page_cb,   .next = PAGE_APP_1, .voice = "Application|page 2" },
-    { .label = "Recorder",          .press = button_app_page_cb,    .data = PAGE_RECORDER },
+    { .label = "Recorder",          .press = button_app_page_cb,    .data = PAGE_RECORDER_1 },
     { .label = "QTH",               .press = button_action_cb,      .data = ACTION_APP_QTH },
     { .label = "Callsign",          .press = button_action_cb,      .data = ACTION_APP_CALLSIGN },
     { .label = "Settings",          .press = button_app_page_cb,    .data = PAGE_SETTINGS },
@@ -237,11 +243,17 @@ static button_item_t    buttons[] = {
     
     /* Recorder */
 
-    { .label = "(REC 1:1)",         .press = NULL },
+    { .label = "(REC 1:2)",         .press = button_next_page_cb,   .next = PAGE_RECORDER_2 },
     { .label = "Rec",               .press = dialog_recorder_rec_cb },
     { .label = "Rename",            .press = dialog_recorder_rename_cb },
     { .label = "Delete",            .press = dialog_recorder_delete_cb },
     { .label = "Play",              .press = dialog_recorder_play_cb },
+
+    { .label = "(REC 2:2)",         .press = button_next_page_cb,   .next = PAGE_RECORDER_1 },
+    { .label = "IQ Rec",            .press = dialog_recorder_iq_rec_cb },
+    { .label = "IQ Play",           .press = dialog_recorder_iq_play_cb },
+    { .label = "",                  .press = NULL },
+    { .label = "",                  .press = NULL },
 };
 
 void buttons_init(lv_obj_t *parent) {
@@ -28,6 +28,7 @@ typedef enum {
     PAGE_KEY_2,
     
     PAGE_CW_DECODER_1,
+    PAGE_CW_DECODER_2,
 
     PAGE_DFN_1,
     PAGE_DFN_2,
@@ -45,7 +46,8 @@ typedef enum {
     PAGE_MSG_CW_2,
     PAGE_MSG_VOICE_1,
     PAGE_MSG_VOICE_2,
-    PAGE_RECORDER,
+    PAGE_RECORDER_1,
+    PAGE_RECORDER_2,
 } button_page_t;
 
 typedef void (*hold_cb_t)(void *);
@@ -7,6 +7,7 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include "lvgl/lvgl.h"
 
 #include "cw.h"
@@ -14,88 +15,144 @@
 #include "util.h"
 #include "params.h"
 #include "cw_decoder.h"
+#include "cw_skimmer.h"
+#include "morse.h"
 #include "pannel.h"
 #include "meter.h"
 
-typedef struct {
-    uint16_t    n;
-    float       db;
-} fft_item_t;
+/*
+ * Tone tracker: sliding DFT of the passband bins only. Every hop adds its partial sums,
+ * the window is the sum of the last HOPS of them. Phase is taken from the sample position
+ * modulo WINDOW, so partial sums add up without drift
+ */
 
-#define FFT             1024
-#define OVER            8
-#define FFT_OVER        (FFT / OVER)
-#define FFT_ALL         (FFT + FFT_OVER)
+#define WINDOW          512
+#define HOP             128
+#define HOPS            (WINDOW / HOP)
+#define MAX_BINS        (WINDOW / 2)
+#define PEAK_WIDTH      2
 
 static bool             ready = false;
 
-static fft_item_t       fft_items[FFT / 2];
+static float complex    twiddle[WINDOW];
+static float complex    partial[HOPS][MAX_BINS];
+static uint8_t          partial_index = 0;
+static uint16_t         sample_pos = 0;
+static uint16_t         hop_pos = 0;
+static uint16_t         bin_start = 0;
+static uint16_t         bin_stop = 0;
+static float            bin_db[MAX_BINS];
 
-static cbuffercf        audio_buf;
-static spgramcf         audio_sg;
-static float            *audio_psd[OVER];
-static float            *audio_psd_sum;
-static uint8_t          audio_psd_index = 0;
+static cw_decoder_t     decoder;
+static bool             skimmer = false;
 
 static float            peak_filtered;
 static float            noise_filtered;
 static bool             peak_on = false;
 
-void cw_init() {
-    audio_buf = cbuffercf_create(FFT_ALL * 10);
+/* Passband bins, with a neighbour on each side for the Hann window */
+
+static void cw_update_bins() {
+    int32_t start = params_mode.filter_low * WINDOW / AUDIO_CAPTURE_RATE;
+    int32_t stop = params_mode.filter_high * WINDOW / AUDIO_CAPTURE_RATE;
+
+    if (start < 1) {
+        start = 1;
+    } else if (start > MAX_BINS - PEAK_WIDTH - 2) {
+        start = MAX_BINS - PEAK_WIDTH - 2;
+    }
+
+    if (stop < start + PEAK_WIDTH + 1) {
+        stop = start + PEAK_WIDTH + 1;
+    } else if (stop > MAX_BINS - 1) {
+        stop = MAX_BINS - 1;
+    }
 
-    audio_sg = spgramcf_create(FFT, LIQUID_WINDOW_BLACKMANHARRIS, FFT, FFT);
+    if (start != bin_start || stop != bin_stop) {
+        bin_start = start;
+        bin_stop = stop;
+        memset(partial, 0, sizeof(partial));
+    }
+}
 
-    for (uint8_t i = 0; i < OVER; i++)
-        audio_psd[i] = (float *) malloc(FFT * sizeof(float));
+static void decoder_text_cb(void *user, const char *text) {
+    pannel_add_text(text);
+}
 
-    audio_psd_sum = (float *) malloc(FFT * sizeof(float));
+void cw_init() {
+    for (uint16_t i = 0; i < WINDOW; i++)
+        twiddle[i] = cexpf(-I * 2.0f * M_PI * i / WINDOW);
 
     peak_filtered = S_MIN;
     noise_filtered = S_MIN;
 
+    morse_init();
+    cw_decoder_init(&decoder, decoder_text_cb, NULL);
+    cw_skimmer_init((float) AUDIO_CAPTURE_RATE / WINDOW);
+    cw_update_bins();
     ready = true;
 }
 
-static int compare_fft_items(const void *p1, const void *p2) {
-    fft_item_t *i1 = (fft_item_t *) p1;
-    fft_item_t *i2 = (fft_item_t *) p2;
+static void cw_get_spectrum() {
+    float complex   sum[MAX_BINS];
+    const float     scale = 1.0f / (WINDOW / 2 * WINDOW / 2);
+
+    for (uint16_t k = bin_start - 1; k <= bin_stop; k++) {
+        float complex x = 0;
+
+        for (uint8_t i = 0; i < HOPS; i++)
+            x += partial[i][k];
+
+        sum[k] = x;
+    }
 
-    return (i1->db > i2->db) ? -1 : 1;
+    /*
+     * Sums are referenced to sample_pos 0, the window starts at sample_pos. Hann in the frequency
+     * domain needs the neighbours rotated to the window start, the common phase does not matter
+     */
+
+    float complex rot = twiddle[sample_pos];
+
+    for (uint16_t k = bin_start; k < bin_stop; k++) {
+        float complex x = 0.5f * sum[k] - 0.25f * (rot * sum[k - 1] + conjf(rot) * sum[k + 1]);
+
+        bin_db[k] = 10.0f * log10f(crealf(x * conjf(x)) * scale + 1e-20f);
+    }
 }
 
 static bool cw_get_peak() {
-    uint32_t    start = FFT / 2 + FFT * params_mode.filter_low / AUDIO_CAPTURE_RATE;
-    uint32_t    stop = FFT / 2 + FFT * params_mode.filter_high / AUDIO_CAPTURE_RATE;
-    uint16_t    num = stop - start;
-
+    uint16_t    num = bin_stop - bin_start;
+    float       peak[PEAK_WIDTH];
+    float       total_db = 0;
     float       peak_db = 0;
-    uint16_t    peak_n = 0;
-    float       noise_db = 0;
-    bool        find = true;
-    uint16_t    item = 0;
-
-    for (uint16_t n = start; n < stop; n++) {
-        fft_items[item].n = n;
-        fft_items[item].db = audio_psd_sum[n];
-        
-        item++;
-    }
+    float       noise_db;
 
-    qsort(&fft_items, num, sizeof(fft_item_t), compare_fft_items);
+    for (uint8_t i = 0; i < PEAK_WIDTH; i++)
+        peak[i] = -INFINITY;
 
-    uint16_t peak_width = 2;
+    /* Running top PEAK_WIDTH, sorted from the highest */
 
-    for (uint16_t i = 0; i < num; i++) {
-        if (i < peak_width) {
-            peak_db += fft_items[i].db;
-        } else {
-            noise_db += fft_items[i].db;
+    for (uint16_t n = bin_start; n < bin_stop; n++) {
+        float   db = bin_db[n];
+        int8_t  i = PEAK_WIDTH - 1;
+
+        total_db += db;
+
+        if (db <= peak[i]) {
+            continue;
         }
+
+        for (; i > 0 && db > peak[i - 1]; i--)
+            peak[i] = peak[i - 1];
+
+        peak[i] = db;
     }
 
-    peak_db /= peak_width;
-    noise_db /= num - peak_width;
+    for (uint8_t i = 0; i < PEAK_WIDTH; i++)
+        peak_db += peak[i];
+
+    noise_db = (total_db - peak_db) / (num - PEAK_WIDTH);
+    peak_db /= PEAK_WIDTH;
 
     if (peak_db > -3.0f)
         peak_db = -3.0f;
@@ -107,8 +164,8 @@ static bool cw_get_peak() {
     lpf(&noise_filtered, noise_db, params.cw_decoder_noise_beta);
 
     float snr = peak_filtered - noise_filtered;
-    float snr_max = params.cw_decoder_snr * OVER;
-    float snr_min = (params.cw_decoder_snr - params.cw_decoder_snr_gist) * OVER;
+    float snr_max = params.cw_decoder_snr;
+    float snr_min = params.cw_decoder_snr - params.cw_decoder_snr_gist;
 
     if (peak_on) {
         if (snr < snr_min) {
@@ -121,21 +178,15 @@ static bool cw_get_peak() {
     }
 
 #if 0
-    if (peak_on) {
-        peak_n = fft_items[0].n;
-    } else {
-        peak_n = 0;
-    }
-
-    char    str[128];
-    uint8_t i = 0;
+    char    str[MAX_BINS + 1];
+    uint16_t i = 0;
     
-    for (uint16_t n = start; n < stop; n++) {
+    for (uint16_t n = bin_start; n < bin_stop; n++) {
         char c;
         
-        if (n == peak_n) {
+        if (peak_on && bin_db[n] >= peak[0]) {
             c = '#';
-        } else if (audio_psd_sum[n] > noise_filtered) {
+        } else if (bin_db[n] > noise_filtered) {
             c = '.';
         } else {
             c = ' ';
@@ -151,46 +202,59 @@ static bool cw_get_peak() {
     return peak_on;
 }
 
-void cw_put_audio_samples(unsigned int n, float complex *samples) {
+#ifdef CW_BENCH
+const float * cw_get_bins(uint16_t *start, uint16_t *stop) {
+    *start = bin_start;
+    *stop = bin_stop;
+
+    return bin_db;
+}
+#endif
+
+void cw_put_audio_samples(unsigned int n, const float complex *samples) {
     if (!ready) {
         return;
     }
 
-    cbuffercf_write(audio_buf, samples, n);
-    
-    while (cbuffercf_size(audio_buf) > FFT_ALL) {
-        unsigned int n;
-        float complex *buf;
-        
-        cbuffercf_read(audio_buf, FFT, &buf, &n);
-        
-        spgramcf_write(audio_sg, buf, n);
-        cbuffercf_release(audio_buf, FFT_OVER);
-        
-        spgramcf_get_psd(audio_sg, audio_psd[audio_psd_index]);
-        spgramcf_reset(audio_sg);
-        
-        audio_psd_index++;
-        
-        if (audio_psd_index >= OVER) {
-            audio_psd_index = 0;
-        }
+    for (unsigned int i = 0; i < n; i++) {
+        float complex   x = samples[i];
+        float complex   *p = partial[partial_index];
 
-        for (uint16_t i = 0; i < FFT; i++) {
-            float sum = 0;
-            
-            for (uint8_t n = 0; n < OVER; n++) {
-                float *psd = audio_psd[n];
-                
-                sum += psd[i];
-            }
-            
-            audio_psd_sum[i] = sum;
+        for (uint16_t k = bin_start - 1; k <= bin_stop; k++)
+            p[k] += x * twiddle[(k * sample_pos) & (WINDOW - 1)];
+
+        sample_pos = (sample_pos + 1) & (WINDOW - 1);
+
+        if (++hop_pos < HOP) {
+            continue;
         }
 
+        hop_pos = 0;
+        cw_get_spectrum();
+
         if (params.cw_decoder) {
-            cw_decoder_signal(cw_get_peak(), FFT_OVER * 1000.0f / AUDIO_CAPTURE_RATE);
+            bool    on = cw_get_peak();
+            float   ms = HOP * 1000.0f / AUDIO_CAPTURE_RATE;
+
+            if (skimmer != params.cw_skimmer.x) {
+                skimmer = params.cw_skimmer.x;
+                cw_skimmer_reset();
+                cw_decoder_init(&decoder, decoder_text_cb, NULL);
+            }
+
+            if (skimmer) {
+                cw_skimmer_process(bin_db, bin_start, bin_stop, noise_filtered, ms);
+            } else {
+                cw_decoder_signal(&decoder, on, ms);
+            }
         }
+
+        /* Oldest hop makes room for the next one */
+
+        partial_index = (partial_index + 1) % HOPS;
+        memset(partial[partial_index], 0, sizeof(partial[0]));
+
+        cw_update_bins();
     }
 }
 
@@ -208,6 +272,17 @@ bool cw_change_decoder(int16_t df) {
     return params.cw_decoder;
 }
 
+bool cw_change_skimmer(int16_t df) {
+    if (df == 0) {
+        return params.cw_skimmer.x;
+    }
+
+    params_bool_set(&params.cw_skimmer, !params.cw_skimmer.x);
+    pannel_visible();
+
+    return params.cw_skimmer.x;
+}
+
 float cw_change_snr(int16_t df) {
     if (df == 0) {
         return params.cw_decoder_snr;
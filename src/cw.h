@@ -14,10 +14,17 @@
 
 void cw_init();
 
-void cw_put_audio_samples(unsigned int n, float complex *samples);
+void cw_put_audio_samples(unsigned int n, const float complex *samples);
 void cw_put_audio_int_samples(unsigned int n, int16_t *samples);
 
 bool cw_change_decoder(int16_t df);
+bool cw_change_skimmer(int16_t df);
 float cw_change_snr(int16_t df);
 float cw_change_peak_beta(int16_t df);
 float cw_change_noise_beta(int16_t df);
+
+#ifdef CW_BENCH
+/* Tone tracker bins of the last hop, dB */
+
+const float * cw_get_bins(uint16_t *start, uint16_t *stop);
+#endif
@@ -9,13 +9,55 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#define CW_DECODER_HIST     10
+
+typedef void (*cw_decoder_text_cb_t)(void *user, const char *text);
+
+/* Decoder of one keyed carrier */
 
 typedef struct {
-    char    *morse;
-    char    *character;
-} cw_characters_t;
+    uint32_t                debounce_factor;
+    uint32_t                thr_mean;
+
+    uint32_t                time_track;
+
+    int32_t                 key_line_event_prev;
+    int32_t                 key_line_event_new;
+    uint32_t                key_line_ref;
+
+    uint32_t                event_hist_index;
+    uint32_t                short_event_hist[CW_DECODER_HIST];
+    uint32_t                long_event_hist[CW_DECODER_HIST];
+    uint32_t                space_event_hist[CW_DECODER_HIST];
+
+    uint64_t                long_event_avr;
+    uint64_t                short_event_avr;
+    uint64_t                space_event_avr;
+
+    uint16_t                wpm_old;
+    uint32_t                wpm;
+
+    uint32_t                space_duration;
+    uint32_t                space_duration_prev;
+    uint32_t                space_duration_ref;
+
+    uint32_t                word_space_duration;
+    uint32_t                word_space_duration_ref;
+    float                   word_space_timing;
+
+    bool                    key_line;
+
+    float                   compare_factor;
+
+    bool                    character_step;
+    bool                    word_step;
+    uint16_t                elements;
 
-extern cw_characters_t cw_characters[];
+    cw_decoder_text_cb_t    text_cb;
+    void                    *user;
+} cw_decoder_t;
 
-void cw_decoder_init();
-void cw_decoder_signal(bool on, float ms);
+void cw_decoder_init(cw_decoder_t *decoder, cw_decoder_text_cb_t text_cb, void *user);
+void cw_decoder_signal(cw_decoder_t *decoder, bool on, float ms);
@@ -12,7 +12,7 @@
 #include <pthread.h>
 #include "lvgl/lvgl.h"
 
-#include "cw_decoder.h"
+#include "morse.h"
 #include "cw_encoder.h"
 #include "params.h"
 #include "radio.h"
@@ -25,25 +25,7 @@ static pthread_t            thread;
 static char                 *current_msg = NULL;
 static char                 *current_char = NULL;
 
-static uint8_t get_morse(char *str, char **morse) {
-    cw_characters_t *character = &cw_characters[0];
-
-    while (character->morse) {
-        uint8_t char_len = strlen(character->character);
-        
-        if (strncasecmp(character->character, str, char_len) == 0) {
-            *morse = character->morse;
-
-            return char_len;
-        }
-        
-        character++;
-    }
-    
-    return 0;
-}
-
-static void send_morse(char *str, uint32_t dit, uint32_t dah) {
+static void send_morse(const char *str, uint32_t dit, uint32_t dah) {
     while (*str) {
         switch (*str) {
             case '.':
@@ -77,14 +59,14 @@ static void * endecode_thread(void *arg) {
     uint32_t    dah = dit * params.key_ratio / 10;
 
     while (true) {
-        char    *morse;
-        uint8_t len;
+        const char  *morse;
+        uint8_t     len;
 
         if (*current_char == ' ') {
             current_char++;
             usleep(dit * (7 - 3));
         } else {
-            len = get_morse(current_char, &morse);
+            len = morse_encode(current_char, &morse);
         
             if (len) {
                 send_morse(morse, dit, dah);
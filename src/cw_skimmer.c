@@ -0,0 +1,235 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "cw_skimmer.h"
+#include "cw_decoder.h"
+#include "params.h"
+#include "radio.h"
+#include "pannel.h"
+#include "util.h"
+#include "meter.h"
+
+#define MAX_BINS        256
+#define HOLD_DECAY      0.01f   /* dB per ms */
+#define IDLE_MS         10000
+#define SPACING         2       /* Bins between channels */
+#define WORD_LEN        16
+
+/*
+ * Every tone tracker bin is a channel of the filter bank. A carrier that stands out
+ * above the noise gets a decoder from the pool, and gives it back after IDLE_MS of silence
+ */
+
+typedef struct {
+    bool            active;
+    uint16_t        bin;
+    float           peak;
+    bool            on;
+    float           idle_ms;
+    cw_decoder_t    decoder;
+    char            word[WORD_LEN + 1];
+    uint8_t         word_len;
+    char            last_call[WORD_LEN + 1];
+} channel_t;
+
+static channel_t    channels[CW_SKIMMER_CHANNELS];
+static float        hold_db[MAX_BINS];
+static int16_t      bin_channel[MAX_BINS];
+static float        bin_hz;
+
+/* Prefix of up to 3 characters with a letter, the last digit, then 1 to 4 letters. An optional /suffix */
+
+static bool is_callsign(const char *word) {
+    size_t  len = strcspn(word, "/");
+    int16_t digit = -1;
+    bool    letter = false;
+
+    for (size_t i = 0; i < len; i++) {
+        if (isdigit(word[i])) {
+            digit = i;
+        } else if (isalpha(word[i])) {
+            if (digit < 0) {
+                letter = true;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    if (digit < 1 || digit > 3 || len - digit - 1 < 1 || len - digit - 1 > 4) {
+        return false;
+    }
+
+    return letter;
+}
+
+static uint64_t channel_freq(const channel_t *channel) {
+    uint64_t    freq = params_band.vfo_x[params_band.vfo].freq;
+    int32_t     offset = channel->bin * bin_hz - params.key_tone;
+
+    return radio_current_mode() == x6100_mode_cwr ? freq - offset : freq + offset;
+}
+
+static void channel_word(channel_t *channel) {
+    if (channel->word_len == 0) {
+        return;
+    }
+
+    channel->word[channel->word_len] = 0;
+    channel->word_len = 0;
+
+    if (!is_callsign(channel->word) || strcmp(channel->word, channel->last_call) == 0) {
+        return;
+    }
+
+    char        str[64];
+    uint64_t    freq = channel_freq(channel);
+    uint16_t    mhz, khz, hz;
+
+    split_freq(freq, &mhz, &khz, &hz);
+    snprintf(str, sizeof(str), "%i.%03i.%i %s", mhz, khz, hz / 100, channel->word);
+    strcpy(channel->last_call, channel->word);
+
+    pannel_add_text("\n");
+    pannel_add_text(str);
+}
+
+static void channel_text_cb(void *user, const char *text) {
+    channel_t *channel = (channel_t *) user;
+
+    if (text[0] == ' ') {
+        channel_word(channel);
+        return;
+    }
+
+    size_t len = strlen(text);
+
+    if (channel->word_len + len <= WORD_LEN) {
+        memcpy(&channel->word[channel->word_len], text, len);
+        channel->word_len += len;
+    }
+}
+
+static void channel_release(channel_t *channel) {
+    channel_word(channel);
+    bin_channel[channel->bin] = -1;
+    channel->active = false;
+}
+
+void cw_skimmer_init(float hz) {
+    bin_hz = hz;
+    cw_skimmer_reset();
+}
+
+void cw_skimmer_reset() {
+    memset(channels, 0, sizeof(channels));
+
+    for (uint16_t i = 0; i < MAX_BINS; i++) {
+        hold_db[i] = S_MIN;
+        bin_channel[i] = -1;
+    }
+}
+
+static bool near_channel(uint16_t bin) {
+    for (int16_t i = bin - SPACING; i <= bin + SPACING; i++)
+        if (i >= 0 && i < MAX_BINS && bin_channel[i] >= 0) {
+            return true;
+        }
+
+    return false;
+}
+
+static void channel_start(uint16_t bin, float noise_db) {
+    for (uint8_t i = 0; i < CW_SKIMMER_CHANNELS; i++) {
+        channel_t *channel = &channels[i];
+
+        if (!channel->active) {
+            memset(channel, 0, sizeof(channel_t));
+
+            channel->active = true;
+            channel->bin = bin;
+            channel->peak = noise_db;
+            cw_decoder_init(&channel->decoder, channel_text_cb, channel);
+
+            bin_channel[bin] = i;
+            return;
+        }
+    }
+}
+
+void cw_skimmer_process(const float *bin_db, uint16_t bin_start, uint16_t bin_stop, float noise_db, float ms) {
+    float snr_max = params.cw_decoder_snr;
+    float snr_min = params.cw_decoder_snr - params.cw_decoder_snr_gist;
+
+    /* Carriers: decaying peak hold above the noise, local maximum */
+
+    for (uint16_t k = bin_start; k < bin_stop; k++) {
+        float db = bin_db[k];
+
+        hold_db[k] -= HOLD_DECAY * ms;
+
+        if (db > hold_db[k]) {
+            hold_db[k] = db;
+        }
+    }
+
+    for (uint16_t k = bin_start + 1; k < bin_stop - 1; k++) {
+        if (hold_db[k] - noise_db < snr_max || hold_db[k] < hold_db[k - 1] || hold_db[k] < hold_db[k + 1]) {
+            continue;
+        }
+
+        if (!near_channel(k)) {
+            channel_start(k, noise_db);
+        }
+    }
+
+    /* Channels */
+
+    for (uint8_t i = 0; i < CW_SKIMMER_CHANNELS; i++) {
+        channel_t *channel = &channels[i];
+
+        if (!channel->active) {
+            continue;
+        }
+
+        if (channel->bin < bin_start || channel->bin >= bin_stop) {
+            channel_release(channel);
+            continue;
+        }
+
+        lpf(&channel->peak, bin_db[channel->bin], params.cw_decoder_peak_beta);
+
+        float snr = channel->peak - noise_db;
+
+        if (channel->on) {
+            if (snr < snr_min) {
+                channel->on = false;
+            }
+        } else {
+            if (snr > snr_max) {
+                channel->on = true;
+            }
+        }
+
+        cw_decoder_signal(&channel->decoder, channel->on, ms);
+
+        if (channel->on) {
+            channel->idle_ms = 0;
+        } else {
+            channel->idle_ms += ms;
+
+            if (channel->idle_ms > IDLE_MS) {
+                channel_release(channel);
+            }
+        }
+    }
+}
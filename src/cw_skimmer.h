@@ -0,0 +1,21 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CW_SKIMMER_CHANNELS 8
+
+void cw_skimmer_init(float bin_hz);
+void cw_skimmer_reset();
+
+/* Every hop of the CW tone tracker: bins power in dB, passband noise in dB */
+
+void cw_skimmer_process(const float *bin_db, uint16_t bin_start, uint16_t bin_stop, float noise_db, float ms);
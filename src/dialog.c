@@ -96,7 +96,11 @@ void dialog_item(dialog_t *dialog, lv_obj_t *obj) {
     }
 }
 
-void dialog_audio_samples(unsigned int n, float complex *samples) {
+bool dialog_audio_enabled() {
+    return dialog_is_run() && current_dialog->audio_cb;
+}
+
+void dialog_audio_samples(unsigned int n, const float complex *samples) {
     if (dialog_is_run() && current_dialog->audio_cb) {
         current_dialog->audio_cb(n, samples);
     }
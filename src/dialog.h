@@ -13,7 +13,7 @@
 
 typedef void (*dialog_construct_cb_t)(lv_obj_t *);
 typedef void (*dialog_destruct_cb_t)(void);
-typedef void (*dialog_audio_cb_t)(unsigned int n, float complex *samples);
+typedef void (*dialog_audio_cb_t)(unsigned int n, const float complex *samples);
 typedef void (*dialog_rotary_cb_t)(int32_t diff);
 
 typedef struct {
@@ -36,5 +36,6 @@ bool dialog_is_run();
 lv_obj_t * dialog_init(lv_obj_t *parent);
 void dialog_item(dialog_t *dialog, lv_obj_t *obj);
 
-void dialog_audio_samples(unsigned int n, float complex *samples);
+bool dialog_audio_enabled();
+void dialog_audio_samples(unsigned int n, const float complex *samples);
 void dialog_rotary(int32_t diff);
@@ -7,6 +7,7 @@
  */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -14,6 +15,7 @@
 #include <time.h>
 #include <sys/time.h>
 #include <pthread.h>
+#include <stdatomic.h>
 
 #include "lvgl/lvgl.h"
 #include "dialog.h"
@@ -43,17 +45,11 @@
 #include "ft8/encode.h"
 #include "ft8/crc.h"
 #include "gfsk.h"
+#include "ft8_rx.h"
 
 #define DECIM           4
 #define SAMPLE_RATE     (AUDIO_CAPTURE_RATE / DECIM)
 
-#define MIN_SCORE       10
-#define MAX_CANDIDATES  120
-#define LDPC_ITER       20
-#define MAX_DECODED     50
-#define FREQ_OSR        2
-#define TIME_OSR        4
-
 #define FT8_BANDS       11
 #define FT4_BANDS       9
 
@@ -102,8 +98,8 @@ typedef struct {
 } ft8_cell_t;
 
 typedef struct {
-    char            *msg;
-    ft8_cell_t      *cell;
+    ft8_cell_t      cell;
+    char            msg[128];
 } ft8_msg_t;
 
 typedef struct {
@@ -142,32 +138,21 @@ static pthread_cond_t       audio_cond;
 static pthread_mutex_t      audio_mutex;
 static cbuffercf            audio_buf;
 static pthread_t            thread;
+static atomic_bool          thread_run;
+static bool                 tx_done;        /* Under audio_mutex */
 
 static firdecim_crcf        decim;
 static float complex        *decim_buf;
-static complex float        *rx_window = NULL;
-static complex float        *time_buf;
-static complex float        *freq_buf;
-static windowcf             frame_window;
-static fftplan              fft;
-
-static float                symbol_period;
-static uint32_t             block_size;
-static uint32_t             subblock_size;
-static uint16_t             nfft;
-static float                fft_norm;
-static waterfall_t          wf;
-
-static candidate_t          candidate_list[MAX_CANDIDATES];
-static message_t            decoded[MAX_DECODED];
-static message_t*           decoded_hashtable[MAX_DECODED];
+
+static ft8_rx_t             rx;
+static ft8_rx_result_t      decoded[FT8_RX_MAX_DECODED];
 
 static struct tm            timestamp;
 
 static void construct_cb(lv_obj_t *parent);
 static void key_cb(lv_event_t * e);
 static void destruct_cb();
-static void audio_cb(unsigned int n, float complex *samples);
+static void audio_cb(unsigned int n, const float complex *samples);
 static void rotary_cb(int32_t diff);
 static void * decode_thread(void *arg);
 
@@ -215,67 +200,15 @@ static dialog_t             dialog = {
 dialog_t                    *dialog_ft8 = &dialog;
 
 static void reset() {
-    wf.num_blocks = 0;
+    ft8_rx_reset(&rx);
     state = IDLE;
 }
 
 static void init() {
     /* FT8 decoder */
 
-    float   slot_time;
-    
-    switch (params.ft8_protocol) {
-        case PROTO_FT4:
-            slot_time = FT4_SLOT_TIME;
-            symbol_period = FT4_SYMBOL_PERIOD;
-            break;
-            
-        case PROTO_FT8:
-            slot_time = FT8_SLOT_TIME;
-            symbol_period = FT8_SYMBOL_PERIOD;
-            break;
-    }
-    
-    block_size = SAMPLE_RATE * symbol_period;
-    subblock_size = block_size / TIME_OSR;
-    nfft = block_size * FREQ_OSR;
-    fft_norm = 2.0f / nfft;
-    
-    const uint32_t max_blocks = slot_time / symbol_period;
-    const uint32_t num_bins = SAMPLE_RATE * symbol_period / 2;
-
-    size_t mag_size = max_blocks * TIME_OSR * FREQ_OSR * num_bins * sizeof(uint8_t);
-    
-    wf.max_blocks = max_blocks;
-    wf.num_bins = num_bins;
-    wf.time_osr = TIME_OSR;
-    wf.freq_osr = FREQ_OSR;
-    wf.block_stride = TIME_OSR * FREQ_OSR * num_bins;
-    wf.mag = (uint8_t *) malloc(mag_size);
-    wf.protocol = params.ft8_protocol;
-
-    /* FT8 DSP */
-    
-    decim_buf = (float complex *) malloc(block_size * sizeof(float complex));
-    time_buf = (float complex*) malloc(nfft * sizeof(float complex));
-    freq_buf = (float complex*) malloc(nfft * sizeof(float complex));
-    fft = fft_create_plan(nfft, time_buf, freq_buf, LIQUID_FFT_FORWARD, 0);
-    frame_window = windowcf_create(nfft);
-
-    rx_window = malloc(nfft * sizeof(complex float));
-
-    for (uint16_t i = 0; i < nfft; i++)
-        rx_window[i] = liquid_hann(i, nfft);
-
-    float gain = 0.0f;
-
-    for (uint16_t i = 0; i < nfft; i++)
-        gain += rx_window[i] * rx_window[i];
-        
-    gain = 1.0f / sqrtf(gain);
-
-    for (uint16_t i = 0; i < nfft; i++)
-        rx_window[i] *= gain;
+    ft8_rx_init(&rx, params.ft8_protocol, SAMPLE_RATE);
+    decim_buf = (float complex *) malloc(rx.block_size * sizeof(float complex));
 
     qso = QSO_IDLE;
 
@@ -283,7 +216,7 @@ static void init() {
 
     /* Waterfall */
 
-    waterfall_nfft = block_size * 2;
+    waterfall_nfft = rx.block_size * 2;
 
     waterfall_sg = spgramcf_create(waterfall_nfft, LIQUID_WINDOW_HANN, waterfall_nfft, waterfall_nfft / 4);
     waterfall_psd = (float *) malloc(waterfall_nfft * sizeof(float));
@@ -293,44 +226,56 @@ static void init() {
         
     pthread_mutex_init(&audio_mutex, NULL);
     pthread_cond_init(&audio_cond, NULL);
+    thread_run = true;
     pthread_create(&thread, NULL, decode_thread, NULL);
 }
 
+/* TX is cut short by the state and the flush, RX wakes up on the broadcast */
+
 static void done() {
+    thread_run = false;
     state = IDLE;
 
-    pthread_cancel(thread);
-    pthread_join(thread, NULL);
+    audio_play_flush();
 
-    free(wf.mag);
-    windowcf_destroy(frame_window);
+    pthread_mutex_lock(&audio_mutex);
+    pthread_cond_broadcast(&audio_cond);
+    pthread_mutex_unlock(&audio_mutex);
+
+    pthread_join(thread, NULL);
 
+    ft8_rx_done(&rx);
     free(decim_buf);
-    free(time_buf);
-    free(freq_buf);
-    fft_destroy_plan(fft);
 
     spgramcf_destroy(waterfall_sg);
     free(waterfall_psd);
+}
+
+/* Decodes come in bursts, the decode thread gives the UI a few ms to drain the queue before losing one */
+
+static void send_msg(ft8_msg_t *msg) {
+    uint8_t tries = pthread_equal(pthread_self(), thread) ? 20 : 1;
 
-    free(rx_window);
+    for (uint8_t i = 0; i < tries; i++) {
+        if (event_send_data(table, EVENT_FT8_MSG, msg, offsetof(ft8_msg_t, msg) + strlen(msg->msg) + 1)) {
+            return;
+        }
+
+        usleep(1000);
+    }
+
+    LV_LOG_WARN("Event queue is full, FT8 message dropped: %s", msg->msg);
 }
 
 static void send_info(const char * fmt, ...) {
     va_list     args;
-    char        buf[128];
-    ft8_msg_t   *msg = malloc(sizeof(ft8_msg_t));
+    ft8_msg_t   msg = { .cell.type = MSG_RX_INFO };
 
     va_start(args, fmt);
-    vsnprintf(buf, sizeof(buf), fmt, args);
+    vsnprintf(msg.msg, sizeof(msg.msg), fmt, args);
     va_end(args);
 
-    msg->msg = strdup(buf);
-
-    msg->cell = lv_mem_alloc(sizeof(ft8_cell_t));
-    msg->cell->type = MSG_RX_INFO;
-
-    event_send(table, EVENT_FT8_MSG, msg);
+    send_msg(&msg);
 }
 
 static const char * find_qth(const char *str) {
@@ -369,80 +314,76 @@ static void send_rx_text(int16_t snr, const char * text) {
         }
     }
 
-    ft8_msg_t *msg = malloc(sizeof(ft8_msg_t));
-
-    msg->msg = strdup(text);
+    ft8_msg_t msg = {
+        .cell.snr = snr,
+        .cell.type = type,
+        .cell.odd = odd
+    };
 
-    msg->cell = lv_mem_alloc(sizeof(ft8_cell_t));
-    msg->cell->snr = snr;
-    msg->cell->type = type;
-    msg->cell->odd = odd;
+    strncpy(msg.msg, text, sizeof(msg.msg) - 1);
 
     if (params.qth.x[0] != 0) {
         const char *qth = find_qth(text);
             
-        msg->cell->dist = qth ? grid_dist(qth) : 0;
+        msg.cell.dist = qth ? grid_dist(qth) : 0;
     } else {
-        msg->cell->dist = 0;
+        msg.cell.dist = 0;
     }
 
-    event_send(table, EVENT_FT8_MSG, msg);
+    send_msg(&msg);
 }
 
 static void send_tx_text(const char * text) {
-    ft8_msg_t   *msg = malloc(sizeof(ft8_msg_t));
+    ft8_msg_t   msg = { .cell.type = MSG_TX_MSG };
 
-    msg->msg = strdup(text);
+    strncpy(msg.msg, text, sizeof(msg.msg) - 1);
+    send_msg(&msg);
+}
+
+static uint64_t slot_period_ms() {
+    return (params.ft8_protocol == PROTO_FT4) ? 7500 : 15000;
+}
+
+static uint64_t get_time_real() {
+    struct timespec now;
 
-    msg->cell = lv_mem_alloc(sizeof(ft8_cell_t));
-    msg->cell->type = MSG_TX_MSG;
+    clock_gettime(CLOCK_REALTIME, &now);
 
-    event_send(table, EVENT_FT8_MSG, msg);
+    return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
 }
 
-static void decode() {
-    uint16_t    num_candidates = ft8_find_sync(&wf, MAX_CANDIDATES, candidate_list, MIN_SCORE);
+/* To the end of the slot starting nearest to now. Slots are aligned to the minute, TX may start a bit early */
 
-    memset(decoded_hashtable, 0, sizeof(decoded_hashtable));
-    memset(decoded, 0, sizeof(decoded));
-    
-    for (uint16_t idx = 0; idx < num_candidates; idx++) {
-        const candidate_t *cand = &candidate_list[idx];
-        
-        if (cand->score < MIN_SCORE)
-            continue;
-            
-        float freq_hz = (cand->freq_offset + (float) cand->freq_sub / wf.freq_osr) / symbol_period;
-        float time_sec = (cand->time_offset + (float) cand->time_sub / wf.time_osr) * symbol_period;
-        
-        message_t       message;
-        decode_status_t status;
-        
-        if (!ft8_decode(&wf, cand, &message, LDPC_ITER, &status)) {
-            continue;
-        }
-        
-        uint16_t    idx_hash = message.hash % MAX_DECODED;
-        bool        found_empty_slot = false;
-        bool        found_duplicate = false;
-        
-        do {
-            if (decoded_hashtable[idx_hash] == NULL) {
-                found_empty_slot = true;
-            } else if (decoded_hashtable[idx_hash]->hash == message.hash && strcmp(decoded_hashtable[idx_hash]->text, message.text) == 0) {
-                found_duplicate = true;
-            } else {
-                idx_hash = (idx_hash + 1) % MAX_DECODED;
-            }
-        } while (!found_empty_slot && !found_duplicate);
+static uint32_t slot_left_ms() {
+    uint64_t period = slot_period_ms();
+    uint64_t ms = get_time_real();
 
-        if (found_empty_slot) {
-            memcpy(&decoded[idx_hash], &message, sizeof(message));
-            decoded_hashtable[idx_hash] = &decoded[idx_hash];
+    return (ms + period / 2) / period * period + period - ms;
+}
 
-            send_rx_text(cand->snr, message.text);
-        }
+/*
+ * Time for subtraction passes: up to the configured budget, so that the next slot starts at most a second late.
+ * Audio of the next slot is buffered meanwhile, so never more than the buffer takes
+ */
+
+static uint32_t decode_budget() {
+    uint64_t    period = slot_period_ms();
+    uint64_t    ms = get_time_real();
+    uint64_t    deadline = (ms + period / 2) / period * period + 1000;
+    uint64_t    budget = deadline > ms ? deadline - ms : 0;
+
+    if (budget > FT8_BUDGET_MAX_MS) {
+        budget = FT8_BUDGET_MAX_MS;
     }
+
+    return budget < params.ft8_budget.x ? budget : params.ft8_budget.x;
+}
+
+static void decode() {
+    uint16_t num = ft8_rx_decode(&rx, decoded, FT8_RX_MAX_DECODED, decode_budget());
+
+    for (uint16_t i = 0; i < num; i++)
+        send_rx_text(decoded[i].snr, decoded[i].message.text);
 }
 
 void static waterfall_process(float complex *frame, const size_t size) {
@@ -464,44 +405,6 @@ void static waterfall_process(float complex *frame, const size_t size) {
     }
 }
 
-void static process(float complex *frame) {
-    complex float   *frame_ptr;
-    int             offset = wf.num_blocks * wf.block_stride;
-    int             frame_pos = 0;
-    
-    for (int time_sub = 0; time_sub < wf.time_osr; time_sub++) {
-        windowcf_write(frame_window, &frame[frame_pos], subblock_size);
-        frame_pos += subblock_size;
-
-        windowcf_read(frame_window, &frame_ptr);
-        
-        for (uint32_t pos = 0; pos < nfft; pos++)
-            time_buf[pos] = rx_window[pos] * frame_ptr[pos];
-
-        fft_execute(fft);
-                
-        for (int freq_sub = 0; freq_sub < wf.freq_osr; freq_sub++)
-            for (int bin = 0; bin < wf.num_bins; bin++) {
-                int             src_bin = (bin * wf.freq_osr) + freq_sub;
-                complex float   freq = freq_buf[src_bin];
-                float           v = crealf(freq * conjf(freq));
-                float           db = 10.0f * log10f(v);
-                int             scaled = (int16_t) (db * 2.0f + 240.0f);
-                
-                if (scaled < 0) {
-                    scaled = 0;
-                } else if (scaled > 255) {
-                    scaled = 255;
-                }
-
-                wf.mag[offset] = scaled;
-                offset++;
-            }
-    }
-    
-    wf.num_blocks++;
-}
-
 static bool do_start(bool *odd) {
     struct tm       *tm;
     time_t          now;
@@ -564,35 +467,44 @@ static bool do_start(bool *odd) {
 static void rx_worker(bool sync) {
     unsigned int    n;
     float complex   *buf;
-    const size_t    size = block_size * DECIM;
+    const size_t    size = rx.block_size * DECIM;
 
     pthread_mutex_lock(&audio_mutex);
 
-    while (cbuffercf_size(audio_buf) < size) {
+    while (thread_run && cbuffercf_size(audio_buf) < size) {
         pthread_cond_wait(&audio_cond, &audio_mutex);
     }
     
     pthread_mutex_unlock(&audio_mutex);
+
+    if (!thread_run) {
+        return;
+    }
         
     while (cbuffercf_size(audio_buf) > size) {
         cbuffercf_read(audio_buf, size, &buf, &n);
 
-        firdecim_crcf_execute_block(decim, buf, block_size, decim_buf);
+        firdecim_crcf_execute_block(decim, buf, rx.block_size, decim_buf);
         cbuffercf_release(audio_buf, size);
 
-        waterfall_process(decim_buf, block_size);
+        waterfall_process(decim_buf, rx.block_size);
 
-        if (sync) {
-            process(decim_buf);
-    
-            if (wf.num_blocks >= wf.max_blocks) {
-                decode();
-                reset();
-            }
+        if (sync && ft8_rx_process(&rx, decim_buf)) {
+            decode();
+            reset();
         }
     }
 }
 
+/* Audio thread, at the end of the transmission */
+
+static void tx_done_cb(void *user) {
+    pthread_mutex_lock(&audio_mutex);
+    tx_done = true;
+    pthread_cond_broadcast(&audio_cond);
+    pthread_mutex_unlock(&audio_mutex);
+}
+
 static void tx_worker() {
     uint8_t tones[FT8_NN];
     uint8_t packed[FTX_LDPC_K_BYTES];
@@ -608,14 +520,34 @@ static void tx_worker() {
 
     int32_t     n_samples = 0;
     float       symbol_bt = (params.ft8_protocol == PROTO_FT4) ? FT4_SYMBOL_BT : FT8_SYMBOL_BT;
-    int16_t     *samples = gfsk_synth(tones, FT8_NN, params.ft8_tx_freq.x, symbol_bt, symbol_period, &n_samples);
+    int16_t     *samples = gfsk_synth(tones, FT8_NN, params.ft8_tx_freq.x, symbol_bt, rx.symbol_period, AUDIO_PLAY_RATE, &n_samples);
     int16_t     *ptr = samples;
     size_t      part = 1024 * 2;
 
+    uint64_t    slot_end = get_time() + slot_left_ms();
+
     radio_set_ptt(true);
 
     while (true) {
-        if (n_samples <= 0 || state != TX_PROCESS) {
+        if (n_samples <= 0) {
+            state = IDLE;
+            break;
+        }
+
+        if (state != TX_PROCESS) {
+            state = IDLE;
+            audio_play_flush();
+            break;
+        }
+
+        if (part > n_samples) {
+            part = n_samples;
+        }
+
+        /* A late start must not spill into the next slot */
+
+        if (get_time() + audio_play_latency() + part * 1000 / AUDIO_PLAY_RATE > slot_end) {
+            LV_LOG_WARN("TX cut at the slot end");
             state = IDLE;
             break;
         }
@@ -626,16 +558,28 @@ static void tx_worker() {
         ptr += part;
     }
 
-    audio_play_wait();
+    /* Whatever is queued plays out, done() flushes it */
+
+    pthread_mutex_lock(&audio_mutex);
+    tx_done = false;
+    pthread_mutex_unlock(&audio_mutex);
+
+    audio_play_done(tx_done_cb, NULL);
+
+    pthread_mutex_lock(&audio_mutex);
+
+    while (!tx_done && thread_run) {
+        pthread_cond_wait(&audio_cond, &audio_mutex);
+    }
+
+    pthread_mutex_unlock(&audio_mutex);
+
     radio_set_ptt(false);
     free(samples);
 }
 
 static void * decode_thread(void *arg) {
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
-    
-    while (true) {
+    while (thread_run) {
         switch (state) {
             case IDLE:
                 if (do_start(&odd)) {
@@ -710,21 +654,21 @@ static void add_msg_cb(lv_event_t * e) {
     }
 #endif
 
+    ft8_cell_t  *cell = lv_mem_alloc(sizeof(ft8_cell_t));
+
+    *cell = msg->cell;
+
     lv_table_set_cell_value(table, table_rows, 0, msg->msg);
-    
-    if (msg->cell) {
-        lv_table_set_cell_user_data(table, table_rows, 0, msg->cell);
+    lv_table_set_cell_user_data(table, table_rows, 0, cell);
         
-        if (params.ft8_auto.x && (msg->cell->type == MSG_RX_TO_ME)) {
-            do_rx_msg(msg->cell, msg->msg, false);
-        }
+    if (params.ft8_auto.x && (cell->type == MSG_RX_TO_ME)) {
+        do_rx_msg(cell, msg->msg, false);
     }
     
     if (scroll) {
-        int32_t *c = malloc(sizeof(int32_t));
-        *c = LV_KEY_DOWN;
+        int32_t c = LV_KEY_DOWN;
         
-        lv_event_send(table, LV_EVENT_KEY, c);
+        lv_event_send(table, LV_EVENT_KEY, &c);
     }
     
     table_rows++;
@@ -842,7 +786,8 @@ static void key_cb(lv_event_t * e) {
 
 static void destruct_cb() {
     done();
-    
+    ft8_rx_pool_done();
+
     firdecim_crcf_destroy(decim);
     free(audio_buf);
 
@@ -889,10 +834,9 @@ static void clean() {
 
     table_rows = 0;
 
-    int32_t *c = malloc(sizeof(int32_t));
-    *c = LV_KEY_UP;
+    int32_t c = LV_KEY_UP;
         
-    lv_event_send(table, LV_EVENT_KEY, c);
+    lv_event_send(table, LV_EVENT_KEY, &c);
 }
 
 static void make_tx_msg(ft8_tx_msg_t msg, int16_t snr) {
@@ -1112,7 +1056,8 @@ static void construct_cb(lv_obj_t *parent) {
     lv_obj_add_event_cb(dialog.obj, band_cb, EVENT_BAND_DOWN, NULL);
 
     decim = firdecim_crcf_create_kaiser(DECIM, 16, 40.0f);
-    audio_buf = cbuffercf_create(AUDIO_CAPTURE_RATE);
+    ft8_rx_pool_init(0);
+    audio_buf = cbuffercf_create(AUDIO_CAPTURE_RATE * FT8_AUDIO_BUF_MS / 1000);
 
     /* Waterfall */
 
@@ -1352,10 +1297,10 @@ static void tx_call_en_cb(lv_event_t * e) {
     qso = QSO_IDLE;
 }
 
-static void audio_cb(unsigned int n, float complex *samples) {
+static void audio_cb(unsigned int n, const float complex *samples) {
     if (state == IDLE || state == RX_PROCESS) {
         pthread_mutex_lock(&audio_mutex);
-        cbuffercf_write(audio_buf, samples, n);
+        cbuffercf_write(audio_buf, (float complex *) samples, n);
         pthread_cond_broadcast(&audio_cond);
         pthread_mutex_unlock(&audio_mutex);
     }
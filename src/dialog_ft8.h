@@ -10,4 +10,7 @@
 
 #include "dialog.h"
 
+#define FT8_AUDIO_BUF_MS    4000                        /* Audio held while decoding */
+#define FT8_BUDGET_MAX_MS   (FT8_AUDIO_BUF_MS - 1000)   /* Decode budget leaves a second of it free */
+
 extern dialog_t *dialog_ft8;
@@ -140,10 +140,10 @@ char *deg_to_str2(deg_str_type type, double f, char *buf, unsigned int buf_size,
 }
 
 static void gps_cb(lv_event_t * e) {
-    struct gps_data_t   *msg = lv_event_get_param(e);
+    gps_msg_t           *msg = lv_event_get_param(e);
     char                str[64];
 
-    switch (msg->fix.mode) {
+    switch (msg->mode) {
         case MODE_3D:
             lv_label_set_text(fix, "3D");
             break;
@@ -160,25 +160,25 @@ static void gps_cb(lv_event_t * e) {
             break;
     }
 
-    timespec_to_iso8601(msg->fix.time, str, sizeof(str));
+    timespec_to_iso8601(msg->time, str, sizeof(str));
     lv_label_set_text(date, str);
 
-    if (msg->fix.mode >= MODE_2D) {
-        deg_to_str2(deg_type, msg->fix.latitude, str, sizeof(str), "N", "S");
+    if (msg->mode >= MODE_2D) {
+        deg_to_str2(deg_type, msg->latitude, str, sizeof(str), "N", "S");
         lv_label_set_text(lat, str);
     } else {
         lv_label_set_text(lat, "N/A");
     }
 
-    if (msg->fix.mode >= MODE_2D) {
-        deg_to_str2(deg_type, msg->fix.longitude, str, sizeof(str), "E", "W");
+    if (msg->mode >= MODE_2D) {
+        deg_to_str2(deg_type, msg->longitude, str, sizeof(str), "E", "W");
         lv_label_set_text(lon, str);
     } else {
         lv_label_set_text(lon, "N/A");
     }
     
-    if (msg->fix.mode >= MODE_2D) {
-        lv_label_set_text(qth, pos_grid(msg->fix.latitude, msg->fix.longitude));
+    if (msg->mode >= MODE_2D) {
+        lv_label_set_text(qth, pos_grid(msg->latitude, msg->longitude));
     } else {
         lv_label_set_text(qth, "N/A");
     }
@@ -53,6 +53,7 @@ static SNDFILE              *file = NULL;
 static char                 *prev_filename;
 static pthread_t            thread;
 static int16_t              samples_buf[BUF_SIZE];
+static int16_t              rec_buf[BUF_SIZE];
 
 static void construct_cb(lv_obj_t *parent);
 static void destruct_cb();
@@ -178,17 +179,18 @@ static void play_item() {
         int res = sf_read_short(file, samples_buf, BUF_SIZE);
             
         if (res > 0) {
-            int16_t *samples = audio_gain(samples_buf, res, params.play_gain);
-        
-            audio_play(samples, res);
-            free(samples);
+            audio_gain(samples_buf, samples_buf, res, params.play_gain / 100.0f);
+            audio_play(samples_buf, res);
         } else {
             state = MSG_VOICE_OFF;
+            sf_close(file);
+            audio_play_wait();
+            return;
         }
     }
 
     sf_close(file);
-    audio_play_wait();
+    audio_play_flush();
 }
 
 static void * play_thread(void *arg) {
@@ -502,19 +504,24 @@ msg_voice_state_t dialog_msg_voice_get_state() {
 }
 
 void dialog_msg_voice_put_audio_samples(size_t nsamples, int16_t *samples) {
-    int16_t *out_samples = audio_gain(samples, nsamples, params.rec_gain * 6);
     int16_t peak = 0;
-    
-    for (uint16_t i = 0; i < nsamples; i++) {
-        int16_t x = abs(out_samples[i]);
-        
+
+    while (nsamples > 0) {
+        size_t n = nsamples < BUF_SIZE ? nsamples : BUF_SIZE;
+
+        audio_gain(samples, rec_buf, n, params.rec_gain * 6 / 100.0f);
+
+        int16_t x = audio_peak(rec_buf, n);
+
         if (x > peak) {
             peak = x;
         }
+
+        sf_write_short(file, rec_buf, n);
+        samples += n;
+        nsamples -= n;
     }
 
     peak = S1 + (peak / 32768.0) * (S9_40 - S1);
     meter_update(peak, 0.25f);
-    sf_write_short(file, out_samples, nsamples);
-    free(out_samples);
 }
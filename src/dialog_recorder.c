@@ -20,6 +20,7 @@
 #include "lvgl/lvgl.h"
 #include "audio.h"
 #include "recorder.h"
+#include "iq_recorder.h"
 #include "dialog.h"
 #include "dialog_recorder.h"
 #include "styles.h"
@@ -35,6 +36,8 @@
 #define BUF_SIZE 1024
 
 static lv_obj_t             *table;
+static lv_obj_t             *status;
+static lv_timer_t           *status_timer = NULL;
 static int16_t              table_rows = 0;
 static SNDFILE              *file = NULL;
 static bool                 play_state = false;
@@ -138,17 +141,18 @@ static void play_item() {
         int res = sf_read_short(file, samples_buf, BUF_SIZE);
             
         if (res > 0) {
-            int16_t *samples = audio_gain(samples_buf, res, params.play_gain);
-            
-            audio_play(samples, res);
-            free(samples);
+            audio_gain(samples_buf, samples_buf, res, params.play_gain / 100.0f);
+            audio_play(samples_buf, res);
         } else {
             play_state = false;
+            sf_close(file);
+            audio_play_wait();
+            return;
         }
     }
 
     sf_close(file);
-    audio_play_wait();
+    audio_play_flush();
 }
 
 static void * play_thread(void *arg) {
@@ -161,8 +165,29 @@ static void * play_thread(void *arg) {
 
     if (dialog.run) {
         buttons_unload_page();
-        buttons_load_page(PAGE_RECORDER);
+        buttons_load_page(PAGE_RECORDER_1);
+    }
+}
+
+static void status_update() {
+    if (recorder_is_on()) {
+        uint32_t sec = recorder_samples() / AUDIO_CAPTURE_RATE;
+
+        lv_label_set_text_fmt(status, "REC %02u:%02u:%02u  Overruns %u", sec / 3600, sec / 60 % 60, sec % 60, recorder_overruns());
+    } else if (iq_recorder_is_on()) {
+        lv_label_set_text(status, "IQ REC");
+    } else if (iq_player_is_on()) {
+        lv_label_set_text(status, "IQ PLAY");
+    } else {
+        lv_obj_add_flag(status, LV_OBJ_FLAG_HIDDEN);
+        return;
     }
+
+    lv_obj_clear_flag(status, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void status_timer_cb(lv_timer_t *t) {
+    status_update();
 }
 
 static void textarea_window_close_cb() {
@@ -198,7 +223,7 @@ static void tx_cb(lv_event_t * e) {
         play_state = false;
 
         buttons_unload_page();
-        buttons_load_page(PAGE_RECORDER);
+        buttons_load_page(PAGE_RECORDER_1);
     }
 }
 
@@ -234,6 +259,14 @@ static void construct_cb(lv_obj_t *parent) {
     lv_group_set_editing(keyboard_group, true);
 
     lv_obj_center(table);
+
+    status = lv_label_create(dialog.obj);
+
+    lv_obj_set_style_text_color(status, lv_color_white(), 0);
+    lv_obj_align(status, LV_ALIGN_BOTTOM_RIGHT, -10, -5);
+
+    status_update();
+    status_timer = lv_timer_create(status_timer_cb, 500, NULL);
     
     mkdir(recorder_path, 0755);
     load_table();
@@ -245,6 +278,11 @@ static void construct_cb(lv_obj_t *parent) {
 }
 
 static void destruct_cb() {
+    if (status_timer) {
+        lv_timer_del(status_timer);
+        status_timer = NULL;
+    }
+
     audio_play_en(false);
     play_state = false;
     textarea_window_close();
@@ -315,17 +353,52 @@ void dialog_recorder_delete_cb(lv_event_t * e) {
     }
 }
 
+void dialog_recorder_iq_rec_cb(lv_event_t * e) {
+    iq_recorder_set_on(!iq_recorder_is_on());
+
+    if (!iq_recorder_is_on()) {
+        load_table();
+    }
+
+    status_update();
+}
+
+void dialog_recorder_iq_play_cb(lv_event_t * e) {
+    if (iq_player_is_on()) {
+        iq_player_stop();
+        status_update();
+        return;
+    }
+
+    const char *item = get_item();
+
+    if (!item) {
+        return;
+    }
+
+    char filename[64];
+
+    snprintf(filename, sizeof(filename), "%s/%s", recorder_path, item);
+
+    if (!iq_player_start(filename)) {
+        msg_set_text_fmt("Not an IQ recording");
+    }
+
+    status_update();
+}
+
 void dialog_recorder_set_on(bool on) {
     if (!dialog.run) {
         return;
     }
 
     buttons_unload_page();
+    status_update();
 
     if (on) {
         buttons_load(1, &button_rec_stop);
     } else {
-        buttons_load_page(PAGE_RECORDER);
+        buttons_load_page(PAGE_RECORDER_1);
         load_table();
     }
 }
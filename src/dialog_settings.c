@@ -25,6 +25,7 @@
 #include "keyboard.h"
 #include "clock.h"
 #include "voice.h"
+#include "dialog_ft8.h"
 
 static lv_obj_t     *grid;
 
@@ -1157,6 +1158,28 @@ static uint8_t make_auto(uint8_t row) {
 
     lv_obj_set_width(obj, SMALL_3 - 30);
 
+    /* Antialiasing */
+
+    row++;
+    row_dsc[row] = 54;
+
+    obj = lv_label_create(grid);
+
+    lv_label_set_text(obj, "Spectrum antialiasing");
+    lv_obj_set_grid_cell(obj, LV_GRID_ALIGN_START, 0, 1, LV_GRID_ALIGN_CENTER, row, 1);
+
+    obj = lv_obj_create(grid);
+    
+    lv_obj_set_size(obj, SMALL_3, 56);
+    lv_obj_set_grid_cell(obj, LV_GRID_ALIGN_START, 1, 3, LV_GRID_ALIGN_CENTER, row, 1);
+    lv_obj_set_style_bg_opa(obj, LV_OPA_TRANSP, LV_PART_MAIN);
+    lv_obj_clear_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_center(obj);
+
+    obj = switch_bool(obj, &params.spectrum_aa);
+
+    lv_obj_set_width(obj, SMALL_3 - 30);
+
     return row + 1;
 }
 
@@ -1180,6 +1203,65 @@ static uint8_t make_freq_accel(uint8_t row) {
     return row + 1;
 }
 
+/* FT8 */
+
+static void ft8_budget_update_cb(lv_event_t * e) {
+    lv_obj_t    *obj = lv_event_get_target(e);
+
+    params_uint16_set(&params.ft8_budget, lv_spinbox_get_value(obj));
+}
+
+static uint8_t make_ft8(uint8_t row) {
+    lv_obj_t    *obj;
+
+    row_dsc[row] = 54;
+
+    obj = lv_label_create(grid);
+
+    lv_label_set_text(obj, "FT8 decode time, ms");
+    lv_obj_set_grid_cell(obj, LV_GRID_ALIGN_START, 0, 1, LV_GRID_ALIGN_CENTER, row, 1);
+
+    obj = lv_spinbox_create(grid);
+
+    dialog_item(&dialog, obj);
+
+    lv_spinbox_set_range(obj, 100, FT8_BUDGET_MAX_MS);
+    lv_spinbox_set_digit_format(obj, 4, 0);
+    lv_spinbox_set_step(obj, 100);
+    lv_spinbox_set_value(obj, params.ft8_budget.x);
+    lv_obj_add_event_cb(obj, ft8_budget_update_cb, LV_EVENT_VALUE_CHANGED, NULL);
+
+    lv_obj_set_size(obj, SMALL_2, 56);
+    lv_obj_set_grid_cell(obj, LV_GRID_ALIGN_START, 1, 2, LV_GRID_ALIGN_CENTER, row, 1);
+
+    return row + 1;
+}
+
+static uint8_t make_rec_format(uint8_t row) {
+    lv_obj_t    *obj;
+
+    row_dsc[row] = 54;
+
+    obj = lv_label_create(grid);
+
+    lv_label_set_text(obj, "Rec format");
+    lv_obj_set_grid_cell(obj, LV_GRID_ALIGN_START, 0, 1, LV_GRID_ALIGN_CENTER, row, 1);
+
+    obj = dropdown_uint8(grid, &params.rec_format, " WAV \n FLAC \n MP3");
+
+    lv_obj_set_size(obj, SMALL_3, 56);
+    lv_obj_set_grid_cell(obj, LV_GRID_ALIGN_START, 1, 3, LV_GRID_ALIGN_CENTER, row, 1);
+    lv_obj_center(obj);
+
+    obj = dropdown_uint8(grid, &params.iq_format, " IQ int16 \n IQ float16");
+
+    lv_obj_set_size(obj, SMALL_3, 56);
+    lv_obj_set_grid_cell(obj, LV_GRID_ALIGN_START, 4, 3, LV_GRID_ALIGN_CENTER, row, 1);
+    lv_obj_center(obj);
+
+    return row + 1;
+}
+
 static uint8_t make_delimiter(uint8_t row) {
     row_dsc[row] = 10;
     
@@ -1232,6 +1314,7 @@ static void construct_cb(lv_obj_t *parent) {
 
     row = make_delimiter(row);
     row = make_audio_gain(row);
+    row = make_rec_format(row);
 
     row = make_delimiter(row);
     row = make_voice(row);
@@ -1242,6 +1325,9 @@ static void construct_cb(lv_obj_t *parent) {
     row = make_delimiter(row);
     row = make_freq_accel(row);
 
+    row = make_delimiter(row);
+    row = make_ft8(row);
+
     row = make_delimiter(row);
     
     for (uint8_t i = 0; i < TRANSVERTER_NUM; i++)
@@ -7,10 +7,13 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <math.h>
+#include <time.h>
 
 #include "dsp.h"
+#include "psd.h"
 #include "spectrum.h"
 #include "waterfall.h"
 #include "util.h"
@@ -20,44 +23,70 @@
 #include "audio.h"
 #include "cw.h"
 #include "rtty.h"
+#include "dialog.h"
 #include "dialog_ft8.h"
 #include "dialog_msg_voice.h"
 #include "recorder.h"
+#include "analytic.h"
 
 static int32_t          nfft = 400;
 static iirfilt_cccf     dc_block;
 
 static pthread_mutex_t  spectrum_mux;
 
+static psd_t            iq_psd;
+
 static uint8_t          spectrum_factor = 1;
 static firdecim_crcf    spectrum_decim;
+static psd_t            spectrum_zoom_psd;
 
-static spgramcf         spectrum_sg;
+static psd_acc_t        spectrum_acc;
 static float            *spectrum_psd;
-static float            *spectrum_psd_filtered;
+static psd_traces_t     spectrum_traces;
 static float            spectrum_beta = 0.7f;
 static uint8_t          spectrum_fps_ms = (1000 / 15);
 static uint64_t         spectrum_time;
 static float complex    *spectrum_dec_buf;
 
-static spgramcf         waterfall_sg;
+static psd_acc_t        waterfall_acc;
 static float            *waterfall_psd;
 static uint8_t          waterfall_fps_ms = (1000 / 25);
 static uint64_t         waterfall_time;
 
 static float complex    *buf;
 static float complex    *buf_filtered;
+static float            *auto_buf;
 
 static uint8_t          delay;
 
-static firhilbf         audio_hilb;
-static float complex    *audio;
+static analytic_t       audio_analytic;
+static float complex    audio[ANALYTIC_BLOCK];
 
 static bool             ready = false;
 static bool             auto_clear = true;
 
 static void dsp_calc_auto(float *data_buf, uint16_t size);
 
+#ifdef DSP_BENCH
+uint64_t                dsp_stage_ns[DSP_STAGE_NUM];
+static struct timespec  stage_ts;
+
+static void stage_start() {
+    clock_gettime(CLOCK_MONOTONIC, &stage_ts);
+}
+
+static void stage_done(dsp_stage_t stage) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    dsp_stage_ns[stage] += (now.tv_sec - stage_ts.tv_sec) * 1000000000LL + (now.tv_nsec - stage_ts.tv_nsec);
+    stage_ts = now;
+}
+#else
+#define stage_start()
+#define stage_done(stage)
+#endif
+
 /* * */
 
 void dsp_init() {
@@ -65,17 +94,25 @@ void dsp_init() {
 
     dc_block = iirfilt_cccf_create_dc_blocker(0.005f);
 
-    spectrum_sg = spgramcf_create(nfft, LIQUID_WINDOW_HANN, nfft, nfft / 4);
+    psd_init(&iq_psd, nfft, nfft / 4);
+    psd_init(&spectrum_zoom_psd, nfft, nfft / 4);
+
+    psd_acc_init(&spectrum_acc, nfft);
     spectrum_psd = (float *) malloc(nfft * sizeof(float));
-    spectrum_psd_filtered = (float *) malloc(nfft * sizeof(float));
+    psd_traces_init(&spectrum_traces, nfft);
+
+    psd_acc_init(&waterfall_acc, nfft);
+    waterfall_psd = (float *) malloc(nfft * sizeof(float));
+    auto_buf = (float *) malloc(nfft * sizeof(float));
+
+    psd_attach(&iq_psd, &spectrum_acc);
+    psd_attach(&iq_psd, &waterfall_acc);
 
     dsp_set_spectrum_factor(params_mode.spectrum_factor);
+    psd_traces_reset(&spectrum_traces, S_MIN);
 
     for (uint16_t i = 0; i < nfft; i++)
-        spectrum_psd_filtered[i] = S_MIN;
-
-    waterfall_sg = spgramcf_create(nfft, LIQUID_WINDOW_HANN, nfft, nfft / 4);
-    waterfall_psd = (float *) malloc(nfft * sizeof(float));
+        waterfall_psd[i] = S_MIN;
 
     buf = (float complex*) malloc(RADIO_SAMPLES * sizeof(float complex));
     buf_filtered = (float complex*) malloc(RADIO_SAMPLES * sizeof(float complex));
@@ -85,8 +122,7 @@ void dsp_init() {
     
     delay = 4;
     
-    audio = (float complex *) malloc(AUDIO_CAPTURE_RATE * sizeof(float complex));
-    audio_hilb = firhilbf_create(7, 60.0f);
+    analytic_init(&audio_analytic);
     
     ready = true;
 }
@@ -95,8 +131,13 @@ void dsp_reset() {
     delay = 4;
 
     iirfilt_cccf_reset(dc_block);
-    spgramcf_reset(spectrum_sg);
-    spgramcf_reset(waterfall_sg);
+
+    pthread_mutex_lock(&spectrum_mux);
+    psd_reset(&iq_psd);
+    psd_reset(&spectrum_zoom_psd);
+    psd_acc_reset(&spectrum_acc);
+    psd_acc_reset(&waterfall_acc);
+    pthread_mutex_unlock(&spectrum_mux);
 }
 
 void dsp_samples(float complex *buf_samples, uint16_t size) {
@@ -107,64 +148,69 @@ void dsp_samples(float complex *buf_samples, uint16_t size) {
 
     uint64_t now = get_time();
 
-    /* Spectrum */
+    stage_start();
+
+    /* Spectrum and waterfall share one FFT per hop, unless the spectrum is zoomed */
 
     iirfilt_cccf_execute_block(dc_block, buf_samples, size, buf_filtered);
+    stage_done(DSP_STAGE_DC_BLOCK);
 
     pthread_mutex_lock(&spectrum_mux);
 
+    psd_write(&iq_psd, buf_filtered, size);
+
     if (spectrum_factor > 1) {
         firdecim_crcf_execute_block(spectrum_decim, buf_filtered, size / spectrum_factor, spectrum_dec_buf);
-        spgramcf_write(spectrum_sg, spectrum_dec_buf, size / spectrum_factor);
+        psd_write(&spectrum_zoom_psd, spectrum_dec_buf, size / spectrum_factor);
         
         memset(spectrum_dec_buf, 0, sizeof(float complex) * size / spectrum_factor);
 
         for (uint8_t i = 0; i < spectrum_factor - 1; i++) {
-            spgramcf_write(spectrum_sg, spectrum_dec_buf, size / spectrum_factor);
+            psd_write(&spectrum_zoom_psd, spectrum_dec_buf, size / spectrum_factor);
         }
-    } else {
-        spgramcf_write(spectrum_sg, buf_filtered, size);
     }
 
-    spgramcf_get_psd(spectrum_sg, spectrum_psd);
+    stage_done(DSP_STAGE_FFT);
 
-    for (uint16_t i = 0; i < nfft; i++)
-        spectrum_psd[i] -= 30.0f;
+    /* Spectrum */
 
-    pthread_mutex_unlock(&spectrum_mux);
-    
     if (now - spectrum_time > spectrum_fps_ms) {
-        if (!delay) {
-            for (uint16_t i = 0; i < nfft; i++) {
-                float psd = spectrum_psd[i];
-                
-                lpf(&spectrum_psd_filtered[i], psd, spectrum_beta);
-            }
-        
-            spectrum_data(spectrum_psd_filtered, nfft);
+        if (!delay && psd_acc_get(&spectrum_acc, spectrum_psd, -30.0f)) {
+            spectrum_traces.flags = params.spectrum_peak ? PSD_TRACE_PEAK : 0;
+            spectrum_traces.beta = spectrum_beta;
+            spectrum_traces.hold = params.spectrum_peak_hold / spectrum_fps_ms;
+            spectrum_traces.speed = params.spectrum_peak_speed;
+
+            psd_traces_update(&spectrum_traces, spectrum_psd);
+            spectrum_data(&spectrum_traces);
         }
 
-        spgramcf_reset(spectrum_sg);
+        psd_acc_reset(&spectrum_acc);
         spectrum_time = now;
     }
 
+    stage_done(DSP_STAGE_SPECTRUM);
+
     /* Waterfall */
 
-    spgramcf_write(waterfall_sg, buf_filtered, size);
-    spgramcf_get_psd(waterfall_sg, waterfall_psd);
+    psd_acc_get(&waterfall_acc, waterfall_psd, -30.0f);
+
+    pthread_mutex_unlock(&spectrum_mux);
 
-    for (uint16_t i = 0; i < nfft; i++)
-        waterfall_psd[i] -= 30.0f;
-    
     if (now - waterfall_time > waterfall_fps_ms) {
         if (!delay) {
             waterfall_data(waterfall_psd, nfft);
         }
 
-        spgramcf_reset(waterfall_sg);
+        pthread_mutex_lock(&spectrum_mux);
+        psd_acc_reset(&waterfall_acc);
+        pthread_mutex_unlock(&spectrum_mux);
+
         waterfall_time = now;
     }
 
+    stage_done(DSP_STAGE_WATERFALL);
+
     /* S-Meter */
 
     if (dialog_msg_voice_get_state() != MSG_VOICE_RECORD) {
@@ -188,11 +234,15 @@ void dsp_samples(float complex *buf_samples, uint16_t size) {
         meter_update(peak_db, 0.8f);
     }
 
+    stage_done(DSP_STAGE_METER);
+
     /* Auto min, max */
 
     if (!delay) {
         dsp_calc_auto(waterfall_psd, nfft);
     }
+
+    stage_done(DSP_STAGE_AUTO);
 }
 
 void dsp_set_spectrum_factor(uint8_t x) {
@@ -218,13 +268,42 @@ void dsp_set_spectrum_factor(uint8_t x) {
         spectrum_dec_buf = (float complex *) malloc(RADIO_SAMPLES * sizeof(float complex) / spectrum_factor);
     }
 
-    spgramcf_reset(spectrum_sg);
+    psd_detach_all(&iq_psd);
+    psd_detach_all(&spectrum_zoom_psd);
 
-    for (uint16_t i = 0; i < nfft; i++)
-        spectrum_psd_filtered[i] = S_MIN;
+    if (spectrum_factor > 1) {
+        psd_reset(&spectrum_zoom_psd);
+        psd_attach(&spectrum_zoom_psd, &spectrum_acc);
+    } else {
+        psd_attach(&iq_psd, &spectrum_acc);
+    }
+
+    psd_attach(&iq_psd, &waterfall_acc);
+    psd_acc_reset(&spectrum_acc);
+
+    psd_traces_reset(&spectrum_traces, S_MIN);
+
+    pthread_mutex_unlock(&spectrum_mux);
+}
+
+void dsp_spectrum_clear() {
+    if (!ready) {
+        return;
+    }
+
+    pthread_mutex_lock(&spectrum_mux);
+    psd_traces_clear(&spectrum_traces);
+    pthread_mutex_unlock(&spectrum_mux);
+}
+
+void dsp_spectrum_shift(int16_t bins) {
+    if (!ready) {
+        return;
+    }
 
+    pthread_mutex_lock(&spectrum_mux);
+    psd_traces_shift(&spectrum_traces, bins);
     pthread_mutex_unlock(&spectrum_mux);
-    spectrum_clear();
 }
 
 float dsp_get_spectrum_beta() {
@@ -249,17 +328,37 @@ void dsp_put_audio_samples(size_t nsamples, int16_t *samples) {
         recorder_put_audio_samples(nsamples, samples);
     }
 
-    for (uint16_t i = 0; i < nsamples; i++)
-        firhilbf_r2c_execute(audio_hilb, samples[i] / 32768.0f, &audio[i]);
-
     x6100_mode_t    mode = radio_current_mode();
-    
-    if (rtty_get_state() == RTTY_RX) {
-        rtty_put_audio_samples(nsamples, audio);
-    } else if (mode == x6100_mode_cw || mode == x6100_mode_cwr) {
-        cw_put_audio_samples(nsamples, audio);
-    } else {
-        dialog_audio_samples(nsamples, audio);
+    bool            rtty = rtty_get_state() == RTTY_RX;
+    bool            cw = mode == x6100_mode_cw || mode == x6100_mode_cwr;
+    bool            dialog = dialog_audio_enabled();
+
+    if (!rtty && !cw && !dialog) {
+        return;
+    }
+
+    /* One analytic block is shared read-only by every consumer */
+
+    for (size_t pos = 0; pos < nsamples; pos += ANALYTIC_BLOCK) {
+        size_t n = nsamples - pos;
+
+        if (n > ANALYTIC_BLOCK) {
+            n = ANALYTIC_BLOCK;
+        }
+
+        analytic_execute_s16(&audio_analytic, samples + pos, n, audio);
+
+        if (rtty) {
+            rtty_put_audio_samples(n, audio);
+        }
+
+        if (cw) {
+            cw_put_audio_samples(n, audio);
+        }
+
+        if (dialog) {
+            dialog_audio_samples(n, audio);
+        }
     }
 }
 
@@ -267,11 +366,39 @@ void dsp_auto_clear() {
     auto_clear = true;
 }
 
-static int compare_fft(const void *p1, const void *p2) {
-    float *i1 = (float *) p1;
-    float *i2 = (float *) p2;
+/* Partial quickselect: after return data[0..k-1] <= data[k] <= data[k+1..size-1] */
+
+static void select_nth(float *data, uint16_t size, uint16_t k) {
+    int32_t left = 0;
+    int32_t right = size - 1;
+
+    while (left < right) {
+        float   pivot = data[(left + right) / 2];
+        int32_t i = left;
+        int32_t j = right;
 
-    return (*i1 < *i2) ? -1 : 1;
+        while (i <= j) {
+            while (data[i] < pivot) i++;
+            while (data[j] > pivot) j--;
+
+            if (i <= j) {
+                float tmp = data[i];
+
+                data[i] = data[j];
+                data[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+
+        if (k <= j) {
+            right = j;
+        } else if (k >= i) {
+            left = i;
+        } else {
+            break;
+        }
+    }
 }
 
 static void dsp_calc_auto(float *data_buf, uint16_t size) {
@@ -279,11 +406,16 @@ static void dsp_calc_auto(float *data_buf, uint16_t size) {
     float       max = 0;
     uint16_t    window = 30;
 
-    qsort(data_buf, size, sizeof(float), compare_fft);
-    
+    /* Work on a copy, the PSD keeps its bin order */
+
+    memcpy(auto_buf, data_buf, size * sizeof(float));
+
+    select_nth(auto_buf, size, window);
+    select_nth(auto_buf + window, size - window, size - window * 2);
+
     for (uint16_t i = 0; i < window; i++) {
-        min += data_buf[i];
-        max += data_buf[size - i - 1];
+        min += auto_buf[i];
+        max += auto_buf[size - i - 1];
     }
 
     min /= window;
@@ -12,12 +12,34 @@
 #include <stdlib.h>
 #include <liquid/liquid.h>
 
+#ifdef DSP_BENCH
+typedef enum {
+    DSP_STAGE_DC_BLOCK = 0,
+    DSP_STAGE_FFT,
+    DSP_STAGE_SPECTRUM,
+    DSP_STAGE_WATERFALL,
+    DSP_STAGE_METER,
+    DSP_STAGE_AUTO,
+
+    DSP_STAGE_NUM
+} dsp_stage_t;
+
+/* Accumulated time of dsp_samples() stages, ns */
+
+extern uint64_t dsp_stage_ns[DSP_STAGE_NUM];
+#endif
+
 void dsp_init();
 void dsp_samples(float complex *buf_samples, uint16_t size);
 void dsp_reset();
 
 void dsp_set_spectrum_factor(uint8_t x);
 
+/* Restart peak traces, and move them along with the frequency. Bins are in PSD order */
+
+void dsp_spectrum_clear();
+void dsp_spectrum_shift(int16_t bins);
+
 float dsp_get_spectrum_beta();
 void dsp_set_spectrum_beta(float x);
 
@@ -7,12 +7,14 @@
  */
 
 #include <stdlib.h>
-#include <pthread.h>
+#include <string.h>
+#include <stdatomic.h>
 #include "events.h"
 #include "backlight.h"
 #include "keyboard.h"
 
-#define QUEUE_SIZE  32
+#define QUEUE_SIZE  128     /* Power of 2 */
+#define QUEUE_MASK  (QUEUE_SIZE - 1)
 
 uint32_t        EVENT_ROTARY;
 uint32_t        EVENT_KEYPAD;
@@ -29,16 +31,24 @@ uint32_t        EVENT_GPS;
 uint32_t        EVENT_BAND_UP;
 uint32_t        EVENT_BAND_DOWN;
 
+/* Bounded MPSC ring (Vyukov). A slot is free for the writer when seq == pos,
+ * ready for the reader when seq == pos + 1 */
+
 typedef struct {
+    atomic_uint     seq;
+
     lv_obj_t        *obj;
     lv_event_code_t event_code;
     void            *param;
+    uint8_t         data[EVENT_DATA_SIZE];
 } item_t;
 
-static item_t           *queue[QUEUE_SIZE];
-static uint8_t          queue_write = 0;
-static uint8_t          queue_read = 0;
-static pthread_mutex_t  queue_mux;
+static item_t           queue[QUEUE_SIZE];
+static atomic_uint      queue_write;
+static uint32_t         queue_read = 0;
+
+static atomic_uint      drops;
+static uint32_t         max_depth = 0;
 
 void event_init() {
     EVENT_ROTARY = lv_event_register_id();
@@ -56,69 +66,114 @@ void event_init() {
     EVENT_BAND_UP = lv_event_register_id();
     EVENT_BAND_DOWN = lv_event_register_id();
 
-    for (uint8_t i = 0; i < QUEUE_SIZE; i++)
-        queue[i] = NULL;
+    for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+        atomic_init(&queue[i].seq, i);
 
-    pthread_mutex_init(&queue_mux, NULL);
+    atomic_init(&queue_write, 0);
+    atomic_init(&drops, 0);
 }
 
 void event_obj_check() {
-    while (queue_read != queue_write) {
-        pthread_mutex_lock(&queue_mux);
-        queue_read = (queue_read + 1) % QUEUE_SIZE;
-        
-        item_t *item = queue[queue_read];
-        pthread_mutex_unlock(&queue_mux);
-        
-        if (item) {
-            if (item->event_code == LV_EVENT_REFRESH) {
-                if (backlight_is_on()) {
-                    lv_obj_invalidate(item->obj);
-                }
-            } else {
-                lv_event_send(item->obj, item->event_code, item->param);
-            }
+    while (true) {
+        item_t      *item = &queue[queue_read & QUEUE_MASK];
+        uint32_t    seq = atomic_load_explicit(&item->seq, memory_order_acquire);
 
-            pthread_mutex_lock(&queue_mux);
+        if (seq != queue_read + 1) {
+            break;
+        }
+
+        uint32_t depth = atomic_load_explicit(&queue_write, memory_order_relaxed) - queue_read;
+
+        if (depth > max_depth) {
+            max_depth = depth;
+        }
 
-            if (item->param != NULL) {
-                free(item->param);
+        if (item->event_code == LV_EVENT_REFRESH) {
+            if (backlight_is_on()) {
+                lv_obj_invalidate(item->obj);
             }
-        
-            free(item);
-            queue[queue_read] = NULL;
+        } else {
+            lv_event_send(item->obj, item->event_code, item->param);
+        }
+
+        atomic_store_explicit(&item->seq, queue_read + QUEUE_SIZE, memory_order_release);
+        queue_read++;
+    }
+}
 
-            pthread_mutex_unlock(&queue_mux);
+static item_t * queue_reserve(uint32_t *pos) {
+    uint32_t    x = atomic_load_explicit(&queue_write, memory_order_relaxed);
+
+    while (true) {
+        item_t      *item = &queue[x & QUEUE_MASK];
+        uint32_t    seq = atomic_load_explicit(&item->seq, memory_order_acquire);
+        int32_t     diff = (int32_t) (seq - x);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue_write, &x, x + 1, memory_order_relaxed, memory_order_relaxed)) {
+                *pos = x;
+                return item;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&drops, 1, memory_order_relaxed);
+            LV_LOG_ERROR("Overflow");
+            return NULL;
+        } else {
+            x = atomic_load_explicit(&queue_write, memory_order_relaxed);
         }
     }
 }
 
-void event_send(lv_obj_t *obj, lv_event_code_t event_code, void *param) {
-    pthread_mutex_lock(&queue_mux);
+static void queue_commit(item_t *item, uint32_t pos) {
+    atomic_store_explicit(&item->seq, pos + 1, memory_order_release);
+}
 
-    uint8_t next = (queue_write + 1) % QUEUE_SIZE;
+bool event_send(lv_obj_t *obj, lv_event_code_t event_code, void *param) {
+    uint32_t    pos;
+    item_t      *item = queue_reserve(&pos);
 
-    if (queue[next]) {
-        pthread_mutex_unlock(&queue_mux);
-        LV_LOG_ERROR("Overflow");
-        return;
+    if (!item) {
+        return false;
     }
 
-    item_t *item = malloc(sizeof(item_t));
-    
     item->obj = obj;
     item->event_code = event_code;
     item->param = param;
 
-    queue[next] = item;
-    queue_write = next;
+    queue_commit(item, pos);
+
+    return true;
+}
+
+bool event_send_data(lv_obj_t *obj, lv_event_code_t event_code, const void *data, size_t size) {
+    if (size > EVENT_DATA_SIZE) {
+        LV_LOG_ERROR("Data too big (%zu)", size);
+        return false;
+    }
+
+    uint32_t    pos;
+    item_t      *item = queue_reserve(&pos);
+
+    if (!item) {
+        return false;
+    }
+
+    item->obj = obj;
+    item->event_code = event_code;
+    item->param = item->data;
+    memcpy(item->data, data, size);
+
+    queue_commit(item, pos);
+
+    return true;
+}
 
-    pthread_mutex_unlock(&queue_mux);
+bool event_send_key(int32_t key) {
+    return event_send_data(lv_group_get_focused(keyboard_group), LV_EVENT_KEY, &key, sizeof(key));
 }
 
-void event_send_key(int32_t key) {
-    int32_t *c = malloc(sizeof(int32_t));
-    *c = key;
-        
-    event_send(lv_group_get_focused(keyboard_group), LV_EVENT_KEY, c);
+void event_get_stats(event_stats_t *stats) {
+    stats->depth = atomic_load_explicit(&queue_write, memory_order_relaxed) - queue_read;
+    stats->max_depth = max_depth;
+    stats->drops = atomic_load_explicit(&drops, memory_order_relaxed);
 }
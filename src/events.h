@@ -12,6 +12,11 @@
 
 #include <unistd.h>
 #include <stdint.h>
+#include <stdbool.h>
+
+/* Max size of the data copied into a queue slot by event_send_data() */
+
+#define EVENT_DATA_SIZE     160
 
 typedef enum {
     KEYPAD_UNKNOWN = 0,
@@ -134,8 +139,21 @@ extern uint32_t EVENT_GPS;
 extern uint32_t EVENT_BAND_UP;
 extern uint32_t EVENT_BAND_DOWN;
 
+typedef struct {
+    uint32_t    depth;
+    uint32_t    max_depth;
+    uint32_t    drops;
+} event_stats_t;
+
 void event_init();
 
 void event_obj_check();
-void event_send(lv_obj_t *obj, lv_event_code_t event_code, void *param);
-void event_send_key(int32_t key);
+void event_get_stats(event_stats_t *stats);
+
+/* Return false if the queue is full and the event was dropped.
+ * event_send() passes the param as is, event_send_data() copies the data
+ * into the queue slot, it is valid only while the event is handled */
+
+bool event_send(lv_obj_t *obj, lv_event_code_t event_code, void *param);
+bool event_send_data(lv_obj_t *obj, lv_event_code_t event_code, const void *data, size_t size);
+bool event_send_key(int32_t key);
@@ -0,0 +1,194 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/fb.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "fb.h"
+
+#if LV_COLOR_DEPTH != 32
+#error "fb.c expects 32 bit lv_color_t"
+#endif
+
+static fb_t fb = { .mem = NULL };
+
+bool fb_open(const char *path) {
+    struct fb_var_screeninfo    vinfo;
+    struct fb_fix_screeninfo    finfo;
+    int                         fd = open(path, O_RDWR);
+
+    if (fd < 0) {
+        perror("Open framebuffer");
+        return false;
+    }
+
+    if (ioctl(fd, FBIOBLANK, FB_BLANK_UNBLANK) != 0 ||
+        ioctl(fd, FBIOGET_FSCREENINFO, &finfo) != 0 ||
+        ioctl(fd, FBIOGET_VSCREENINFO, &vinfo) != 0)
+    {
+        perror("Framebuffer info");
+        close(fd);
+        return false;
+    }
+
+    if (vinfo.bits_per_pixel != 16 && vinfo.bits_per_pixel != 24 && vinfo.bits_per_pixel != 32) {
+        LV_LOG_ERROR("Unsupported %u bpp", vinfo.bits_per_pixel);
+        close(fd);
+        return false;
+    }
+
+    uint8_t *mem = mmap(NULL, finfo.smem_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (mem == MAP_FAILED) {
+        perror("Map framebuffer");
+        return false;
+    }
+
+    fb.mem = mem + vinfo.yoffset * finfo.line_length + vinfo.xoffset * vinfo.bits_per_pixel / 8;
+    fb.width = vinfo.xres;
+    fb.height = vinfo.yres;
+    fb.stride = finfo.line_length;
+    fb.bpp = vinfo.bits_per_pixel;
+
+    LV_LOG_INFO("%ux%u, %u bpp", fb.width, fb.height, fb.bpp);
+
+    return true;
+}
+
+void fb_attach(const fb_t *x) {
+    fb = *x;
+}
+
+void fb_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    if (fb.mem) {
+        fb_write(&fb, area, color_p);
+    }
+
+    lv_disp_flush_ready(drv);
+}
+
+/* * */
+
+static inline void put_pixel(uint8_t *dst, uint8_t bpp, lv_color_t c) {
+    switch (bpp) {
+        case 32:
+            *(uint32_t *) dst = c.full;
+            break;
+
+        case 24:
+            dst[0] = c.ch.blue;
+            dst[1] = c.ch.green;
+            dst[2] = c.ch.red;
+            break;
+
+        case 16:
+            *(uint16_t *) dst = ((c.full >> 8) & 0xF800) | ((c.full >> 5) & 0x07E0) | ((c.full >> 3) & 0x001F);
+            break;
+    }
+}
+
+#ifdef __ARM_NEON
+
+/* 4x4 pixels of the area become 4 framebuffer lines of 4 pixels */
+
+static inline void transpose_4x4(const uint32_t *src, uint32_t src_stride, uint32x4_t col[4]) {
+    uint32x4x2_t    t01 = vtrnq_u32(vld1q_u32(src), vld1q_u32(src + src_stride));
+    uint32x4x2_t    t23 = vtrnq_u32(vld1q_u32(src + src_stride * 2), vld1q_u32(src + src_stride * 3));
+
+    col[0] = vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0]));
+    col[1] = vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1]));
+    col[2] = vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0]));
+    col[3] = vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1]));
+}
+
+static inline uint16x4_t to_rgb565(uint32x4_t x) {
+    uint32x4_t r = vandq_u32(vshrq_n_u32(x, 8), vdupq_n_u32(0xF800));
+    uint32x4_t g = vandq_u32(vshrq_n_u32(x, 5), vdupq_n_u32(0x07E0));
+    uint32x4_t b = vandq_u32(vshrq_n_u32(x, 3), vdupq_n_u32(0x001F));
+
+    return vmovn_u32(vorrq_u32(vorrq_u32(r, g), b));
+}
+
+#endif
+
+/*
+ * GUI pixel (x, y) goes to the framebuffer pixel (y, height - 1 - x): an area column
+ * is one framebuffer line. Columns are taken four at a time and walked down, so every
+ * framebuffer line is written sequentially
+ */
+
+void fb_write(const fb_t *fb, const lv_area_t *area, const lv_color_t *buf) {
+    int32_t     x2 = LV_MIN(area->x2, fb->height - 1);
+    int32_t     y2 = LV_MIN(area->y2, fb->width - 1);
+
+    if (area->x1 < 0 || area->y1 < 0 || area->x1 > x2 || area->y1 > y2) {
+        return;
+    }
+
+    const uint32_t  *src = (const uint32_t *) buf;
+    uint32_t        src_stride = lv_area_get_width(area);
+    uint16_t        w = x2 - area->x1 + 1;
+    uint16_t        h = y2 - area->y1 + 1;
+    uint8_t         pixel = fb->bpp / 8;
+    uint8_t         *line = fb->mem + (fb->height - 1 - area->x1) * fb->stride + area->y1 * pixel;
+    uint16_t        x = 0;
+
+#ifdef __ARM_NEON
+    if (fb->bpp == 32 || fb->bpp == 16) {
+        for (; x + 4 <= w; x += 4) {
+            uint8_t     *dst[4];
+            uint16_t    y = 0;
+
+            for (uint8_t k = 0; k < 4; k++)
+                dst[k] = line - (x + k) * fb->stride;
+
+            for (; y + 4 <= h; y += 4) {
+                uint32x4_t col[4];
+
+                transpose_4x4(src + y * src_stride + x, src_stride, col);
+
+                if (fb->bpp == 32) {
+                    for (uint8_t k = 0; k < 4; k++)
+                        vst1q_u32((uint32_t *) (dst[k] + y * 4), col[k]);
+                } else {
+                    for (uint8_t k = 0; k < 4; k++)
+                        vst1_u16((uint16_t *) (dst[k] + y * 2), to_rgb565(col[k]));
+                }
+            }
+
+            for (; y < h; y++)
+                for (uint8_t k = 0; k < 4; k++) {
+                    lv_color_t c = { .full = src[y * src_stride + x + k] };
+
+                    put_pixel(dst[k] + y * pixel, fb->bpp, c);
+                }
+        }
+    }
+#endif
+
+    for (; x < w; x++) {
+        uint8_t *dst = line - x * fb->stride;
+
+        for (uint16_t y = 0; y < h; y++) {
+            lv_color_t c = { .full = src[y * src_stride + x] };
+
+            put_pixel(dst + y * pixel, fb->bpp, c);
+        }
+    }
+}
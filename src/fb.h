@@ -0,0 +1,40 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*
+ * Framebuffer output of the rotated display. The panel is 480x800 portrait, the GUI is 800x480.
+ * Flushed areas are rotated by 90 degrees (same direction as LV_DISP_ROT_90) and converted
+ * to the framebuffer colour depth while written, so LVGL runs without sw_rotate
+ */
+
+typedef struct {
+    uint8_t     *mem;               /* First visible pixel */
+    uint16_t    width;              /* Physical, 480 */
+    uint16_t    height;             /* Physical, 800 */
+    uint32_t    stride;             /* Bytes per line */
+    uint8_t     bpp;                /* 16, 24 or 32 */
+} fb_t;
+
+bool fb_open(const char *path);
+
+/* Use memory as the framebuffer, for the offline tools */
+
+void fb_attach(const fb_t *fb);
+
+void fb_flush(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p);
+
+/* Rotate and convert one area in GUI coordinates, buf is its pixels row by row */
+
+void fb_write(const fb_t *fb, const lv_area_t *area, const lv_color_t *buf);
@@ -382,6 +382,186 @@ const uint8_t kFTX_LDPC_Mn[FTX_LDPC_N][3] = {
     { 42, 49, 57 }
 };
 
+// Position of every codeword bit within the parity checks of kFTX_LDPC_Mn,
+// i.e. kFTX_LDPC_Nm[kFTX_LDPC_Mn[i][j] - 1][kFTX_LDPC_Mn_pos[i][j]] == i + 1.
+// 0-origin.
+const uint8_t kFTX_LDPC_Mn_pos[FTX_LDPC_N][3] = {
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 1 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 1 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 0, 0, 0 },
+    { 1, 0, 1 },
+    { 1, 0, 0 },
+    { 0, 0, 1 },
+    { 1, 0, 1 },
+    { 0, 0, 0 },
+    { 1, 0, 1 },
+    { 1, 0, 2 },
+    { 1, 1, 0 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 0 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 2 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 0, 1, 2 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 2 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 0 },
+    { 1, 2, 0 },
+    { 1, 1, 1 },
+    { 1, 1, 1 },
+    { 1, 1, 2 },
+    { 2, 2, 1 },
+    { 3, 1, 1 },
+    { 2, 2, 1 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 2, 2, 3 },
+    { 2, 2, 4 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 2, 2, 1 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 2, 2, 3 },
+    { 2, 3, 2 },
+    { 2, 2, 3 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 2, 2, 2 },
+    { 3, 2, 3 },
+    { 2, 2, 2 },
+    { 2, 3, 3 },
+    { 3, 2, 2 },
+    { 3, 1, 2 },
+    { 3, 3, 2 },
+    { 1, 3, 2 },
+    { 2, 3, 2 },
+    { 4, 2, 3 },
+    { 3, 2, 2 },
+    { 3, 2, 3 },
+    { 3, 3, 2 },
+    { 3, 3, 2 },
+    { 3, 3, 3 },
+    { 4, 3, 3 },
+    { 3, 4, 3 },
+    { 3, 3, 3 },
+    { 3, 3, 4 },
+    { 5, 4, 5 },
+    { 3, 4, 3 },
+    { 4, 3, 2 },
+    { 3, 3, 3 },
+    { 3, 4, 3 },
+    { 4, 4, 3 },
+    { 3, 4, 3 },
+    { 3, 3, 3 },
+    { 4, 3, 4 },
+    { 4, 5, 4 },
+    { 3, 3, 3 },
+    { 5, 4, 4 },
+    { 3, 3, 3 },
+    { 4, 3, 3 },
+    { 3, 4, 2 },
+    { 3, 4, 4 },
+    { 3, 3, 4 },
+    { 4, 3, 3 },
+    { 5, 5, 3 },
+    { 4, 3, 5 },
+    { 4, 4, 4 },
+    { 4, 3, 4 },
+    { 3, 3, 4 },
+    { 4, 4, 4 },
+    { 3, 4, 3 },
+    { 4, 5, 4 },
+    { 4, 4, 4 },
+    { 5, 4, 5 },
+    { 3, 3, 3 },
+    { 5, 4, 4 },
+    { 4, 5, 5 },
+    { 4, 4, 4 },
+    { 4, 5, 4 },
+    { 3, 5, 3 },
+    { 4, 5, 3 },
+    { 5, 4, 3 },
+    { 4, 4, 4 },
+    { 2, 6, 2 },
+    { 4, 4, 4 },
+    { 4, 5, 4 },
+    { 4, 5, 4 },
+    { 5, 4, 4 },
+    { 5, 4, 3 },
+    { 4, 5, 5 },
+    { 5, 4, 4 },
+    { 4, 4, 4 },
+    { 3, 4, 5 },
+    { 5, 6, 5 },
+    { 5, 5, 3 },
+    { 6, 5, 4 },
+    { 5, 5, 4 },
+    { 4, 4, 5 },
+    { 6, 4, 5 },
+    { 4, 5, 6 },
+    { 3, 6, 5 },
+    { 5, 6, 5 },
+    { 6, 4, 5 },
+    { 6, 5, 5 },
+    { 6, 6, 5 },
+    { 5, 5, 4 },
+    { 6, 6, 5 },
+    { 5, 5, 5 },
+    { 6, 5, 6 },
+    { 5, 6, 5 },
+    { 5, 5, 5 },
+    { 5, 6, 5 },
+    { 5, 5, 6 },
+    { 5, 3, 6 },
+    { 5, 5, 5 },
+    { 5, 6, 4 },
+    { 5, 5, 5 },
+    { 5, 5, 5 },
+    { 6, 6, 5 },
+    { 5, 5, 5 },
+    { 6, 5, 4 },
+    { 5, 4, 5 },
+    { 4, 5, 5 },
+    { 6, 5, 5 },
+    { 5, 5, 5 }
+};
+
 const uint8_t kFTX_LDPC_Num_rows[FTX_LDPC_M] = {
     7, 6, 6, 6, 7, 6, 7, 6, 6, 7, 6, 6, 7, 7, 6, 6,
     6, 7, 6, 7, 6, 7, 6, 6, 6, 7, 6, 6, 6, 7, 6, 6,
@@ -80,6 +80,9 @@ extern "C"
     /// The numbers use 1 as the origin (first entry).
     extern const uint8_t kFTX_LDPC_Mn[FTX_LDPC_N][3];
 
+    /// Position of every codeword bit within its three parity checks (columns in Nm), 0-origin.
+    extern const uint8_t kFTX_LDPC_Mn_pos[FTX_LDPC_N][3];
+
     /// Number of rows (columns in C/C++) in the array Nm.
     extern const uint8_t kFTX_LDPC_Num_rows[FTX_LDPC_M];
 
@@ -5,6 +5,7 @@
 #include "unpack.h"
 
 #include <stdbool.h>
+#include <string.h>
 #include <math.h>
 
 /// Compute log likelihood log(p(1) / p(0)) of 174 message bits for later use in soft-decision LDPC decoding
@@ -399,7 +400,7 @@ bool ft8_decode(const waterfall_t* wf, const candidate_t* cand, message_t* messa
     ftx_normalize_logl(log174);
 
     uint8_t plain174[FTX_LDPC_N]; // message bits (0/1)
-    bp_decode(log174, max_iterations, plain174, &status->ldpc_errors);
+    ms_decode(log174, max_iterations, plain174, &status->ldpc_errors);
     // ldpc_decode(log174, max_iterations, plain174, &status->ldpc_errors);
 
     if (status->ldpc_errors > 0)
@@ -433,6 +434,7 @@ bool ft8_decode(const waterfall_t* wf, const candidate_t* cand, message_t* messa
         }
     }
 
+    memcpy(message->payload, a91, sizeof(message->payload));
     status->unpack_status = unpack77(a91, message->text);
 
     if (status->unpack_status < 0)
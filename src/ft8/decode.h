@@ -47,6 +47,7 @@ extern "C"
         // TODO: check again that this size is enough
         char text[25]; ///< Plain text
         uint16_t hash; ///< Hash value to be used in hash table and quick checking for duplicates
+        uint8_t payload[10]; ///< 77 bit payload, as passed to ft8_encode() or ft4_encode()
     } message_t;
 
     /// Structure that contains the status of various steps during decoding of a message
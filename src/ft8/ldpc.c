@@ -17,6 +17,10 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
 static int ldpc_check(uint8_t codeword[]);
 static float fast_tanh(float x);
 static float fast_atanh(float x);
@@ -212,6 +216,207 @@ void bp_decode(float codeword[], int max_iters, uint8_t plain[], int* ok)
     *ok = min_errors;
 }
 
+// Offset min-sum decoder with 8-bit messages.
+//
+// Messages are kept per edge slot: the check j of a row is stored in msg[j][row],
+// so check node updates work on 16 rows at once. Rows with 6 bits have the 7th
+// slot parked at the maximal positive value, which never changes the minimum or sign.
+// Here the log-likelihoods have the usual sign, log(P(x=0) / P(x=1)).
+
+#define MS_ROWS         96      // FTX_LDPC_M rounded up to the SIMD width
+#define MS_SLOTS        7
+#define MS_SCALE        4.0f    // Message units per log-likelihood unit
+#define MS_OFFSET       2       // 0.5 in log-likelihood
+#define MS_MAX          127
+#define MS_STALL        6       // Iterations without a better syndrome to give up
+#define MS_GIVE_UP_ITER 6       // ... or still this bad after that many iterations
+#define MS_GIVE_UP_ERR  30
+
+static inline int8_t ms_sat(int16_t x)
+{
+    if (x > MS_MAX)
+        return MS_MAX;
+    if (x < -MS_MAX)
+        return -MS_MAX;
+    return x;
+}
+
+#ifdef __ARM_NEON
+
+static void ms_check_nodes(int8_t v2c[MS_SLOTS][MS_ROWS], int8_t c2v[MS_SLOTS][MS_ROWS])
+{
+    const int8x16_t zero = vdupq_n_s8(0);
+    const int8x16_t offset = vdupq_n_s8(MS_OFFSET);
+
+    for (int m = 0; m < MS_ROWS; m += 16)
+    {
+        int8x16_t min1 = vdupq_n_s8(MS_MAX);
+        int8x16_t min2 = vdupq_n_s8(MS_MAX);
+        int8x16_t min_slot = zero;
+        int8x16_t sign = zero;
+
+        for (int j = 0; j < MS_SLOTS; j++)
+        {
+            int8x16_t x = vld1q_s8(&v2c[j][m]);
+            int8x16_t a = vqabsq_s8(x);
+            uint8x16_t lower = vcltq_s8(a, min1);
+
+            sign = veorq_s8(sign, x);
+            min2 = vbslq_s8(lower, min1, vminq_s8(min2, a));
+            min1 = vminq_s8(min1, a);
+            min_slot = vbslq_s8(lower, vdupq_n_s8(j), min_slot);
+        }
+
+        min1 = vmaxq_s8(vqsubq_s8(min1, offset), zero);
+        min2 = vmaxq_s8(vqsubq_s8(min2, offset), zero);
+
+        for (int j = 0; j < MS_SLOTS; j++)
+        {
+            int8x16_t x = vld1q_s8(&v2c[j][m]);
+            int8x16_t mag = vbslq_s8(vceqq_s8(min_slot, vdupq_n_s8(j)), min2, min1);
+            uint8x16_t neg = vcltq_s8(veorq_s8(sign, x), zero);
+
+            vst1q_s8(&c2v[j][m], vbslq_s8(neg, vnegq_s8(mag), mag));
+        }
+    }
+}
+
+#else
+
+static void ms_check_nodes(int8_t v2c[MS_SLOTS][MS_ROWS], int8_t c2v[MS_SLOTS][MS_ROWS])
+{
+    int8_t min1[MS_ROWS];
+    int8_t min2[MS_ROWS];
+    int8_t min_slot[MS_ROWS];
+    int8_t sign[MS_ROWS];
+
+    for (int m = 0; m < MS_ROWS; m++)
+    {
+        min1[m] = MS_MAX;
+        min2[m] = MS_MAX;
+        min_slot[m] = 0;
+        sign[m] = 0;
+    }
+
+    for (int j = 0; j < MS_SLOTS; j++)
+    {
+        for (int m = 0; m < MS_ROWS; m++)
+        {
+            int8_t x = v2c[j][m];
+            int8_t a = (x < 0) ? -x : x;
+
+            sign[m] ^= x;
+
+            if (a < min1[m])
+            {
+                min2[m] = min1[m];
+                min1[m] = a;
+                min_slot[m] = j;
+            }
+            else if (a < min2[m])
+            {
+                min2[m] = a;
+            }
+        }
+    }
+
+    for (int m = 0; m < MS_ROWS; m++)
+    {
+        min1[m] = (min1[m] > MS_OFFSET) ? min1[m] - MS_OFFSET : 0;
+        min2[m] = (min2[m] > MS_OFFSET) ? min2[m] - MS_OFFSET : 0;
+    }
+
+    for (int j = 0; j < MS_SLOTS; j++)
+    {
+        for (int m = 0; m < MS_ROWS; m++)
+        {
+            int8_t mag = (min_slot[m] == j) ? min2[m] : min1[m];
+
+            c2v[j][m] = ((sign[m] ^ v2c[j][m]) < 0) ? -mag : mag;
+        }
+    }
+}
+
+#endif
+
+void ms_decode(float codeword[], int max_iters, uint8_t plain[], int* ok)
+{
+    int8_t v2c[MS_SLOTS][MS_ROWS];
+    int8_t c2v[MS_SLOTS][MS_ROWS];
+    int16_t llr[FTX_LDPC_N];
+
+    int min_errors = FTX_LDPC_M;
+    int min_iter = 0;
+
+    for (int j = 0; j < MS_SLOTS; j++)
+    {
+        for (int m = 0; m < MS_ROWS; m++)
+        {
+            v2c[j][m] = MS_MAX;
+            c2v[j][m] = 0;
+        }
+    }
+
+    for (int n = 0; n < FTX_LDPC_N; ++n)
+    {
+        llr[n] = ms_sat(lrintf(-codeword[n] * MS_SCALE));
+    }
+
+    for (int iter = 0; iter < max_iters; ++iter)
+    {
+        // Bit nodes: hard decision and messages to check nodes
+        int plain_sum = 0;
+        for (int n = 0; n < FTX_LDPC_N; ++n)
+        {
+            int8_t* e[3];
+            int16_t sum = llr[n];
+
+            for (int m_idx = 0; m_idx < 3; ++m_idx)
+            {
+                e[m_idx] = &c2v[kFTX_LDPC_Mn_pos[n][m_idx]][kFTX_LDPC_Mn[n][m_idx] - 1];
+                sum += *e[m_idx];
+            }
+
+            plain[n] = (sum < 0) ? 1 : 0;
+            plain_sum += plain[n];
+
+            for (int m_idx = 0; m_idx < 3; ++m_idx)
+            {
+                v2c[kFTX_LDPC_Mn_pos[n][m_idx]][kFTX_LDPC_Mn[n][m_idx] - 1] = ms_sat(sum - *e[m_idx]);
+            }
+        }
+
+        if (plain_sum == 0)
+        {
+            // message converged to all-zeros, which is prohibited
+            break;
+        }
+
+        int errors = ldpc_check(plain);
+
+        if (errors < min_errors)
+        {
+            min_errors = errors;
+            min_iter = iter;
+
+            if (errors == 0)
+            {
+                break; // Found a perfect answer
+            }
+        }
+
+        // Syndrome weight does not go down any more, or stays at the level of noise
+        if (iter - min_iter >= MS_STALL || (iter >= MS_GIVE_UP_ITER && errors > MS_GIVE_UP_ERR))
+        {
+            break;
+        }
+
+        ms_check_nodes(v2c, c2v);
+    }
+
+    *ok = min_errors;
+}
+
 // Ideas for approximating tanh/atanh:
 // * https://varietyofsound.wordpress.com/2011/02/14/efficient-tanh-computation-using-lamberts-continued-fraction/
 // * http://functions.wolfram.com/ElementaryFunctions/ArcTanh/10/0001/
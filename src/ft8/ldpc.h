@@ -16,6 +16,9 @@ extern "C"
 
     void bp_decode(float codeword[], int max_iters, uint8_t plain[], int* ok);
 
+    // Offset min-sum with 8-bit messages, gives up early on candidates which do not converge.
+    void ms_decode(float codeword[], int max_iters, uint8_t plain[], int* ok);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,176 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdbool.h>
+#include <math.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "ft8_mag.h"
+
+/*
+ * Lookup by float exponent and 4 upper mantissa bits. One bucket spans less than 0.27 dB,
+ * so it holds at most one 0.5 dB step of the scale: the bucket base value, and the power
+ * from which it is one more. Outside of 2^-41 .. 2^3 the result is clamped to 0 or 255
+ */
+
+#define LUT_SHIFT       19
+#define LUT_FIRST       ((127 - 41) << 4)
+#define LUT_SIZE        (44 << 4)
+
+static float            lut_thr[LUT_SIZE];
+static uint8_t          lut_base[LUT_SIZE];
+static bool             lut_ready = false;
+
+static inline uint8_t power_db_ref(float v) {
+    float   db = 10.0f * log10f(v);
+    int     scaled = (int16_t) (db * 2.0f + 240.0f);
+
+    if (scaled < 0) {
+        scaled = 0;
+    } else if (scaled > 255) {
+        scaled = 255;
+    }
+
+    return scaled;
+}
+
+static inline float from_bits(uint32_t bits) {
+    union { uint32_t u; float f; } x = { .u = bits };
+
+    return x.f;
+}
+
+static inline uint32_t to_bits(float v) {
+    union { float f; uint32_t u; } x = { .f = v };
+
+    return x.u;
+}
+
+void ft8_mag_init() {
+    if (lut_ready) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < LUT_SIZE; i++) {
+        uint32_t    lo = (uint32_t) (LUT_FIRST + i) << LUT_SHIFT;
+        uint32_t    hi = lo + (1 << LUT_SHIFT) - 1;
+        uint8_t     base = power_db_ref(from_bits(lo));
+
+        lut_base[i] = base;
+
+        if (power_db_ref(from_bits(hi)) == base) {
+            lut_thr[i] = INFINITY;
+            continue;
+        }
+
+        /* First power with the next value */
+
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+
+            if (power_db_ref(from_bits(mid)) > base) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+
+        lut_thr[i] = from_bits(hi);
+    }
+
+    lut_ready = true;
+}
+
+static inline int32_t lut_index(float v) {
+    int32_t n = (int32_t) (to_bits(v) >> LUT_SHIFT) - LUT_FIRST;
+
+    if (n < 0) {
+        return 0;
+    } else if (n > LUT_SIZE - 1) {
+        return LUT_SIZE - 1;
+    }
+
+    return n;
+}
+
+static inline uint8_t power_db(float v) {
+    int32_t n = lut_index(v);
+
+    return lut_base[n] + (v >= lut_thr[n]);
+}
+
+#ifdef __ARM_NEON
+
+static inline void power_db_x4(float32x4_t v, uint8_t *mag) {
+    uint32x4_t  bits = vshrq_n_u32(vreinterpretq_u32_f32(v), LUT_SHIFT);
+    int32x4_t   n = vsubq_s32(vreinterpretq_s32_u32(bits), vdupq_n_s32(LUT_FIRST));
+    int32_t     idx[4];
+    float       thr[4];
+    uint32_t    step[4];
+
+    n = vminq_s32(vmaxq_s32(n, vdupq_n_s32(0)), vdupq_n_s32(LUT_SIZE - 1));
+    vst1q_s32(idx, n);
+
+    for (uint8_t k = 0; k < 4; k++)
+        thr[k] = lut_thr[idx[k]];
+
+    vst1q_u32(step, vshrq_n_u32(vcgeq_f32(v, vld1q_f32(thr)), 31));
+
+    for (uint8_t k = 0; k < 4; k++)
+        mag[k] = lut_base[idx[k]] + step[k];
+}
+
+void ft8_mag_block(const float complex *freq, uint8_t *mag, uint16_t num_bins) {
+    const float *src = (const float *) freq;
+    uint16_t    bin = 0;
+
+    /* Four bin pairs: re, im of even and re, im of odd bins */
+
+    for (; bin + 4 <= num_bins; bin += 4) {
+        float32x4x4_t   x = vld4q_f32(src + bin * 4);
+        float32x4_t     even = vmlaq_f32(vmulq_f32(x.val[0], x.val[0]), x.val[1], x.val[1]);
+        float32x4_t     odd = vmlaq_f32(vmulq_f32(x.val[2], x.val[2]), x.val[3], x.val[3]);
+
+        power_db_x4(even, &mag[bin]);
+        power_db_x4(odd, &mag[num_bins + bin]);
+    }
+
+    for (; bin < num_bins; bin++) {
+        const float *x = src + bin * 4;
+
+        mag[bin] = power_db(x[0] * x[0] + x[1] * x[1]);
+        mag[num_bins + bin] = power_db(x[2] * x[2] + x[3] * x[3]);
+    }
+}
+
+#else
+
+void ft8_mag_block(const float complex *freq, uint8_t *mag, uint16_t num_bins) {
+    const float *src = (const float *) freq;
+
+    for (uint16_t bin = 0; bin < num_bins; bin++) {
+        const float *x = src + bin * 4;
+
+        mag[bin] = power_db(x[0] * x[0] + x[1] * x[1]);
+        mag[num_bins + bin] = power_db(x[2] * x[2] + x[3] * x[3]);
+    }
+}
+
+#endif
+
+void ft8_mag_block_ref(const float complex *freq, uint8_t *mag, uint16_t num_bins) {
+    for (uint8_t freq_sub = 0; freq_sub < 2; freq_sub++)
+        for (uint16_t bin = 0; bin < num_bins; bin++) {
+            complex float   x = freq[bin * 2 + freq_sub];
+
+            mag[freq_sub * num_bins + bin] = power_db_ref(crealf(x * conjf(x)));
+        }
+}
@@ -0,0 +1,26 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <complex.h>
+
+/*
+ * Power of FFT bins as FT8 waterfall magnitude in 0.5 dB steps: 2 * 10 * log10(|x|^2) + 240,
+ * that is 40 * log10(|x|) + 240, clamped to 0..255.
+ * Bins are interleaved by frequency oversampling 2: even bins go to mag[0 .. num_bins),
+ * odd bins to mag[num_bins .. 2 * num_bins)
+ */
+
+void ft8_mag_init();
+void ft8_mag_block(const float complex *freq, uint8_t *mag, uint16_t num_bins);
+
+/* Plain log10f version, reference for the benchmark */
+
+void ft8_mag_block_ref(const float complex *freq, uint8_t *mag, uint16_t num_bins);
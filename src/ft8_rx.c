@@ -0,0 +1,596 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "ft8_rx.h"
+#include "ft8_mag.h"
+#include "gfsk.h"
+#include "ft8/constants.h"
+#include "ft8/encode.h"
+
+#define MIN_SCORE       10
+#define MAX_CANDIDATES  120
+#define LDPC_ITER       20
+#define FREQ_OSR        2   /* ft8_mag_block() layout */
+#define TIME_OSR        4
+
+#define SYNC_DELAY      1.25f   /* Reported time_sec is late by this many symbols */
+#define TIME_SEARCH     4       /* Residual time search, in 1/8 symbol steps each side */
+
+#define MAX_WORKERS     8
+#define HASH_SIZE       (1 << FT8_CRC_WIDTH)
+
+typedef struct {
+    message_t       message;
+    bool            ok;
+    bool            collision;
+} candidate_result_t;
+
+/* Decoder pool. The thread calling ft8_rx_decode() works too */
+
+static pthread_t            workers[MAX_WORKERS];
+static uint8_t              workers_num = 0;
+
+static pthread_mutex_t      pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       pool_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t       pool_done_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t             pool_job = 0;
+static uint8_t              pool_busy = 0;
+static bool                 pool_quit = false;
+
+/* Current job */
+
+static ft8_rx_t             *job_rx;
+static candidate_t          candidates[MAX_CANDIDATES];
+static uint16_t             candidates_num;
+static atomic_int           candidates_next;
+static candidate_result_t   candidates_result[MAX_CANDIDATES];
+
+/* Best candidate (index + 1) for every message hash */
+
+static atomic_ushort        decoded_owner[HASH_SIZE];
+
+void ft8_rx_init(ft8_rx_t *rx, ftx_protocol_t protocol, uint32_t sample_rate) {
+    float   slot_time;
+    uint8_t num_tones;
+
+    switch (protocol) {
+        case PROTO_FT4:
+            slot_time = FT4_SLOT_TIME;
+            num_tones = FT4_NN;
+            rx->symbol_period = FT4_SYMBOL_PERIOD;
+            break;
+
+        case PROTO_FT8:
+        default:
+            slot_time = FT8_SLOT_TIME;
+            num_tones = FT8_NN;
+            rx->symbol_period = FT8_SYMBOL_PERIOD;
+            break;
+    }
+
+    rx->sample_rate = sample_rate;
+    rx->block_size = sample_rate * rx->symbol_period;
+    rx->subblock_size = rx->block_size / TIME_OSR;
+    rx->nfft = rx->block_size * FREQ_OSR;
+
+    const uint32_t max_blocks = slot_time / rx->symbol_period;
+    const uint32_t num_bins = sample_rate * rx->symbol_period / 2;
+
+    size_t mag_size = max_blocks * TIME_OSR * FREQ_OSR * num_bins * sizeof(uint8_t);
+
+    rx->wf.max_blocks = max_blocks;
+    rx->wf.num_bins = num_bins;
+    rx->wf.time_osr = TIME_OSR;
+    rx->wf.freq_osr = FREQ_OSR;
+    rx->wf.block_stride = TIME_OSR * FREQ_OSR * num_bins;
+    rx->wf.mag = (uint8_t *) malloc(mag_size);
+    rx->wf.protocol = protocol;
+
+    ft8_mag_init();
+
+    rx->time_buf = (float complex *) malloc(rx->nfft * sizeof(float complex));
+    rx->freq_buf = (float complex *) malloc(rx->nfft * sizeof(float complex));
+    rx->fft = fft_create_plan(rx->nfft, rx->time_buf, rx->freq_buf, LIQUID_FFT_FORWARD, 0);
+    rx->frame_window = windowcf_create(rx->nfft);
+
+    rx->slot = (float complex *) malloc(max_blocks * rx->block_size * sizeof(float complex));
+    rx->residual = (float complex *) malloc(max_blocks * rx->block_size * sizeof(float complex));
+    rx->ref = (float complex *) malloc(num_tones * rx->block_size * sizeof(float complex));
+    rx->ring = (float complex *) malloc((rx->block_size + 1) * sizeof(float complex));
+
+    rx->window = (float *) malloc(rx->nfft * sizeof(float));
+
+    for (uint16_t i = 0; i < rx->nfft; i++)
+        rx->window[i] = liquid_hann(i, rx->nfft);
+
+    float gain = 0.0f;
+
+    for (uint16_t i = 0; i < rx->nfft; i++)
+        gain += rx->window[i] * rx->window[i];
+
+    gain = 1.0f / sqrtf(gain);
+
+    for (uint16_t i = 0; i < rx->nfft; i++)
+        rx->window[i] *= gain;
+
+    ft8_rx_reset(rx);
+}
+
+void ft8_rx_done(ft8_rx_t *rx) {
+    free(rx->wf.mag);
+    windowcf_destroy(rx->frame_window);
+
+    free(rx->time_buf);
+    free(rx->freq_buf);
+    fft_destroy_plan(rx->fft);
+
+    free(rx->window);
+
+    free(rx->slot);
+    free(rx->residual);
+    free(rx->ref);
+    free(rx->ring);
+}
+
+void ft8_rx_reset(ft8_rx_t *rx) {
+    rx->wf.num_blocks = 0;
+    rx->residual_used = false;
+}
+
+static void waterfall_block(ft8_rx_t *rx, float complex *frame) {
+    waterfall_t     *wf = &rx->wf;
+    complex float   *frame_ptr;
+    int             offset = wf->num_blocks * wf->block_stride;
+    int             frame_pos = 0;
+
+    for (int time_sub = 0; time_sub < wf->time_osr; time_sub++) {
+        windowcf_write(rx->frame_window, &frame[frame_pos], rx->subblock_size);
+        frame_pos += rx->subblock_size;
+
+        windowcf_read(rx->frame_window, &frame_ptr);
+
+        for (uint32_t pos = 0; pos < rx->nfft; pos++)
+            rx->time_buf[pos] = rx->window[pos] * frame_ptr[pos];
+
+        fft_execute(rx->fft);
+
+        ft8_mag_block(rx->freq_buf, &wf->mag[offset], wf->num_bins);
+        offset += wf->freq_osr * wf->num_bins;
+    }
+
+    wf->num_blocks++;
+}
+
+bool ft8_rx_process(ft8_rx_t *rx, float complex *frame) {
+    waterfall_t *wf = &rx->wf;
+
+    if (wf->num_blocks >= wf->max_blocks) {
+        return true;
+    }
+
+    memcpy(&rx->slot[wf->num_blocks * rx->block_size], frame, rx->block_size * sizeof(float complex));
+    waterfall_block(rx, frame);
+
+    return wf->num_blocks >= wf->max_blocks;
+}
+
+/* Waterfall of the same blocks from other audio */
+
+static void waterfall_rebuild(ft8_rx_t *rx, float complex *audio) {
+    uint16_t num_blocks = rx->wf.num_blocks;
+
+    windowcf_reset(rx->frame_window);
+    rx->wf.num_blocks = 0;
+
+    for (uint16_t i = 0; i < num_blocks; i++)
+        waterfall_block(rx, &audio[i * rx->block_size]);
+}
+
+/* Correlation of the residual with every reference symbol, return the total power */
+
+static float correlate_symbols(ft8_rx_t *rx, int32_t start, uint8_t num_tones, float complex *corr) {
+    int32_t size = rx->wf.num_blocks * rx->block_size;
+    float   power = 0.0f;
+
+    for (uint8_t k = 0; k < num_tones; k++) {
+        float complex   c = 0.0f;
+        int32_t         from = k * rx->block_size;
+        int32_t         to = from + rx->block_size;
+
+        if (start + from < 0) {
+            from = -start;
+        }
+
+        if (start + to > size) {
+            to = size - start;
+        }
+
+        for (int32_t i = from; i < to; i++)
+            c += rx->residual[start + i] * conjf(rx->ref[i]);
+
+        corr[k] = c;
+        power += crealf(c * conjf(c));
+    }
+
+    return power;
+}
+
+/*
+ * Remove a decoded signal from the residual: synthesize it from the payload, refine time and
+ * frequency against the residual, then subtract it with the amplitude and phase smoothed over a symbol
+ */
+
+static void subtract(ft8_rx_t *rx, const ft8_rx_result_t *result) {
+    uint8_t     tones[FT4_NN];      /* Longer than FT8_NN */
+    uint8_t     num_tones;
+    float       symbol_bt;
+
+    if (rx->wf.protocol == PROTO_FT4) {
+        ft4_encode(result->message.payload, tones);
+        num_tones = FT4_NN;
+        symbol_bt = FT4_SYMBOL_BT;
+    } else {
+        ft8_encode(result->message.payload, tones);
+        num_tones = FT8_NN;
+        symbol_bt = FT8_SYMBOL_BT;
+    }
+
+    float complex   corr[num_tones];
+    int32_t         size = rx->wf.num_blocks * rx->block_size;
+    int32_t         n = gfsk_synth_iq(tones, num_tones, result->freq_hz, symbol_bt, rx->symbol_period, rx->sample_rate, rx->ref);
+    int32_t         step = rx->block_size / 8;
+    int32_t         start = lrintf((result->time_sec - SYNC_DELAY * rx->symbol_period) * rx->sample_rate);
+    int32_t         best_start = start;
+    float           best_power = -1.0f;
+
+    for (int32_t shift = -TIME_SEARCH; shift <= TIME_SEARCH; shift++) {
+        float power = correlate_symbols(rx, start + shift * step, num_tones, corr);
+
+        if (power > best_power) {
+            best_power = power;
+            best_start = start + shift * step;
+        }
+    }
+
+    start = best_start;
+
+    /* Frequency error from the phase drift between symbols */
+
+    float complex drift = 0.0f;
+
+    correlate_symbols(rx, start, num_tones, corr);
+
+    for (uint8_t k = 1; k < num_tones; k++)
+        drift += corr[k] * conjf(corr[k - 1]);
+
+    float complex   rot = cexpf(I * cargf(drift) / rx->block_size);
+    float complex   phase = 1.0f;
+
+    for (int32_t i = 0; i < n; i++) {
+        rx->ref[i] *= phase;
+        phase *= rot;
+
+        if (i % rx->block_size == 0) {
+            phase /= cabsf(phase);
+        }
+    }
+
+    /* Subtract with the envelope averaged over a symbol. Ring keeps the products from before subtraction */
+
+    int32_t         half = rx->block_size / 2;
+    int32_t         ring_size = rx->block_size + 1;
+    float complex   sum = 0.0f;
+    int32_t         count = 0;
+
+    for (int32_t i = -half; i < n + half; i++) {
+        int32_t head = i + half;
+        int32_t tail = i - half - 1;
+
+        if (head < n) {
+            int32_t         pos = start + head;
+            float complex   p = 0.0f;
+
+            if (pos >= 0 && pos < size) {
+                p = rx->residual[pos] * conjf(rx->ref[head]);
+            }
+
+            rx->ring[head % ring_size] = p;
+            sum += p;
+            count++;
+        }
+
+        if (tail >= 0) {
+            sum -= rx->ring[tail % ring_size];
+            count--;
+        }
+
+        int32_t pos = start + i;
+
+        if (i >= 0 && i < n && pos >= 0 && pos < size) {
+            rx->residual[pos] -= sum / count * rx->ref[i];
+        }
+    }
+}
+
+static uint64_t get_ns() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* Keep the best SNR copy of every message. Different texts with the same hash are all kept */
+
+static void add_decoded(uint16_t idx) {
+    candidate_result_t  *res = &candidates_result[idx];
+    atomic_ushort       *owner = &decoded_owner[res->message.hash % HASH_SIZE];
+    uint16_t            cur = atomic_load_explicit(owner, memory_order_acquire);
+
+    while (true) {
+        if (cur == 0) {
+            if (atomic_compare_exchange_weak_explicit(owner, &cur, idx + 1, memory_order_acq_rel, memory_order_acquire)) {
+                return;
+            }
+            continue;
+        }
+
+        uint16_t other = cur - 1;
+
+        if (strcmp(candidates_result[other].message.text, res->message.text) != 0) {
+            res->collision = true;
+            return;
+        }
+
+        if (candidates[other].snr > candidates[idx].snr || (candidates[other].snr == candidates[idx].snr && other < idx)) {
+            return;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(owner, &cur, idx + 1, memory_order_acq_rel, memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+static void decode_candidates() {
+    while (true) {
+        int idx = atomic_fetch_add_explicit(&candidates_next, 1, memory_order_relaxed);
+
+        if (idx >= candidates_num) {
+            break;
+        }
+
+        const candidate_t   *cand = &candidates[idx];
+        candidate_result_t  *res = &candidates_result[idx];
+        decode_status_t     status;
+
+        if (cand->score < MIN_SCORE) {
+            continue;
+        }
+
+        if (ft8_decode(&job_rx->wf, cand, &res->message, LDPC_ITER, &status)) {
+            res->ok = true;
+            add_decoded(idx);
+        }
+    }
+}
+
+static void * worker_thread(void *arg) {
+    uint32_t job = 0;
+
+    while (true) {
+        pthread_mutex_lock(&pool_mutex);
+
+        while (job == pool_job && !pool_quit) {
+            pthread_cond_wait(&pool_start_cond, &pool_mutex);
+        }
+
+        if (pool_quit) {
+            pthread_mutex_unlock(&pool_mutex);
+            break;
+        }
+
+        job = pool_job;
+        pthread_mutex_unlock(&pool_mutex);
+
+        decode_candidates();
+
+        pthread_mutex_lock(&pool_mutex);
+
+        if (--pool_busy == 0) {
+            pthread_cond_signal(&pool_done_cond);
+        }
+
+        pthread_mutex_unlock(&pool_mutex);
+    }
+
+    return NULL;
+}
+
+void ft8_rx_pool_init(uint8_t threads) {
+    if (threads == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = cores > 0 ? cores : 1;
+    }
+
+    if (threads > MAX_WORKERS + 1) {
+        threads = MAX_WORKERS + 1;
+    }
+
+    pool_quit = false;
+    workers_num = threads - 1;
+
+    for (uint8_t i = 0; i < workers_num; i++)
+        pthread_create(&workers[i], NULL, worker_thread, NULL);
+}
+
+void ft8_rx_pool_done() {
+    pthread_mutex_lock(&pool_mutex);
+    pool_quit = true;
+    pthread_cond_broadcast(&pool_start_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (uint8_t i = 0; i < workers_num; i++)
+        pthread_join(workers[i], NULL);
+
+    workers_num = 0;
+}
+
+static int compare_results(const void *p1, const void *p2) {
+    const ft8_rx_result_t *r1 = (const ft8_rx_result_t *) p1;
+    const ft8_rx_result_t *r2 = (const ft8_rx_result_t *) p2;
+
+    return r2->snr - r1->snr;
+}
+
+static bool is_decoded(const ft8_rx_result_t *results, uint16_t num, const message_t *message) {
+    for (uint16_t i = 0; i < num; i++)
+        if (results[i].message.hash == message->hash && strcmp(results[i].message.text, message->text) == 0) {
+            return true;
+        }
+
+    return false;
+}
+
+/* One decode of the current waterfall. New messages are appended to results, return their count */
+
+static uint16_t decode_pass(ft8_rx_t *rx, ft8_rx_result_t *results, uint16_t num, uint16_t max_results) {
+    waterfall_t *wf = &rx->wf;
+    uint64_t    start = get_ns();
+
+    job_rx = rx;
+    candidates_num = ft8_find_sync(wf, MAX_CANDIDATES, candidates, MIN_SCORE);
+
+    rx->candidates += candidates_num;
+    rx->sync_ns += get_ns() - start;
+    start = get_ns();
+
+    memset(candidates_result, 0, sizeof(candidates_result));
+    memset(decoded_owner, 0, sizeof(decoded_owner));
+    atomic_store(&candidates_next, 0);
+
+    /* Run */
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_busy = workers_num;
+    pool_job++;
+    pthread_cond_broadcast(&pool_start_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    decode_candidates();
+
+    pthread_mutex_lock(&pool_mutex);
+
+    while (pool_busy) {
+        pthread_cond_wait(&pool_done_cond, &pool_mutex);
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+
+    rx->decode_ns += get_ns() - start;
+
+    /* Collect */
+
+    uint16_t first = num;
+
+    for (uint16_t idx = 0; idx < candidates_num && num < max_results; idx++) {
+        candidate_result_t  *res = &candidates_result[idx];
+        const candidate_t   *cand = &candidates[idx];
+
+        if (!res->ok) {
+            continue;
+        }
+
+        if (!res->collision && atomic_load(&decoded_owner[res->message.hash % HASH_SIZE]) != idx + 1) {
+            continue;
+        }
+
+        /* Earlier passes, and collided hashes of this one */
+
+        if (is_decoded(results, num, &res->message)) {
+            continue;
+        }
+
+        ft8_rx_result_t *result = &results[num++];
+
+        result->message = res->message;
+        result->snr = cand->snr;
+        result->freq_hz = (cand->freq_offset + (float) cand->freq_sub / wf->freq_osr) / rx->symbol_period;
+        result->time_sec = (cand->time_offset + (float) cand->time_sub / wf->time_osr) * rx->symbol_period;
+    }
+
+    return num - first;
+}
+
+uint16_t ft8_rx_decode(ft8_rx_t *rx, ft8_rx_result_t *results, uint16_t max_results, uint32_t budget_ms) {
+    uint64_t    budget_ns = (uint64_t) budget_ms * 1000000LL;
+    uint64_t    start = get_ns();
+    uint16_t    num = 0;
+    int         cancel_state;
+
+    /* Caller could be cancelled, but workers must not outlive the waterfall */
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel_state);
+
+    rx->candidates = 0;
+    rx->passes = 0;
+    rx->sync_ns = 0;
+    rx->decode_ns = 0;
+    rx->subtract_ns = 0;
+
+    if (rx->residual_used) {
+        waterfall_rebuild(rx, rx->slot);
+        rx->residual_used = false;
+    }
+
+    while (true) {
+        uint64_t    pass_start = get_ns();
+        uint16_t    first = num;
+
+        num += decode_pass(rx, results, num, max_results);
+        rx->passes++;
+
+        if (num == first || num >= max_results || rx->passes >= FT8_RX_MAX_PASSES) {
+            break;
+        }
+
+        /* Subtraction and the next pass take about as long as this one */
+
+        uint64_t now = get_ns();
+
+        if (now - start + 2 * (now - pass_start) > budget_ns) {
+            break;
+        }
+
+        if (!rx->residual_used) {
+            memcpy(rx->residual, rx->slot, rx->wf.num_blocks * rx->block_size * sizeof(float complex));
+            rx->residual_used = true;
+        }
+
+        for (uint16_t i = first; i < num; i++)
+            subtract(rx, &results[i]);
+
+        waterfall_rebuild(rx, rx->residual);
+        rx->subtract_ns += get_ns() - now;
+    }
+
+    pthread_setcancelstate(cancel_state, NULL);
+
+    qsort(results, num, sizeof(ft8_rx_result_t), compare_results);
+
+    return num;
+}
@@ -0,0 +1,79 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <liquid/liquid.h>
+
+#include "ft8/decode.h"
+
+#define FT8_RX_MAX_DECODED  50
+#define FT8_RX_MAX_PASSES   3
+
+/* FT8/FT4 receiver: waterfall of one slot and its decoding */
+
+typedef struct {
+    waterfall_t     wf;
+    float           symbol_period;
+
+    uint32_t        block_size;
+    uint32_t        subblock_size;
+    uint16_t        nfft;
+
+    windowcf        frame_window;
+    float           *window;
+    float complex   *time_buf;
+    float complex   *freq_buf;
+    fftplan         fft;
+
+    /* Slot audio, and its copy with decoded signals subtracted */
+
+    uint32_t        sample_rate;
+    float complex   *slot;
+    float complex   *residual;
+    bool            residual_used;
+    float complex   *ref;
+    float complex   *ring;
+
+    /* Last decode */
+
+    uint16_t        candidates;
+    uint8_t         passes;
+    uint64_t        sync_ns;
+    uint64_t        decode_ns;
+    uint64_t        subtract_ns;
+} ft8_rx_t;
+
+typedef struct {
+    message_t       message;
+    int16_t         snr;
+    float           freq_hz;
+    float           time_sec;
+} ft8_rx_result_t;
+
+void ft8_rx_init(ft8_rx_t *rx, ftx_protocol_t protocol, uint32_t sample_rate);
+void ft8_rx_done(ft8_rx_t *rx);
+void ft8_rx_reset(ft8_rx_t *rx);
+
+/* One block of block_size samples. Return true when the slot is complete */
+
+bool ft8_rx_process(ft8_rx_t *rx, float complex *frame);
+
+/* Decoder pool. Threads = 0 means one per CPU core */
+
+void ft8_rx_pool_init(uint8_t threads);
+void ft8_rx_pool_done();
+
+/*
+ * Decode the slot. Results are unique and sorted by SNR, return their count.
+ * While there is time in budget_ms, decoded signals are subtracted and the slot is decoded again
+ */
+
+uint16_t ft8_rx_decode(ft8_rx_t *rx, ft8_rx_result_t *results, uint16_t max_results, uint32_t budget_ms);
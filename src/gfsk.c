@@ -11,7 +11,6 @@
 #include <math.h>
 #include <stdlib.h>
 #include "gfsk.h"
-#include "audio.h"
 
 #define GFSK_CONST_K    5.336446f
 
@@ -25,20 +24,17 @@ void gfsk_pulse(uint16_t n_spsym, float symbol_bt, float *pulse) {
     }
 }
 
-int16_t * gfsk_synth(const uint8_t *symbols, uint16_t n_sym, float f0, float symbol_bt, float symbol_period, uint32_t *n_samples) {
-    uint32_t    n_spsym = (uint32_t)(0.5f + AUDIO_PLAY_RATE * symbol_period);  /* Samples per symbol */
-    uint32_t    n_wave = n_sym * n_spsym;                                      /* Number of output samples */
+/* Phase increment per sample, with a dummy symbol before and after: (n_sym + 2) * n_spsym items */
+
+static void gfsk_phase(const uint8_t *symbols, uint16_t n_sym, float f0, float symbol_bt, uint32_t n_spsym, uint32_t rate, float *dphi) {
+    uint32_t    n_wave = n_sym * n_spsym;
     float       hmod = 1.0f;
     float       dphi_peak = 2 * M_PI * hmod / n_spsym;
-    float       dphi[n_wave + 2 * n_spsym];
-    int16_t     *samples = malloc(sizeof(int16_t) * n_wave);
-    
-    *n_samples = n_wave;
 
     /* Shift frequency up by f0 */
 
     for (uint32_t i = 0; i < n_wave + 2 * n_spsym; i++) {
-        dphi[i] = 2 * M_PI * f0 / AUDIO_PLAY_RATE;
+        dphi[i] = 2 * M_PI * f0 / rate;
     }
 
     float pulse[3 * n_spsym];
@@ -59,6 +55,29 @@ int16_t * gfsk_synth(const uint8_t *symbols, uint16_t n_sym, float f0, float sym
         dphi[j] += dphi_peak * pulse[j + n_spsym] * symbols[0];
         dphi[j + n_sym * n_spsym] += dphi_peak * pulse[j] * symbols[n_sym - 1];
     }
+}
+
+static float gfsk_envelope(uint32_t i, uint32_t n_wave, uint32_t n_ramp) {
+    if (i >= n_ramp && i < n_wave - n_ramp) {
+        return 1.0f;
+    }
+
+    if (i >= n_ramp) {
+        i = n_wave - 1 - i;
+    }
+
+    return (1 - cosf(2 * M_PI * i / (2 * n_ramp))) / 2;
+}
+
+int16_t * gfsk_synth(const uint8_t *symbols, uint16_t n_sym, float f0, float symbol_bt, float symbol_period, uint32_t rate, uint32_t *n_samples) {
+    uint32_t    n_spsym = (uint32_t)(0.5f + rate * symbol_period);             /* Samples per symbol */
+    uint32_t    n_wave = n_sym * n_spsym;                                      /* Number of output samples */
+    float       dphi[n_wave + 2 * n_spsym];
+    int16_t     *samples = malloc(sizeof(int16_t) * n_wave);
+    
+    *n_samples = n_wave;
+
+    gfsk_phase(symbols, n_sym, f0, symbol_bt, n_spsym, rate, dphi);
 
     /* Calculate and insert the audio waveform */
 
@@ -74,7 +93,7 @@ int16_t * gfsk_synth(const uint8_t *symbols, uint16_t n_sym, float f0, float sym
     int n_ramp = n_spsym / 8;
 
     for (uint32_t i = 0; i < n_ramp; i++) {
-        float env = (1 - cosf(2 * M_PI * i / (2 * n_ramp))) / 2;
+        float env = gfsk_envelope(i, n_wave, n_ramp);
 
         samples[i] *= env;
         samples[n_wave - 1 - i] *= env;
@@ -82,3 +101,21 @@ int16_t * gfsk_synth(const uint8_t *symbols, uint16_t n_sym, float f0, float sym
     
     return samples;
 }
+
+uint32_t gfsk_synth_iq(const uint8_t *symbols, uint16_t n_sym, float f0, float symbol_bt, float symbol_period, uint32_t rate, float complex *samples) {
+    uint32_t    n_spsym = (uint32_t)(0.5f + rate * symbol_period);
+    uint32_t    n_wave = n_sym * n_spsym;
+    uint32_t    n_ramp = n_spsym / 8;
+    float       dphi[n_wave + 2 * n_spsym];
+
+    gfsk_phase(symbols, n_sym, f0, symbol_bt, n_spsym, rate, dphi);
+
+    float phi = 0;
+
+    for (uint32_t k = 0; k < n_wave; k++) {
+        samples[k] = cexpf(I * phi) * gfsk_envelope(k, n_wave, n_ramp);
+        phi = fmodf(phi + dphi[k + n_spsym], 2 * M_PI);
+    }
+
+    return n_wave;
+}
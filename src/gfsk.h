@@ -9,9 +9,14 @@
 #pragma once
 
 #include <stdint.h>
+#include <complex.h>
 
 #define FT8_SYMBOL_BT   2.0f
 #define FT4_SYMBOL_BT   1.0f
 
 void gfsk_pulse(uint16_t n_spsym, float symbol_bt, float *pulse);
-int16_t * gfsk_synth(const uint8_t *symbols, uint16_t n_sym, float f0, float symbol_bt, float symbol_period, uint32_t *n_samples);
+int16_t * gfsk_synth(const uint8_t *symbols, uint16_t n_sym, float f0, float symbol_bt, float symbol_period, uint32_t rate, uint32_t *n_samples);
+
+/* Unit amplitude analytic signal, samples should hold n_sym * symbol_period * rate items. Return their count */
+
+uint32_t gfsk_synth_iq(const uint8_t *symbols, uint16_t n_sym, float f0, float symbol_bt, float symbol_period, uint32_t rate, float complex *samples);
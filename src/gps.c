@@ -29,10 +29,14 @@ static void * gps_thread(void *arg) {
                     prev_time = gpsdata.fix.time.tv_sec;
                     
                     if (dialog_gps->run) {
-                        struct gps_data_t *msg = malloc(sizeof(struct gps_data_t));
-                        
-                        memcpy(msg, &gpsdata, sizeof(*msg));
-                        event_send(dialog_gps->obj, EVENT_GPS, msg);
+                        gps_msg_t msg = {
+                            .mode = gpsdata.fix.mode,
+                            .time = gpsdata.fix.time,
+                            .latitude = gpsdata.fix.latitude,
+                            .longitude = gpsdata.fix.longitude
+                        };
+
+                        event_send_data(dialog_gps->obj, EVENT_GPS, &msg, sizeof(msg));
                     }
                 }
             }
@@ -10,4 +10,11 @@
 
 #include <gps.h>
 
+typedef struct {
+    int             mode;
+    struct timespec time;
+    double          latitude;
+    double          longitude;
+} gps_msg_t;
+
 void gps_init();
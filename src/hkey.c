@@ -20,16 +20,24 @@
 static event_hkey_t     event = { .state = HKEY_RELEASE };
 static lv_timer_t       *timer = NULL;
 
-static void hkey_event() {
-    event_hkey_t    *e = malloc(sizeof(event_hkey_t));
-    
-    *e = event;
-    event_send(lv_scr_act(), EVENT_HKEY, (void*) e);
+static bool hkey_event() {
+    if (!event_send_data(lv_scr_act(), EVENT_HKEY, &event, sizeof(event))) {
+        LV_LOG_WARN("Event queue is full, HKEY event not sent");
+        return false;
+    }
+
+    return true;
 }
 
+/* hkey_put() comes with every radio packet, so a dropped key or release is sent again with the next one */
+
 static void hkey_key(int32_t key) {
     if (event.state == HKEY_RELEASE || event.state == HKEY_LONG_RELEASE) {
-        event_send_key(key);
+        if (!event_send_key(key)) {
+            LV_LOG_WARN("Event queue is full, key %i delayed", key);
+            return;
+        }
+
         event.state = HKEY_PRESS;
         event.key = HKEY_UNKNOWN;
     }
@@ -48,16 +56,16 @@ void hkey_put(uint32_t key) {
                 case HKEY_PRESS:
                     event.state = HKEY_RELEASE;
                     
-                    if (event.key != HKEY_UNKNOWN) {
-                        hkey_event();
+                    if (event.key != HKEY_UNKNOWN && !hkey_event()) {
+                        event.state = HKEY_PRESS;
                     }
                     break;
 
                 case HKEY_LONG:
                     event.state = HKEY_LONG_RELEASE;
 
-                    if (event.key != HKEY_UNKNOWN) {
-                        hkey_event();
+                    if (event.key != HKEY_UNKNOWN && !hkey_event()) {
+                        event.state = HKEY_LONG;
                     }
                     break;
                     
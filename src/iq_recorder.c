@@ -0,0 +1,414 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+#include "lvgl/lvgl.h"
+#include "iq_recorder.h"
+#include "recorder.h"
+#include "radio.h"
+#include "params.h"
+#include "msg.h"
+
+#define REC_BLOCKS      512     /* About 2.6 seconds */
+#define PLAY_BLOCKS     64
+
+typedef struct {
+    iq_block_header_t   header;
+    uint16_t            data[RADIO_SAMPLES * 2];
+} block_t;
+
+/* Single producer, single consumer ring of blocks */
+
+typedef struct {
+    block_t             *blocks;
+    uint32_t            size;
+    atomic_uint         head;
+    atomic_uint         tail;
+    sem_t               sem;
+    pthread_t           thread;
+    atomic_bool         run;
+} ring_t;
+
+static block_t          rec_blocks[REC_BLOCKS];
+static ring_t           rec = { .blocks = rec_blocks, .size = REC_BLOCKS };
+static FILE             *rec_file = NULL;
+static iq_format_t      rec_format;
+static atomic_uint      rec_overruns = 0;
+static atomic_bool      rec_busy = false;       /* Until the file is closed */
+
+static block_t          play_blocks[PLAY_BLOCKS];
+static ring_t           play = { .blocks = play_blocks, .size = PLAY_BLOCKS };
+static FILE             *play_file = NULL;
+static iq_header_t      play_header;
+static atomic_bool      play_eof = false;
+static bool             play_started = false;  /* Thread to join, the file may be closed at EOF */
+
+static bool             sem_ready = false;
+
+/* * */
+
+static uint16_t float_to_half(float x) {
+    uint32_t    f;
+
+    memcpy(&f, &x, sizeof(f));
+
+    uint16_t    sign = (f >> 16) & 0x8000;
+    int32_t     exp = ((f >> 23) & 0xFF) - 127 + 15;
+    uint32_t    mant = f & 0x7FFFFF;
+
+    if (exp >= 31) {
+        return sign | 0x7BFF;                               /* Saturate to the largest finite */
+    }
+
+    if (exp <= 0) {
+        if (exp < -10) {
+            return sign;
+        }
+
+        mant |= 0x800000;
+
+        uint32_t shift = 14 - exp;
+        uint32_t half = mant >> shift;
+
+        if ((mant >> (shift - 1)) & 1) {
+            half++;
+        }
+
+        return sign | half;
+    }
+
+    uint16_t half = sign | (exp << 10) | (mant >> 13);
+
+    if (mant & 0x1000) {
+        half++;                                             /* Carry into the exponent is fine */
+    }
+
+    return half;
+}
+
+static float half_to_float(uint16_t h) {
+    uint32_t    sign = (h & 0x8000) << 16;
+    uint32_t    exp = (h >> 10) & 0x1F;
+    uint32_t    mant = h & 0x3FF;
+    uint32_t    f;
+
+    if (exp == 0) {
+        float x = ldexpf(mant, -24);
+
+        return sign ? -x : x;
+    }
+
+    f = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+
+    float x;
+
+    memcpy(&x, &f, sizeof(x));
+
+    return x;
+}
+
+void iq_block_encode(const float complex *samples, uint32_t n, iq_format_t format, iq_block_header_t *header, uint16_t *data) {
+    const float *x = (const float *) samples;
+    float       peak = 0.0f;
+
+    for (uint32_t i = 0; i < n * 2; i++) {
+        float a = fabsf(x[i]);
+
+        if (a > peak) {
+            peak = a;
+        }
+    }
+
+    int32_t exp = (peak > 0.0f) ? ilogbf(peak) + 1 : 0;
+
+    if (exp < -127) {
+        exp = -127;
+    } else if (exp > 127) {
+        exp = 127;
+    }
+
+    memset(header, 0, sizeof(*header));
+    header->exp = exp;
+
+    if (format == IQ_FORMAT_CF16) {
+        float scale = ldexpf(1.0f, -exp);
+
+        for (uint32_t i = 0; i < n * 2; i++)
+            data[i] = float_to_half(x[i] * scale);
+    } else {
+        float scale = ldexpf(1.0f, 15 - exp);
+
+        for (uint32_t i = 0; i < n * 2; i++) {
+            int32_t v = lrintf(x[i] * scale);
+
+            if (v > 32767) {
+                v = 32767;
+            } else if (v < -32767) {
+                v = -32767;
+            }
+
+            data[i] = (uint16_t) (int16_t) v;
+        }
+    }
+}
+
+void iq_block_decode(const iq_block_header_t *header, const uint16_t *data, uint32_t n, iq_format_t format, float complex *samples) {
+    float *x = (float *) samples;
+
+    if (format == IQ_FORMAT_CF16) {
+        float scale = ldexpf(1.0f, header->exp);
+
+        for (uint32_t i = 0; i < n * 2; i++)
+            x[i] = half_to_float(data[i]) * scale;
+    } else {
+        float scale = ldexpf(1.0f, header->exp - 15);
+
+        for (uint32_t i = 0; i < n * 2; i++)
+            x[i] = (int16_t) data[i] * scale;
+    }
+}
+
+/* * */
+
+static void ring_reset(ring_t *ring) {
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+
+    if (!sem_ready) {
+        sem_init(&rec.sem, 0, 0);
+        sem_init(&play.sem, 0, 0);
+        sem_ready = true;
+    }
+}
+
+static void rec_flush() {
+    uint32_t tail = atomic_load_explicit(&rec.tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&rec.head, memory_order_acquire);
+
+    while (tail != head) {
+        fwrite(&rec.blocks[tail % rec.size], sizeof(block_t), 1, rec_file);
+        tail++;
+        atomic_store_explicit(&rec.tail, tail, memory_order_release);
+    }
+}
+
+static void * rec_thread(void *arg) {
+    while (atomic_load(&rec.run)) {
+        sem_wait(&rec.sem);
+        rec_flush();
+    }
+
+    /* Rest of the ring, up to REC_BLOCKS. Reported through the event queue */
+
+    rec_flush();
+    fclose(rec_file);
+    rec_file = NULL;
+
+    uint32_t n = atomic_load(&rec_overruns);
+
+    if (n) {
+        LV_LOG_WARN("IQ recorder overruns: %u", n);
+    }
+
+    msg_set_text_fmt("IQ recorder is off");
+    atomic_store(&rec_busy, false);
+
+    return NULL;
+}
+
+void iq_recorder_set_on(bool on) {
+    if (on == iq_recorder_is_on()) {
+        return;
+    }
+
+    if (on) {
+        if (atomic_load(&rec_busy)) {
+            msg_set_text_fmt("IQ recorder is saving the file");
+            return;
+        }
+
+        char        filename[64];
+        time_t      now = time(NULL);
+        struct tm   *t = localtime(&now);
+
+        snprintf(filename, sizeof(filename),
+            "%s/IQ_%04i%02i%02i_%02i%02i%02i.iq",
+            recorder_path, t->tm_year + 1900, t->tm_mon + 1, t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec
+        );
+
+        rec_file = fopen(filename, "wb");
+
+        if (!rec_file) {
+            msg_set_text_fmt("Problem with create file");
+            return;
+        }
+
+        iq_header_t header = {
+            .magic = IQ_MAGIC,
+            .version = IQ_VERSION,
+            .format = params.iq_format.x,
+            .mode = radio_current_mode(),
+            .rate = IQ_RATE,
+            .block_samples = RADIO_SAMPLES,
+            .freq = params_band.vfo_x[params_band.vfo].freq,
+            .time = now
+        };
+
+        fwrite(&header, sizeof(header), 1, rec_file);
+
+        rec_format = header.format;
+        ring_reset(&rec);
+        atomic_store(&rec_overruns, 0);
+        atomic_store(&rec.run, true);
+        atomic_store(&rec_busy, true);
+        pthread_create(&rec.thread, NULL, rec_thread, NULL);
+        pthread_detach(rec.thread);
+
+        msg_set_text_fmt("IQ recorder is on");
+    } else {
+        atomic_store(&rec.run, false);
+        sem_post(&rec.sem);
+    }
+}
+
+bool iq_recorder_is_on() {
+    return atomic_load(&rec.run);
+}
+
+void iq_recorder_put_samples(const float complex *samples) {
+    uint32_t head = atomic_load_explicit(&rec.head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&rec.tail, memory_order_acquire);
+
+    if (head - tail >= rec.size) {
+        atomic_fetch_add(&rec_overruns, 1);
+        return;
+    }
+
+    block_t *block = &rec.blocks[head % rec.size];
+
+    iq_block_encode(samples, RADIO_SAMPLES, rec_format, &block->header, block->data);
+
+    atomic_store_explicit(&rec.head, head + 1, memory_order_release);
+    sem_post(&rec.sem);
+}
+
+/* * */
+
+static void * play_thread(void *arg) {
+    while (atomic_load(&play.run)) {
+        uint32_t head = atomic_load_explicit(&play.head, memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(&play.tail, memory_order_acquire);
+
+        while (head - tail < play.size) {
+            if (fread(&play.blocks[head % play.size], sizeof(block_t), 1, play_file) != 1) {
+                fclose(play_file);
+                play_file = NULL;
+                atomic_store(&play_eof, true);
+                break;
+            }
+
+            head++;
+            atomic_store_explicit(&play.head, head, memory_order_release);
+        }
+
+        if (atomic_load(&play_eof)) {
+            break;
+        }
+
+        sem_wait(&play.sem);
+    }
+
+    return NULL;
+}
+
+bool iq_player_start(const char *filename) {
+    iq_player_stop();
+
+    play_file = fopen(filename, "rb");
+
+    if (!play_file) {
+        return false;
+    }
+
+    /* Whole blocks only */
+
+    fseek(play_file, 0, SEEK_END);
+
+    long size = ftell(play_file) - (long) sizeof(play_header);
+
+    rewind(play_file);
+
+    if (fread(&play_header, sizeof(play_header), 1, play_file) != 1 ||
+        memcmp(play_header.magic, IQ_MAGIC, 4) != 0 ||
+        play_header.version != IQ_VERSION ||
+        (play_header.format != IQ_FORMAT_CS16 && play_header.format != IQ_FORMAT_CF16) ||
+        play_header.rate != IQ_RATE ||
+        play_header.block_samples != RADIO_SAMPLES ||
+        size <= 0 || size % sizeof(block_t) != 0)
+    {
+        fclose(play_file);
+        play_file = NULL;
+        return false;
+    }
+
+    ring_reset(&play);
+    atomic_store(&play_eof, false);
+    atomic_store(&play.run, true);
+    pthread_create(&play.thread, NULL, play_thread, NULL);
+    play_started = true;
+
+    return true;
+}
+
+void iq_player_stop() {
+    if (!play_started) {
+        return;
+    }
+
+    atomic_store(&play.run, false);
+    sem_post(&play.sem);
+    pthread_join(play.thread, NULL);
+    play_started = false;
+
+    if (play_file) {
+        fclose(play_file);
+        play_file = NULL;
+    }
+}
+
+bool iq_player_is_on() {
+    return atomic_load(&play.run);
+}
+
+void iq_player_get_samples(float complex *samples) {
+    uint32_t tail = atomic_load_explicit(&play.tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&play.head, memory_order_acquire);
+
+    if (tail == head) {
+        if (atomic_load(&play_eof)) {
+            atomic_store(&play.run, false);
+        }
+
+        memset(samples, 0, RADIO_SAMPLES * sizeof(float complex));
+        return;
+    }
+
+    block_t *block = &play.blocks[tail % play.size];
+
+    iq_block_decode(&block->header, block->data, RADIO_SAMPLES, play_header.format, samples);
+
+    atomic_store_explicit(&play.tail, tail + 1, memory_order_release);
+    sem_post(&play.sem);
+}
@@ -0,0 +1,63 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <complex.h>
+
+#define IQ_MAGIC        "X6IQ"
+#define IQ_VERSION      1
+#define IQ_RATE         100000
+
+typedef enum {
+    IQ_FORMAT_CS16 = 0,
+    IQ_FORMAT_CF16
+} iq_format_t;
+
+/* File is a header and blocks of block_samples. Little endian */
+
+typedef struct __attribute__((packed)) {
+    char        magic[4];
+    uint8_t     version;
+    uint8_t     format;         /* iq_format_t */
+    uint8_t     mode;           /* x6100_mode_t */
+    uint8_t     reserved;
+    uint32_t    rate;
+    uint32_t    block_samples;
+    uint64_t    freq;           /* Centre, Hz */
+    int64_t     time;           /* Unix time of the first block */
+} iq_header_t;
+
+/* Every block is scaled to its peak: sample = x * 2^-exp, interleaved I and Q */
+
+typedef struct __attribute__((packed)) {
+    int8_t      exp;
+    uint8_t     reserved[3];
+} iq_block_header_t;
+
+void iq_recorder_set_on(bool on);
+bool iq_recorder_is_on();
+
+/* Radio thread, never blocks */
+
+void iq_recorder_put_samples(const float complex *samples);
+
+bool iq_player_start(const char *filename);
+void iq_player_stop();
+bool iq_player_is_on();
+
+/* Radio thread, never blocks. Replace samples with the next block from the file */
+
+void iq_player_get_samples(float complex *samples);
+
+/* Block codec, shared with the offline tools */
+
+void iq_block_encode(const float complex *samples, uint32_t n, iq_format_t format, iq_block_header_t *header, uint16_t *data);
+void iq_block_decode(const iq_block_header_t *header, const uint16_t *data, uint32_t n, iq_format_t format, float complex *samples);
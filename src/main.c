@@ -7,7 +7,6 @@
  */
 
 #include "lvgl/lvgl.h"
-#include "lv_drivers/display/fbdev.h"
 #include <unistd.h>
 #include <pthread.h>
 #include <time.h>
@@ -33,8 +32,10 @@
 #include "backlight.h"
 #include "events.h"
 #include "gps.h"
+#include "fb.h"
 
 #define DISP_BUF_SIZE (128 * 1024)
+#define STATS_TIME    (60 * 1000)
 
 rotary_t                    *vol;
 encoder_t                   *mfk;
@@ -43,11 +44,35 @@ static lv_color_t           buf[DISP_BUF_SIZE];
 static lv_disp_draw_buf_t   disp_buf;
 static lv_disp_drv_t        disp_drv;
 
+/* Event queue and params journal counters, a warning when an event was dropped since the last time */
+
+static void stats_log() {
+    static uint32_t         drops = 0;
+    event_stats_t           events;
+    params_journal_stats_t  journal;
+
+    event_get_stats(&events);
+    params_journal_stats(&journal);
+
+    LV_LOG_INFO("Journal: %u flushes, %u rows, last %u us, max %u us", journal.flushes, journal.rows, journal.last_us, journal.max_us);
+
+    if (events.drops != drops) {
+        LV_LOG_WARN("Events: depth %u, max depth %u, drops %u", events.depth, events.max_depth, events.drops);
+        drops = events.drops;
+    } else {
+        LV_LOG_INFO("Events: depth %u, max depth %u", events.depth, events.max_depth);
+    }
+}
+
 int main(void) {
     lv_init();
     lv_png_init();
     
-    fbdev_init();
+    if (!fb_open("/dev/fb0")) {
+        LV_LOG_ERROR("No framebuffer, exit");
+        return 1;
+    }
+
     audio_init();
     event_init();
     
@@ -55,11 +80,10 @@ int main(void) {
     lv_disp_drv_init(&disp_drv);
     
     disp_drv.draw_buf   = &disp_buf;
-    disp_drv.flush_cb   = fbdev_flush;
+    disp_drv.flush_cb   = fb_flush;
     disp_drv.hor_res    = 480;
     disp_drv.ver_res    = 800;
-    disp_drv.sw_rotate  = 1;
-    disp_drv.rotated    = LV_DISP_ROT_90;
+    disp_drv.rotated    = LV_DISP_ROT_90;   /* Done by fb_flush() */
     
     lv_disp_drv_register(&disp_drv);
 
@@ -101,6 +125,7 @@ int main(void) {
     gps_init();
 
     uint64_t prev_time = get_time();
+    uint64_t stats_time = prev_time;
 
 #if 0    
     lv_obj_set_style_bg_opa(lv_scr_act(), LV_OPA_0, 0);
@@ -118,6 +143,11 @@ int main(void) {
         uint64_t now = get_time();
         lv_tick_inc(now - prev_time);
         prev_time = now;
+
+        if (now - stats_time > STATS_TIME) {
+            stats_time = now;
+            stats_log();
+        }
     }
 
     return 0;
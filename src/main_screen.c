@@ -251,7 +251,7 @@ void main_screen_app(uint8_t page_app) {
             voice_say_text_fmt("GPS window");
             break;
 
-        case PAGE_RECORDER:
+        case PAGE_RECORDER_1:
             dialog_construct(dialog_recorder, obj);
             voice_say_text_fmt("Audio recorder window");
             break;
@@ -321,7 +321,7 @@ void main_screen_action(press_action_t action) {
             break;
 
         case ACTION_APP_RECORDER:
-            main_screen_app(PAGE_RECORDER);
+            main_screen_app(PAGE_RECORDER_1);
             break;
 
         case ACTION_APP_QTH:
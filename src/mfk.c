@@ -492,6 +492,17 @@ void mfk_update(int16_t diff, bool voice) {
             }
             break;
             
+        case MFK_CW_SKIMMER:
+            b = cw_change_skimmer(diff);
+            msg_set_text_fmt("#%3X CW skimmer: %s", color, b ? "On" : "Off");
+
+            if (diff) {
+                voice_say_bool("CW skimmer", b);
+            } else if (voice) {
+                voice_say_text_fmt("CW skimmer switcher");
+            }
+            break;
+
         case MFK_CW_DECODER_SNR:
             f = cw_change_snr(diff);
             msg_set_text_fmt("#%3X CW decoder SNR: %.1f dB", color, f);
@@ -53,6 +53,8 @@ typedef enum {
     MFK_RIT,
     MFK_XIT,
 
+    MFK_CW_SKIMMER,
+
     MFK_LAST,
 
     /* APPs */
@@ -0,0 +1,170 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+#include "morse.h"
+
+#define MAX_PROSIGNS    16
+
+cw_characters_t cw_characters[] = {
+    { .morse = ".-",        .character = "A" },
+    { .morse = "-...",      .character = "B" },
+    { .morse = "-.-.",      .character = "C" },
+    { .morse = "-..",       .character = "D" },
+    { .morse = ".",         .character = "E" },
+    { .morse = "..-.",      .character = "F" },
+    { .morse = "--.",       .character = "G" },
+    { .morse = "....",      .character = "H" },
+    { .morse = "..",        .character = "I" },
+    { .morse = ".---",      .character = "J" },
+    { .morse = "-.-",       .character = "K" },
+    { .morse = ".-..",      .character = "L" },
+    { .morse = "--",        .character = "M" },
+    { .morse = "-.",        .character = "N" },
+    { .morse = "---",       .character = "O" },
+    { .morse = ".--.",      .character = "P" },
+    { .morse = "--.-",      .character = "Q" },
+    { .morse = ".-.",       .character = "R" },
+    { .morse = "...",       .character = "S" },
+    { .morse = "-",         .character = "T" },
+    { .morse = "..-",       .character = "U" },
+    { .morse = "...-",      .character = "V" },
+    { .morse = ".--",       .character = "W" },
+    { .morse = "-..-",      .character = "X" },
+    { .morse = "-.--",      .character = "Y" },
+    { .morse = "--..",      .character = "Z" },
+    
+    { .morse = ".----",     .character = "1" },
+    { .morse = "..---",     .character = "2" },
+    { .morse = "...--",     .character = "3" },
+    { .morse = "....-",     .character = "4" },
+    { .morse = ".....",     .character = "5" },
+    { .morse = "-....",     .character = "6" },
+    { .morse = "--...",     .character = "7" },
+    { .morse = "---..",     .character = "8" },
+    { .morse = "----.",     .character = "9" },
+    { .morse = "-----",     .character = "0" },
+    
+    { .morse = "-.-.--",    .character = "!" },
+    { .morse = "..--.",     .character = "!" },
+    { .morse = ".-..-.",    .character = "\"" },
+    { .morse = "...-..-",   .character = "$" },
+    { .morse = ".----.",    .character = "'" },
+    { .morse = "--..--",    .character = "," },
+    { .morse = "-....-",    .character = "-" },
+    { .morse = ".-.-.-",    .character = "." },
+    { .morse = "-..-.",     .character = "/" },
+    { .morse = "---...",    .character = ":" },
+    { .morse = "-.-.-.",    .character = ";" },
+    { .morse = "-...-",     .character = "=" },
+    { .morse = "..--..",    .character = "?" },
+    { .morse = ".--.-.",    .character = "@" },
+    { .morse = "..--.-",    .character = "_" },
+    
+    { .morse = ".-.-.",     .character = "<AR>" },
+    { .morse = ".-...",     .character = "<AS>" },
+    { .morse = "-...-.-",   .character = "<BK>" },
+    { .morse = "-.-..-..",  .character = "<CL>" },
+    { .morse = "-.-.-",     .character = "<CT>" },
+    { .morse = "-.--.",     .character = "<KN>" },
+    { .morse = "...-.-",    .character = "<SK>" },
+    { .morse = "...-.",     .character = "<SN>" },
+    { .morse = "...---...", .character = "<SOS>" },
+    { .morse = "-.-.--.-",  .character = "<CQ>" },
+    
+    { .morse = "......",    .character = "<ERR>" },
+    { .morse = ".......",   .character = "<ERR>" },
+    { .morse = "........",  .character = "<ERR>" },
+    { .morse = NULL }
+};
+
+static const char       *decode_tree[MORSE_CODE_LIMIT];
+static const char       *encode_ascii[128];
+static cw_characters_t  *prosigns[MAX_PROSIGNS];
+static uint8_t          prosigns_num = 0;
+static bool             ready = false;
+
+static uint16_t morse_code(const char *morse) {
+    uint16_t code = MORSE_CODE_EMPTY;
+
+    while (*morse) {
+        code = morse_code_add(code, *morse == '-');
+        morse++;
+    }
+
+    return code;
+}
+
+/* The first entry wins, both for a code and for a character */
+
+void morse_init() {
+    if (ready) {
+        return;
+    }
+
+    for (cw_characters_t *character = &cw_characters[0]; character->morse; character++) {
+        uint16_t    code = morse_code(character->morse);
+        uint8_t     c = character->character[0];
+
+        if (code < MORSE_CODE_LIMIT && !decode_tree[code]) {
+            decode_tree[code] = character->character;
+        }
+
+        if (character->character[1] == 0) {
+            if (c < 128 && !encode_ascii[c]) {
+                encode_ascii[c] = character->morse;
+                encode_ascii[tolower(c)] = character->morse;
+            }
+        } else if (prosigns_num < MAX_PROSIGNS) {
+            bool known = false;
+
+            for (uint8_t i = 0; i < prosigns_num; i++)
+                if (strcmp(prosigns[i]->character, character->character) == 0) {
+                    known = true;
+                }
+
+            if (!known) {
+                prosigns[prosigns_num++] = character;
+            }
+        }
+    }
+
+    ready = true;
+}
+
+const char * morse_decode(uint16_t code) {
+    return code < MORSE_CODE_LIMIT ? decode_tree[code] : NULL;
+}
+
+uint8_t morse_encode(const char *str, const char **morse) {
+    uint8_t c = str[0];
+
+    if (c == '<') {
+        for (uint8_t i = 0; i < prosigns_num; i++) {
+            const char  *name = prosigns[i]->character;
+            uint8_t     len = strlen(name);
+
+            if (strncasecmp(name, str, len) == 0) {
+                *morse = prosigns[i]->morse;
+                return len;
+            }
+        }
+
+        return 0;
+    }
+
+    if (c < 128 && encode_ascii[c]) {
+        *morse = encode_ascii[c];
+        return 1;
+    }
+
+    return 0;
+}
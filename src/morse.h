@@ -0,0 +1,42 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Morse code as a binary tree index: a leading 1, then a bit per element, dot 0 and dash 1.
+ * So "-." is 0b110. Codes longer than MORSE_MAX_LEN elements saturate at MORSE_CODE_LIMIT
+ */
+
+#define MORSE_MAX_LEN       9
+#define MORSE_CODE_EMPTY    1
+#define MORSE_CODE_LIMIT    (1 << (MORSE_MAX_LEN + 1))
+
+typedef struct {
+    char    *morse;
+    char    *character;
+} cw_characters_t;
+
+extern cw_characters_t cw_characters[];
+
+void morse_init();
+
+static inline uint16_t morse_code_add(uint16_t code, bool dash) {
+    return code < MORSE_CODE_LIMIT / 2 ? (code << 1) | dash : MORSE_CODE_LIMIT;
+}
+
+/* Character of the code, or NULL */
+
+const char * morse_decode(uint16_t code);
+
+/* Elements for the character (or prosign) at str, return the length of it, or 0 */
+
+uint8_t morse_encode(const char *str, const char **morse);
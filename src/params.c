@@ -8,7 +8,11 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 #include <pthread.h>
+#include <time.h>
 #include <sqlite3.h>
 
 #include "lvgl/lvgl.h"
@@ -22,6 +26,8 @@
 #include "voice.h"
 
 #define PARAMS_SAVE_TIMEOUT  (3 * 1000)
+#define JOURNAL_SIZE         256
+#define JOURNAL_SLOW_US      (50 * 1000)
 
 params_t params = {
     .vol_modes              = (1 << VOL_VOL) | (1 << VOL_RFG) | (1 << VOL_FILTER_LOW) | (1 << VOL_FILTER_HIGH) | (1 << VOL_PWR) | (1 << VOL_HMIC),
@@ -39,6 +45,7 @@ params_t params = {
     .spectrum_peak_speed    = 0.5f,
     .spectrum_auto_min      = { .x = true,  .name = "spectrum_auto_min",    .voice = "Auto minimum of spectrum" },
     .spectrum_auto_max      = { .x = true,  .name = "spectrum_auto_max",    .voice = "Auto maximum of spectrum" },
+    .spectrum_aa            = { .x = false, .name = "spectrum_aa",          .voice = "Spectrum antialiasing" },
     .waterfall_auto_min     = { .x = true,  .name = "waterfall_auto_min",   .voice = "Auto minimum of waterfall" },
     .waterfall_auto_max     = { .x = true,  .name = "waterfall_auto_max",   .voice = "Auto maximum of waterfall" },
     .mag_freq               = { .x = true,  .name = "mag_freq",             .voice = "Magnification of frequency" },
@@ -99,6 +106,7 @@ params_t params = {
     .cw_decoder_snr_gist    = 3.0f,
     .cw_decoder_peak_beta   = 0.10f,
     .cw_decoder_noise_beta  = 0.80f,
+    .cw_skimmer             = { .x = false,     .name = "cw_skimmer" },
 
     .cw_encoder_period      = 10,
     .voice_msg_period       = 10,
@@ -118,6 +126,7 @@ params_t params = {
     .ft8_band               = 5,
     .ft8_tx_freq            = { .x = 1325,      .name = "ft8_tx_freq" },
     .ft8_auto               = { .x = true,      .name = "ft8_auto" },
+    .ft8_budget             = { .x = 1000,      .name = "ft8_budget" },
 
     .long_gen               = ACTION_SCREENSHOT,
     .long_app               = ACTION_APP_RECORDER,
@@ -133,6 +142,8 @@ params_t params = {
     
     .play_gain              = 100,
     .rec_gain               = 100,
+    .rec_format             = { .x = REC_FORMAT_MP3,    .name = "rec_format" },
+    .iq_format              = { .x = 0,                 .name = "iq_format" },
 
     .voice_mode             = { .x = VOICE_LCD,                                 .name = "voice_mode" },
     .voice_lang             = { .x = 0,   .min = 0,  .max = (VOICES_NUM - 1),   .name = "voice_lang" },
@@ -180,786 +191,784 @@ transverter_t params_transverter[TRANSVERTER_NUM] = {
     { .from = 144000000,    .to = 150000000,    .shift = 116000000 },
     { .from = 432000000,    .to = 438000000,    .shift = 404000000 }
 };
+/* Schema. Every persistent field is described once: name, place in its struct, durty flag and type */
+
+typedef enum {
+    PARAM_BOOL = 0,
+    PARAM_INT8,
+    PARAM_UINT8,
+    PARAM_INT16,
+    PARAM_UINT16,
+    PARAM_INT32,
+    PARAM_UINT32,
+    PARAM_UINT64,
+    PARAM_FLOAT,
+    PARAM_TEXT
+} param_type_t;
+
+typedef struct {
+    const char      *name;
+    uint16_t        offset;
+    uint16_t        durty;          /* Offset of the durty flag */
+    int16_t         fallback;       /* Offset of the field to copy when the row is missing, or -1 */
+    uint16_t        size;
+    param_type_t    type;
+    float           scale;          /* Floats are stored as integers x * scale */
+} param_schema_t;
+
+/* Enums are compatible with int or unsigned int, both fall to 32 bits */
+
+#define PARAM_TYPE(x) _Generic((x), \
+    bool:       PARAM_BOOL,         \
+    int8_t:     PARAM_INT8,         \
+    uint8_t:    PARAM_UINT8,        \
+    int16_t:    PARAM_INT16,        \
+    uint16_t:   PARAM_UINT16,       \
+    uint32_t:   PARAM_UINT32,       \
+    uint64_t:   PARAM_UINT64,       \
+    float:      PARAM_FLOAT,        \
+    char *:     PARAM_TEXT,         \
+    default:    PARAM_INT32)
+
+#define PARAM_ENTRY(s, key, field, flag, fb, k) \
+    { key, offsetof(s, field), offsetof(s, flag), fb, sizeof(((s *) 0)->field), PARAM_TYPE(((s *) 0)->field), k }
+
+#define PARAM(field)                PARAM_ENTRY(params_t, #field, field, durty.field, -1, 1.0f)
+#define PARAM_SCALED(field, k)      PARAM_ENTRY(params_t, #field, field, durty.field, -1, k)
+#define PARAM_ITEM(field)           PARAM_ENTRY(params_t, #field, field.x, field.durty, -1, 1.0f)
+
+#define BAND(field)                 PARAM_ENTRY(params_band_t, #field, field, durty.field, -1, 1.0f)
+#define BAND_VFOA(key, field)       PARAM_ENTRY(params_band_t, key, vfo_x[X6100_VFO_A].field, vfo_x[X6100_VFO_A].durty.field, -1, 1.0f)
+#define BAND_VFOB(key, field)       PARAM_ENTRY(params_band_t, key, vfo_x[X6100_VFO_B].field, vfo_x[X6100_VFO_B].durty.field, \
+                                        offsetof(params_band_t, vfo_x[X6100_VFO_A].field), 1.0f)
+
+#define MODE(field)                 PARAM_ENTRY(params_mode_t, #field, field, durty.field, -1, 1.0f)
+#define TRANSVERTER(field)          PARAM_ENTRY(transverter_t, #field, field, durty.field, -1, 1.0f)
+
+#define SCHEMA_SIZE(x)              (sizeof(x) / sizeof(x[0]))
+
+static param_schema_t params_schema[] = {
+    PARAM(band),                PARAM(vol),                 PARAM(rfg),                 PARAM(sql),
+    PARAM(atu),                 PARAM_SCALED(pwr, 10),      PARAM(ant),                 PARAM(rit),
+    PARAM(xit),                 PARAM(mic),                 PARAM(hmic),                PARAM(imic),
+    PARAM(charger),             PARAM(line_in),             PARAM(line_out),            PARAM(moni),
+    PARAM(vol_modes),           PARAM(mfk_modes),
+
+    PARAM(spectrum_beta),       PARAM(spectrum_filled),     PARAM(spectrum_peak),       PARAM(spectrum_peak_hold),
+    PARAM_SCALED(spectrum_peak_speed, 10),
+
+    PARAM(key_speed),           PARAM(key_mode),            PARAM(iambic_mode),         PARAM(key_tone),
+    PARAM(key_vol),             PARAM(key_train),           PARAM(qsk_time),            PARAM(key_ratio),
+
+    PARAM(dnf),                 PARAM(dnf_center),          PARAM(dnf_width),
+    PARAM(nb),                  PARAM(nb_level),            PARAM(nb_width),
+    PARAM(nr),                  PARAM(nr_level),
+    PARAM(agc_hang),            PARAM(agc_knee),            PARAM(agc_slope),
+
+    PARAM(cw_decoder),          PARAM_SCALED(cw_decoder_snr, 10),
+    PARAM_SCALED(cw_decoder_peak_beta, 100),                PARAM_SCALED(cw_decoder_noise_beta, 100),
+    PARAM(cw_encoder_period),   PARAM(voice_msg_period),
+
+    PARAM(rtty_rate),           PARAM(rtty_shift),          PARAM(rtty_center),         PARAM(rtty_reverse),
+
+    PARAM(brightness_normal),   PARAM(brightness_idle),     PARAM(brightness_timeout),  PARAM(brightness_buttons),
+    PARAM(clock_view),          PARAM(clock_time_timeout),  PARAM(clock_power_timeout), PARAM(clock_tx_timeout),
+
+    PARAM(swrscan_linear),      PARAM(swrscan_span),
+    PARAM(ft8_show_all),        PARAM(ft8_band),            PARAM(ft8_protocol),
+
+    PARAM(long_gen),            PARAM(long_app),            PARAM(long_key),            PARAM(long_msg),
+    PARAM(long_dfn),            PARAM(long_dfl),
+    PARAM(press_f1),            PARAM(press_f2),            PARAM(long_f1),             PARAM(long_f2),
+
+    PARAM(play_gain),           PARAM(rec_gain),
+
+    PARAM_ITEM(spmode),             PARAM_ITEM(freq_accel),
+    PARAM_ITEM(spectrum_auto_min),  PARAM_ITEM(spectrum_auto_max),  PARAM_ITEM(spectrum_aa),
+    PARAM_ITEM(waterfall_auto_min), PARAM_ITEM(waterfall_auto_max),
+    PARAM_ITEM(mag_freq),           PARAM_ITEM(mag_info),           PARAM_ITEM(mag_alc),
+    PARAM_ITEM(cw_skimmer),
+    PARAM_ITEM(ft8_tx_freq),        PARAM_ITEM(ft8_auto),           PARAM_ITEM(ft8_budget),
+    PARAM_ITEM(rec_format),         PARAM_ITEM(iq_format),
+    PARAM_ITEM(voice_mode),         PARAM_ITEM(voice_lang),         PARAM_ITEM(voice_rate),
+    PARAM_ITEM(voice_pitch),        PARAM_ITEM(voice_volume),
+    PARAM_ITEM(qth),                PARAM_ITEM(callsign),
+};
+
+/* Shared by band_params and memory */
+
+static param_schema_t band_schema[] = {
+    BAND(vfo),
+    BAND_VFOA("vfoa_freq", freq),   BAND_VFOA("vfoa_att", att),     BAND_VFOA("vfoa_pre", pre),
+    BAND_VFOA("vfoa_mode", mode),   BAND_VFOA("vfoa_agc", agc),
+    BAND_VFOB("vfob_freq", freq),   BAND_VFOB("vfob_att", att),     BAND_VFOB("vfob_pre", pre),
+    BAND_VFOB("vfob_mode", mode),   BAND_VFOB("vfob_agc", agc),
+    BAND(grid_min),                 BAND(grid_max),                 BAND(label),
+};
+
+static param_schema_t mode_schema[] = {
+    MODE(filter_low),   MODE(filter_high),  MODE(freq_step),    MODE(spectrum_factor),
+};
+
+static param_schema_t transverter_schema[] = {
+    TRANSVERTER(from),  TRANSVERTER(to),    TRANSVERTER(shift),
+};
+
+/* Write-behind journal. Dirty values are copied in under params_mux, SQL runs later without it */
+
+typedef enum {
+    JOURNAL_PARAMS = 0,
+    JOURNAL_BAND,
+    JOURNAL_MEMORY,
+    JOURNAL_MODE,
+    JOURNAL_TRANSVERTER,
+    JOURNAL_ATU,                        /* id is atu_key(), name is NULL */
+
+    JOURNAL_TABLES
+} journal_table_t;
+
+typedef struct {
+    journal_table_t     table;
+    int32_t             id;
+    const char          *name;          /* Static */
+    bool                is_text;
+    int64_t             val;
+    char                text[32];
+} journal_entry_t;
+
+/* Rows of band_params, memory and mode_params mirrored in memory, so switching is a copy */
+
+#define CACHE_FIELDS    16
+
+typedef struct {
+    int32_t             id;
+    uint32_t            present;        /* Bit per schema entry */
+    int64_t             val[CACHE_FIELDS];
+    char                text[64];
+} cache_entry_t;
+
+typedef struct {
+    cache_entry_t       *entries;
+    uint16_t            count;
+} cache_t;
+
+_Static_assert(SCHEMA_SIZE(band_schema) <= CACHE_FIELDS, "band_schema does not fit the cache");
+_Static_assert(SCHEMA_SIZE(mode_schema) <= CACHE_FIELDS, "mode_schema does not fit the cache");
 
 static pthread_mutex_t  params_mux;
 static uint64_t         durty_time;
 static sqlite3          *db = NULL;
-static sqlite3_stmt     *write_stmt;
-static sqlite3_stmt     *write_mb_stmt;
-static sqlite3_stmt     *write_mode_stmt;
-static sqlite3_stmt     *save_atu_stmt;
-static sqlite3_stmt     *load_atu_stmt;
-static sqlite3_stmt     *bands_find_all_stmt;
-static sqlite3_stmt     *bands_find_stmt;
 
-static bool params_exec(const char *sql);
-static bool params_mb_save(uint16_t id);
-static void params_mb_load(sqlite3_stmt *stmt);
+static pthread_mutex_t  db_mux = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t  journal_mux = PTHREAD_MUTEX_INITIALIZER;
+static journal_entry_t  *journal = NULL;       /* Grows, so adding never waits for SQL */
+static uint32_t         journal_len = 0;
+static uint32_t         journal_size = 0;
+static params_journal_stats_t journal_stats;
+static sqlite3_stmt     *journal_stmt[JOURNAL_TABLES];
 
-/* Mode params */
+static pthread_mutex_t  cache_mux = PTHREAD_MUTEX_INITIALIZER;
+static cache_t          cache[JOURNAL_TABLES];
 
-void params_mode_load() {
-    sqlite3_stmt    *stmt;
-    int             rc;
+/* ATU memory, the whole atu table sorted by atu_key() */
 
-    rc = sqlite3_prepare_v2(db, "SELECT name,val FROM mode_params WHERE mode = ?", -1, &stmt, 0);
+#define ATU_STEP        50000           /* Hz per stored network */
+#define ATU_NEAREST     1               /* Steps to look around when there is no exact match */
 
-    if (rc != SQLITE_OK) {
-        LV_LOG_ERROR("Prepare");
-        return;
-    }
+typedef struct {
+    uint32_t            key;
+    uint32_t            val;
+} atu_entry_t;
 
-    x6100_mode_t    mode = radio_current_mode();
+static pthread_mutex_t  atu_mux = PTHREAD_MUTEX_INITIALIZER;
+static atu_entry_t      *atu = NULL;
+static uint32_t         atu_count = 0;
+static uint32_t         atu_size = 0;
+static sqlite3_stmt     *msg_cw_load_stmt;
+static sqlite3_stmt     *msg_cw_new_stmt;
+static sqlite3_stmt     *msg_cw_edit_stmt;
+static sqlite3_stmt     *msg_cw_delete_stmt;
 
-    sqlite3_bind_int(stmt, 1, mode);
+static bool params_exec(const char *sql);
+static void params_mb_save(journal_table_t table, uint16_t id);
+static void params_mb_load(journal_table_t table, int32_t id);
 
-    while (sqlite3_step(stmt) != SQLITE_DONE) {
-        const char *name = sqlite3_column_text(stmt, 0);
+/* Schema */
 
-        if (strcmp(name, "filter_low") == 0) {
-            params_mode.filter_low = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "filter_high") == 0) {
-            params_mode.filter_high = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "freq_step") == 0) {
-            params_mode.freq_step = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "spectrum_factor") == 0) {
-            params_mode.spectrum_factor = sqlite3_column_int(stmt, 1);
-        }
-    }
+static int schema_cmp(const void *a, const void *b) {
+    return strcmp(((const param_schema_t *) a)->name, ((const param_schema_t *) b)->name);
+}
 
-    sqlite3_finalize(stmt);
+static void schema_sort(param_schema_t *schema, size_t n) {
+    qsort(schema, n, sizeof(param_schema_t), schema_cmp);
 }
 
-static void params_mode_write_int(const char *name, int data, bool *durty) {
-    x6100_mode_t    mode = radio_current_mode();
+static const param_schema_t * schema_find(const param_schema_t *schema, size_t n, const char *name) {
+    param_schema_t key = { .name = name };
 
-    sqlite3_bind_int(write_mode_stmt, 1, mode);
-    sqlite3_bind_text(write_mode_stmt, 2, name, strlen(name), 0);
-    sqlite3_bind_int(write_mode_stmt, 3, data);
-    sqlite3_step(write_mode_stmt);
-    sqlite3_reset(write_mode_stmt);
-    sqlite3_clear_bindings(write_mode_stmt);
-    
-    *durty = false;
+    if (name == NULL) {
+        return NULL;
+    }
+
+    return bsearch(&key, schema, n, sizeof(param_schema_t), schema_cmp);
 }
 
-void params_mode_save() {
-    if (!params_exec("BEGIN")) {
-        return;
+static int64_t param_get(const void *base, const param_schema_t *p) {
+    const void *x = (const uint8_t *) base + p->offset;
+
+    switch (p->type) {
+        case PARAM_BOOL:    return *(const bool *) x;
+        case PARAM_INT8:    return *(const int8_t *) x;
+        case PARAM_UINT8:   return *(const uint8_t *) x;
+        case PARAM_INT16:   return *(const int16_t *) x;
+        case PARAM_UINT16:  return *(const uint16_t *) x;
+        case PARAM_INT32:   return *(const int32_t *) x;
+        case PARAM_UINT32:  return *(const uint32_t *) x;
+        case PARAM_UINT64:  return *(const uint64_t *) x;
+        case PARAM_FLOAT:   return *(const float *) x * p->scale;
+        default:            return 0;
     }
+}
 
-    if (params_mode.durty.filter_low)       params_mode_write_int("filter_low", params_mode.filter_low, &params_mode.durty.filter_low);
-    if (params_mode.durty.filter_high)      params_mode_write_int("filter_high", params_mode.filter_high, &params_mode.durty.filter_high);
-    if (params_mode.durty.freq_step)        params_mode_write_int("freq_step", params_mode.freq_step, &params_mode.durty.freq_step);
-    if (params_mode.durty.spectrum_factor)  params_mode_write_int("spectrum_factor", params_mode.spectrum_factor, &params_mode.durty.spectrum_factor);
+static void param_set(void *base, const param_schema_t *p, int64_t val, const char *text) {
+    void *x = (uint8_t *) base + p->offset;
+
+    switch (p->type) {
+        case PARAM_BOOL:    *(bool *) x = val;                  break;
+        case PARAM_INT8:    *(int8_t *) x = val;                break;
+        case PARAM_UINT8:   *(uint8_t *) x = val;               break;
+        case PARAM_INT16:   *(int16_t *) x = val;               break;
+        case PARAM_UINT16:  *(uint16_t *) x = val;              break;
+        case PARAM_INT32:   *(int32_t *) x = val;               break;
+        case PARAM_UINT32:  *(uint32_t *) x = val;              break;
+        case PARAM_UINT64:  *(uint64_t *) x = val;              break;
+        case PARAM_FLOAT:   *(float *) x = val / p->scale;      break;
+
+        case PARAM_TEXT:
+            if (text) {
+                strncpy(x, text, p->size - 1);
+                ((char *) x)[p->size - 1] = 0;
+            }
+            break;
+    }
+}
 
-    params_exec("COMMIT");
+static void param_set_column(void *base, const param_schema_t *p, sqlite3_stmt *stmt, int col) {
+    param_set(base, p, sqlite3_column_int64(stmt, col), (const char *) sqlite3_column_text(stmt, col));
 }
 
-/* Memory/Bands params */
+/* Cache */
 
-void params_memory_load(uint16_t id) {
-    sqlite3_stmt *stmt;
+static cache_entry_t * cache_find(journal_table_t table, int32_t id, bool create) {
+    cache_t *c = &cache[table];
 
-    int rc = sqlite3_prepare_v2(db, "SELECT name,val FROM memory WHERE id = ?", -1, &stmt, 0);
+    for (uint16_t i = 0; i < c->count; i++)
+        if (c->entries[i].id == id) {
+            return &c->entries[i];
+        }
 
-    if (rc != SQLITE_OK) {
-        LV_LOG_ERROR("Prepare");
-        return;
+    if (!create) {
+        return NULL;
     }
 
-    sqlite3_bind_int(stmt, 1, id);
-    params_mb_load(stmt);
-}
+    cache_entry_t *entries = realloc(c->entries, (c->count + 1) * sizeof(cache_entry_t));
 
-void params_band_load() {
-    if (params.band < 0) {
-        return;
+    if (!entries) {
+        return NULL;
     }
 
-    sqlite3_stmt *stmt;
+    c->entries = entries;
 
-    int rc = sqlite3_prepare_v2(db, "SELECT name,val FROM band_params WHERE bands_id = ?", -1, &stmt, 0);
+    cache_entry_t *entry = &c->entries[c->count++];
 
-    if (rc != SQLITE_OK) {
-        LV_LOG_ERROR("Prepare");
-        return;
+    memset(entry, 0, sizeof(*entry));
+    entry->id = id;
+
+    return entry;
+}
+
+static void cache_put(journal_table_t table, int32_t id, uint8_t index, int64_t val, const char *text) {
+    pthread_mutex_lock(&cache_mux);
+
+    cache_entry_t *entry = cache_find(table, id, true);
+
+    if (entry) {
+        entry->present |= 1 << index;
+        entry->val[index] = val;
+
+        if (text) {
+            strncpy(entry->text, text, sizeof(entry->text) - 1);
+        }
     }
 
-    sqlite3_bind_int(stmt, 1, params.band);
-    params_mb_load(stmt);
+    pthread_mutex_unlock(&cache_mux);
 }
 
-static void params_mb_load(sqlite3_stmt *stmt) {
-    bool copy_freq = true;
-    bool copy_att = true;
-    bool copy_pre = true;
-    bool copy_mode = true;
-    bool copy_agc = true;
+/* Copy cached values into base, missing fields with a fallback are copied from it. Returns false if there is nothing for this id */
 
-    memset(params_band.label, 0, sizeof(params_band.label));
-    
-    while (sqlite3_step(stmt) != SQLITE_DONE) {
-        const char *name = sqlite3_column_text(stmt, 0);
-
-        if (strcmp(name, "vfo") == 0) {
-            params_band.vfo = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "vfoa_freq") == 0) {
-            params_band.vfo_x[X6100_VFO_A].freq = sqlite3_column_int64(stmt, 1);
-        } else if (strcmp(name, "vfoa_att") == 0) {
-            params_band.vfo_x[X6100_VFO_A].att = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "vfoa_pre") == 0) {
-            params_band.vfo_x[X6100_VFO_A].pre = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "vfoa_mode") == 0) {
-            params_band.vfo_x[X6100_VFO_A].mode = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "vfoa_agc") == 0) {
-            params_band.vfo_x[X6100_VFO_A].agc = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "vfob_freq") == 0) {
-            params_band.vfo_x[X6100_VFO_B].freq = sqlite3_column_int64(stmt, 1);
-            copy_freq = false;
-        } else if (strcmp(name, "vfob_att") == 0) {
-            params_band.vfo_x[X6100_VFO_B].att = sqlite3_column_int(stmt, 1);
-            copy_att = false;
-        } else if (strcmp(name, "vfob_pre") == 0) {
-            params_band.vfo_x[X6100_VFO_B].pre = sqlite3_column_int(stmt, 1);
-            copy_pre = false;
-        } else if (strcmp(name, "vfob_mode") == 0) {
-            params_band.vfo_x[X6100_VFO_B].mode = sqlite3_column_int(stmt, 1);
-            copy_mode = false;
-        } else if (strcmp(name, "vfob_agc") == 0) {
-            params_band.vfo_x[X6100_VFO_B].agc = sqlite3_column_int(stmt, 1);
-            copy_agc = false;
-        } else if (strcmp(name, "grid_min") == 0) {
-            params_band.grid_min = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "grid_max") == 0) {
-            params_band.grid_max = sqlite3_column_int(stmt, 1);
-        } else if (strcmp(name, "label") == 0) {
-            strncpy(params_band.label, sqlite3_column_text(stmt, 1), sizeof(params_band.label) - 1);
+static bool cache_apply(journal_table_t table, int32_t id, void *base, const param_schema_t *schema, size_t n) {
+    pthread_mutex_lock(&cache_mux);
+
+    cache_entry_t   *entry = cache_find(table, id, false);
+    uint32_t        present = entry ? entry->present : 0;
+
+    for (uint8_t i = 0; i < n; i++)
+        if (present & (1 << i)) {
+            param_set(base, &schema[i], entry->val[i], entry->text);
         }
+
+    for (uint8_t i = 0; i < n; i++)
+        if (!(present & (1 << i)) && schema[i].fallback >= 0) {
+            memcpy((uint8_t *) base + schema[i].offset, (uint8_t *) base + schema[i].fallback, schema[i].size);
+        }
+
+    pthread_mutex_unlock(&cache_mux);
+
+    return entry != NULL;
+}
+
+static void cache_preload(journal_table_t table, const char *sql, const param_schema_t *schema, size_t n) {
+    sqlite3_stmt    *stmt;
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) {
+        LV_LOG_ERROR("Prepare preload %i", table);
+        return;
     }
 
-    if (copy_freq)  params_band.vfo_x[X6100_VFO_B].freq = params_band.vfo_x[X6100_VFO_A].freq;
-    if (copy_att)   params_band.vfo_x[X6100_VFO_B].att = params_band.vfo_x[X6100_VFO_A].att;
-    if (copy_pre)   params_band.vfo_x[X6100_VFO_B].pre = params_band.vfo_x[X6100_VFO_A].pre;
-    if (copy_mode)  params_band.vfo_x[X6100_VFO_B].mode = params_band.vfo_x[X6100_VFO_A].mode;
-    if (copy_agc)   params_band.vfo_x[X6100_VFO_B].agc = params_band.vfo_x[X6100_VFO_A].agc;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const param_schema_t *p = schema_find(schema, n, (const char *) sqlite3_column_text(stmt, 1));
+
+        if (p) {
+            const char *text = (p->type == PARAM_TEXT) ? (const char *) sqlite3_column_text(stmt, 2) : NULL;
+
+            cache_put(table, sqlite3_column_int(stmt, 0), p - schema, sqlite3_column_int64(stmt, 2), text);
+        }
+    }
 
     sqlite3_finalize(stmt);
-    params_mode_load();
 }
 
-static void params_mb_write_int(uint16_t id, const char *name, int data, bool *durty) {
-    sqlite3_bind_int(write_mb_stmt, 1, id);
-    sqlite3_bind_text(write_mb_stmt, 2, name, strlen(name), 0);
-    sqlite3_bind_int(write_mb_stmt, 3, data);
-    sqlite3_step(write_mb_stmt);
-    sqlite3_reset(write_mb_stmt);
-    sqlite3_clear_bindings(write_mb_stmt);
-    
-    *durty = false;
-}
+/* ATU memory */
 
-static void params_mb_write_int64(uint16_t id, const char *name, uint64_t data, bool *durty) {
-    sqlite3_bind_int(write_mb_stmt, 1, id);
-    sqlite3_bind_text(write_mb_stmt, 2, name, strlen(name), 0);
-    sqlite3_bind_int64(write_mb_stmt, 3, data);
-    sqlite3_step(write_mb_stmt);
-    sqlite3_reset(write_mb_stmt);
-    sqlite3_clear_bindings(write_mb_stmt);
-    
-    *durty = false;
+static uint32_t atu_key(uint8_t ant, uint64_t freq) {
+    return (ant << 24) | ((freq / ATU_STEP) & 0xFFFFFF);
 }
 
-void params_band_save() {
-    if (params.band < 0) {
-        return;
+/* Index of the first entry with key >= x */
+
+static uint32_t atu_lower(uint32_t x) {
+    uint32_t lo = 0;
+    uint32_t hi = atu_count;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (atu[mid].key < x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
 
-    if (!params_exec("BEGIN")) {
-        return;
+    return lo;
+}
+
+static void atu_put(uint32_t key, uint32_t val) {
+    pthread_mutex_lock(&atu_mux);
+
+    uint32_t i = atu_lower(key);
+
+    if (i < atu_count && atu[i].key == key) {
+        atu[i].val = val;
+    } else {
+        if (atu_count == atu_size) {
+            uint32_t    size = atu_size ? atu_size * 2 : 256;
+            atu_entry_t *next = realloc(atu, size * sizeof(atu_entry_t));
+
+            if (!next) {
+                pthread_mutex_unlock(&atu_mux);
+                return;
+            }
+
+            atu = next;
+            atu_size = size;
+        }
+
+        memmove(&atu[i + 1], &atu[i], (atu_count - i) * sizeof(atu_entry_t));
+        atu[i].key = key;
+        atu[i].val = val;
+        atu_count++;
     }
 
-    sqlite3_prepare_v2(db, "INSERT INTO band_params(bands_id, name, val) VALUES(?, ?, ?)", -1, &write_mb_stmt, 0);
-    
-    params_mb_save(params.band);
-    sqlite3_finalize(write_mb_stmt);
+    pthread_mutex_unlock(&atu_mux);
 }
 
-void params_memory_save(uint16_t id) {
-    if (!params_exec("BEGIN")) {
+static void atu_preload() {
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db, "SELECT ant,freq,val FROM atu", -1, &stmt, 0) != SQLITE_OK) {
+        LV_LOG_ERROR("Prepare atu preload");
         return;
     }
 
-    sqlite3_prepare_v2(db, "INSERT INTO memory(id, name, val) VALUES(?, ?, ?)", -1, &write_mb_stmt, 0);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        uint32_t key = (sqlite3_column_int(stmt, 0) << 24) | (sqlite3_column_int(stmt, 1) & 0xFFFFFF);
 
-    params_band.durty.vfo = true;
-    
-    for (uint8_t i = X6100_VFO_A; i <= X6100_VFO_B; i++) {
-        params_band.vfo_x[i].durty.freq = true;
-        params_band.vfo_x[i].durty.att = true;
-        params_band.vfo_x[i].durty.pre = true;
-        params_band.vfo_x[i].durty.mode = true;
-        params_band.vfo_x[i].durty.agc = true;
+        atu_put(key, sqlite3_column_int64(stmt, 2));
     }
-    
-    params_band.durty.grid_min = true;
-    params_band.durty.grid_max = true;
-    
-    params_mb_save(id);
-    sqlite3_finalize(write_mb_stmt);
+
+    sqlite3_finalize(stmt);
 }
 
-static bool params_mb_save(uint16_t id) {
-    if (params_band.durty.vfo)
-        params_mb_write_int(id, "vfo", params_band.vfo, &params_band.durty.vfo);
-    
-    if (params_band.vfo_x[X6100_VFO_A].durty.freq)
-        params_mb_write_int64(id, "vfoa_freq", params_band.vfo_x[X6100_VFO_A].freq, &params_band.vfo_x[X6100_VFO_A].durty.freq);
-        
-    if (params_band.vfo_x[X6100_VFO_A].durty.att)
-        params_mb_write_int(id, "vfoa_att", params_band.vfo_x[X6100_VFO_A].att, &params_band.vfo_x[X6100_VFO_A].durty.att);
-        
-    if (params_band.vfo_x[X6100_VFO_A].durty.pre)
-        params_mb_write_int(id, "vfoa_pre", params_band.vfo_x[X6100_VFO_A].pre, &params_band.vfo_x[X6100_VFO_A].durty.pre);
-        
-    if (params_band.vfo_x[X6100_VFO_A].durty.mode)
-        params_mb_write_int(id, "vfoa_mode", params_band.vfo_x[X6100_VFO_A].mode, &params_band.vfo_x[X6100_VFO_A].durty.mode);
-        
-    if (params_band.vfo_x[X6100_VFO_A].durty.agc)
-        params_mb_write_int(id, "vfoa_agc", params_band.vfo_x[X6100_VFO_A].agc, &params_band.vfo_x[X6100_VFO_A].durty.agc);
+/* Journal */
 
-    if (params_band.vfo_x[X6100_VFO_B].durty.freq)
-        params_mb_write_int64(id, "vfob_freq", params_band.vfo_x[X6100_VFO_B].freq, &params_band.vfo_x[X6100_VFO_B].durty.freq);
-        
-    if (params_band.vfo_x[X6100_VFO_B].durty.att)
-        params_mb_write_int(id, "vfob_att", params_band.vfo_x[X6100_VFO_B].att, &params_band.vfo_x[X6100_VFO_B].durty.att);
-        
-    if (params_band.vfo_x[X6100_VFO_B].durty.pre)
-        params_mb_write_int(id, "vfob_pre", params_band.vfo_x[X6100_VFO_B].pre, &params_band.vfo_x[X6100_VFO_B].durty.pre);
-        
-    if (params_band.vfo_x[X6100_VFO_B].durty.mode)
-        params_mb_write_int(id, "vfob_mode", params_band.vfo_x[X6100_VFO_B].mode, &params_band.vfo_x[X6100_VFO_B].durty.mode);
-        
-    if (params_band.vfo_x[X6100_VFO_B].durty.agc)
-        params_mb_write_int(id, "vfob_agc", params_band.vfo_x[X6100_VFO_B].agc, &params_band.vfo_x[X6100_VFO_B].durty.agc);
+/* Entry for the value, a new one when there is none. journal_mux is held */
 
-    if (params_band.durty.grid_min)
-        params_mb_write_int(id, "grid_min", params_band.grid_min, &params_band.durty.grid_min);
-        
-    if (params_band.durty.grid_max)
-        params_mb_write_int(id, "grid_max", params_band.grid_max, &params_band.durty.grid_max);
+static journal_entry_t * journal_entry(journal_table_t table, int32_t id, const char *name, bool *found) {
+    for (uint32_t i = 0; i < journal_len; i++)
+        if (journal[i].table == table && journal[i].id == id && journal[i].name == name) {
+            *found = true;
+            return &journal[i];
+        }
 
-    if (!params_exec("COMMIT")) {
-        return false;
-    }
+    *found = false;
 
-    params_mode_save();
+    if (journal_len == journal_size) {
+        uint32_t        size = journal_size ? journal_size * 2 : JOURNAL_SIZE;
+        journal_entry_t *x = realloc(journal, size * sizeof(journal_entry_t));
 
-    return true;
+        if (!x) {
+            LV_LOG_ERROR("Journal is full");
+            return NULL;
+        }
+
+        journal = x;
+        journal_size = size;
+    }
+
+    return &journal[journal_len++];
 }
 
-/* System params */
+static void journal_add(journal_table_t table, int32_t id, const char *name, int64_t val, const char *text) {
+    pthread_mutex_lock(&journal_mux);
 
-static bool params_load_bool(params_bool_t *var, const char *name, const int32_t x) {
-    if (strcmp(name, var->name) == 0) {
-        var->x = x;
-        return true;
+    bool            found;
+    journal_entry_t *entry = journal_entry(table, id, name, &found);
+
+    if (entry) {
+        entry->table = table;
+        entry->id = id;
+        entry->name = name;
+        entry->val = val;
+        entry->is_text = (text != NULL);
+
+        if (text) {
+            strncpy(entry->text, text, sizeof(entry->text) - 1);
+            entry->text[sizeof(entry->text) - 1] = 0;
+        }
     }
-    
-    return false;
+
+    pthread_mutex_unlock(&journal_mux);
 }
 
-static bool params_load_uint8(params_uint8_t *var, const char *name, const int32_t x) {
-    if (strcmp(name, var->name) == 0) {
-        var->x = x;
-        return true;
+/* Put back the entries of a failed flush, unless they were set again meanwhile */
+
+static void journal_restore(const journal_entry_t *entries, uint32_t n) {
+    pthread_mutex_lock(&journal_mux);
+
+    for (uint32_t i = 0; i < n; i++) {
+        const journal_entry_t   *old = &entries[i];
+        bool                    found;
+        journal_entry_t         *entry = journal_entry(old->table, old->id, old->name, &found);
+
+        if (entry && !found) {
+            *entry = *old;
+        }
     }
-    
-    return false;
+
+    pthread_mutex_unlock(&journal_mux);
 }
 
-static bool params_load_uint16(params_uint16_t *var, const char *name, const int32_t x) {
-    if (strcmp(name, var->name) == 0) {
-        var->x = x;
+static bool journal_write(const journal_entry_t *entry) {
+    sqlite3_stmt    *stmt = journal_stmt[entry->table];
+    int             col = 1;
+
+    if (!stmt) {
         return true;
     }
-    
-    return false;
-}
 
-static bool params_load_str(params_str_t *var, const char *name, const char *x) {
-    if (strcmp(name, var->name) == 0) {
-        strncpy(var->x, x, sizeof(var->x) - 1);
-        return true;
+    if (entry->table == JOURNAL_ATU) {
+        sqlite3_bind_int(stmt, col++, entry->id >> 24);
+        sqlite3_bind_int(stmt, col++, entry->id & 0xFFFFFF);
+    } else {
+        if (entry->table != JOURNAL_PARAMS) {
+            sqlite3_bind_int(stmt, col++, entry->id);
+        }
+
+        sqlite3_bind_text(stmt, col++, entry->name, -1, SQLITE_STATIC);
     }
-    
-    return false;
+
+    if (entry->is_text) {
+        sqlite3_bind_text(stmt, col, entry->text, -1, SQLITE_STATIC);
+    } else {
+        sqlite3_bind_int64(stmt, col, entry->val);
+    }
+
+    int rc = sqlite3_step(stmt);
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    return rc == SQLITE_DONE;
 }
 
-static bool params_load() {
-    sqlite3_stmt    *stmt;
-    int             rc;
-    
-    rc = sqlite3_prepare_v2(db, "SELECT * FROM params", -1, &stmt, 0);
-    
-    if (rc != SQLITE_OK) {
-        return false;
+static uint64_t get_usec() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* Write everything journaled so far in one transaction, never under params_mux. A failed one keeps the entries */
+
+static void journal_flush() {
+    pthread_mutex_lock(&db_mux);
+    pthread_mutex_lock(&journal_mux);
+
+    journal_entry_t *out = journal;
+    uint32_t        n = journal_len;
+
+    if (n > 0 && db != NULL) {
+        journal = NULL;
+        journal_len = 0;
+        journal_size = 0;
     }
-    
-    while (sqlite3_step(stmt) != SQLITE_DONE) {
-        const char      *name = sqlite3_column_text(stmt, 0);
-        const int32_t   i = sqlite3_column_int(stmt, 1);
-        const int64_t   l = sqlite3_column_int64(stmt, 1);
-        const char      *t = sqlite3_column_text(stmt, 1);
-
-        if (strcmp(name, "band") == 0) {
-            params.band = i;
-            params_band_load();
-        } else if (strcmp(name, "vol") == 0) {
-            params.vol = i;
-        } else if (strcmp(name, "rfg") == 0) {
-            params.rfg = i;
-        } else if (strcmp(name, "sql") == 0) {
-            params.sql = i;
-        } else if (strcmp(name, "atu") == 0) {
-            params.atu = i;
-        } else if (strcmp(name, "pwr") == 0) {
-            params.pwr = i * 0.1f;
-        } else if (strcmp(name, "spectrum_beta") == 0) {
-            params.spectrum_beta = i;
-        } else if (strcmp(name, "spectrum_filled") == 0) {
-            params.spectrum_filled = i;
-        } else if (strcmp(name, "spectrum_peak") == 0) {
-            params.spectrum_peak = i;
-        } else if (strcmp(name, "spectrum_peak_hold") == 0) {
-            params.spectrum_peak_hold = i;
-        } else if (strcmp(name, "spectrum_peak_speed") == 0) {
-            params.spectrum_peak_speed = i * 0.1f;
-        } else if (strcmp(name, "key_speed") == 0) {
-            params.key_speed = i;
-        } else if (strcmp(name, "key_mode") == 0) {
-            params.key_mode = i;
-        } else if (strcmp(name, "iambic_mode") == 0) {
-            params.iambic_mode = i;
-        } else if (strcmp(name, "key_tone") == 0) {
-            params.key_tone = i;
-        } else if (strcmp(name, "key_vol") == 0) {
-            params.key_vol = i;
-        } else if (strcmp(name, "key_train") == 0) {
-            params.key_train = i;
-        } else if (strcmp(name, "qsk_time") == 0) {
-            params.qsk_time = i;
-        } else if (strcmp(name, "key_ratio") == 0) {
-            params.key_ratio = i;
-        } else if (strcmp(name, "mic") == 0) {
-            params.mic = i;
-        } else if (strcmp(name, "hmic") == 0) {
-            params.hmic = i;
-        } else if (strcmp(name, "imic") == 0) {
-            params.imic = i;
-        } else if (strcmp(name, "charger") == 0) {
-            params.charger = i;
-        } else if (strcmp(name, "dnf") == 0) {
-            params.dnf = i;
-        } else if (strcmp(name, "dnf_center") == 0) {
-            params.dnf_center = i;
-        } else if (strcmp(name, "dnf_width") == 0) {
-            params.dnf_width = i;
-        } else if (strcmp(name, "nb") == 0) {
-            params.nb = i;
-        } else if (strcmp(name, "nb_level") == 0) {
-            params.nb_level = i;
-        } else if (strcmp(name, "nb_width") == 0) {
-            params.nb_width = i;
-        } else if (strcmp(name, "nr") == 0) {
-            params.nr = i;
-        } else if (strcmp(name, "nr_level") == 0) {
-            params.nr_level = i;
-        } else if (strcmp(name, "agc_hang") == 0) {
-            params.agc_hang = i;
-        } else if (strcmp(name, "agc_knee") == 0) {
-            params.agc_knee = i;
-        } else if (strcmp(name, "agc_slope") == 0) {
-            params.agc_slope = i;
-        } else if (strcmp(name, "cw_decoder") == 0) {
-            params.cw_decoder = i;
-        } else if (strcmp(name, "cw_decoder_snr") == 0) {
-            params.cw_decoder_snr = i * 0.1f;
-        } else if (strcmp(name, "cw_decoder_peak_beta") == 0) {
-            params.cw_decoder_peak_beta = i * 0.01f;
-        } else if (strcmp(name, "cw_decoder_noise_beta") == 0) {
-            params.cw_decoder_noise_beta = i * 0.01f;
-        } else if (strcmp(name, "cw_encoder_period") == 0) {
-            params.cw_encoder_period = i;
-        } else if (strcmp(name, "voice_msg_period") == 0) {
-            params.voice_msg_period = i;
-        } else if (strcmp(name, "vol_modes") == 0) {
-            params.vol_modes = l;
-        } else if (strcmp(name, "mfk_modes") == 0) {
-            params.mfk_modes = l;
-        } else if (strcmp(name, "rtty_rate") == 0) {
-            params.rtty_rate = i;
-        } else if (strcmp(name, "rtty_shift") == 0) {
-            params.rtty_shift = i;
-        } else if (strcmp(name, "rtty_center") == 0) {
-            params.rtty_center = i;
-        } else if (strcmp(name, "rtty_reverse") == 0) {
-            params.rtty_reverse = i;
-        } else if (strcmp(name, "ant") == 0) {
-            params.ant = i;
-        } else if (strcmp(name, "rit") == 0) {
-            params.rit = i;
-        } else if (strcmp(name, "xit") == 0) {
-            params.xit = i;
-        } else if (strcmp(name, "brightness_normal") == 0) {
-            params.brightness_normal = i;
-        } else if (strcmp(name, "brightness_idle") == 0) {
-            params.brightness_idle = i;
-        } else if (strcmp(name, "brightness_timeout") == 0) {
-            params.brightness_timeout = i;
-        } else if (strcmp(name, "brightness_buttons") == 0) {
-            params.brightness_buttons = i;
-        } else if (strcmp(name, "line_in") == 0) {
-            params.line_in = i;
-        } else if (strcmp(name, "line_out") == 0) {
-            params.line_out = i;
-        } else if (strcmp(name, "moni") == 0) {
-            params.moni = i;
-        } else if (strcmp(name, "clock_view") == 0) {
-            params.clock_view = i;
-        } else if (strcmp(name, "clock_time_timeout") == 0) {
-            params.clock_time_timeout = i;
-        } else if (strcmp(name, "clock_power_timeout") == 0) {
-            params.clock_power_timeout = i;
-        } else if (strcmp(name, "clock_tx_timeout") == 0) {
-            params.clock_tx_timeout = i;
-        } else if (strcmp(name, "swrscan_linear") == 0) {
-            params.swrscan_linear = i;
-        } else if (strcmp(name, "swrscan_span") == 0) {
-            params.swrscan_span = i;
-        } else if (strcmp(name, "ft8_show_all") == 0) {
-            params.ft8_show_all = i;
-        } else if (strcmp(name, "ft8_band") == 0) {
-            params.ft8_band = i;
-        } else if (strcmp(name, "ft8_protocol") == 0) {
-            params.ft8_protocol = i;
-        } else if (strcmp(name, "long_gen") == 0) {
-            params.long_gen = i;
-        } else if (strcmp(name, "long_app") == 0) {
-            params.long_app = i;
-        } else if (strcmp(name, "long_key") == 0) {
-            params.long_key = i;
-        } else if (strcmp(name, "long_msg") == 0) {
-            params.long_msg = i;
-        } else if (strcmp(name, "long_dfn") == 0) {
-            params.long_dfn = i;
-        } else if (strcmp(name, "long_dfl") == 0) {
-            params.long_dfl = i;
-        } else if (strcmp(name, "press_f1") == 0) {
-            params.press_f1 = i;
-        } else if (strcmp(name, "press_f2") == 0) {
-            params.press_f2 = i;
-        } else if (strcmp(name, "long_f1") == 0) {
-            params.long_f1 = i;
-        } else if (strcmp(name, "long_f2") == 0) {
-            params.long_f2 = i;
-        } else if (strcmp(name, "play_gain") == 0) {
-            params.play_gain = i;
-        } else if (strcmp(name, "rec_gain") == 0) {
-            params.rec_gain = i;
-        } 
-        
-        if (params_load_bool(&params.mag_freq, name, i)) continue;
-        if (params_load_bool(&params.mag_info, name, i)) continue;
-        if (params_load_bool(&params.mag_alc, name, i)) continue;
-        if (params_load_bool(&params.spectrum_auto_min, name, i)) continue;
-        if (params_load_bool(&params.spectrum_auto_max, name, i)) continue;
-        if (params_load_bool(&params.waterfall_auto_min, name, i)) continue;
-        if (params_load_bool(&params.waterfall_auto_max, name, i)) continue;
-        if (params_load_bool(&params.spmode, name, i)) continue;
-        if (params_load_bool(&params.ft8_auto, name, i)) continue;
-
-        if (params_load_uint8(&params.voice_mode, name, i)) continue;
-        if (params_load_uint8(&params.voice_lang, name, i)) continue;
-        if (params_load_uint8(&params.voice_rate, name, i)) continue;
-        if (params_load_uint8(&params.voice_pitch, name, i)) continue;
-        if (params_load_uint8(&params.voice_volume, name, i)) continue;
-        if (params_load_uint8(&params.freq_accel, name, i)) continue;
-
-        if (params_load_uint16(&params.ft8_tx_freq, name, i)) continue;
-
-        if (params_load_str(&params.qth, name, t)) { 
-            qth_update(t);
-            continue;
+
+    pthread_mutex_unlock(&journal_mux);
+
+    if (n == 0 || db == NULL) {
+        pthread_mutex_unlock(&db_mux);
+        return;
+    }
+
+    uint64_t    start = get_usec();
+    bool        begin = params_exec("BEGIN");
+    bool        ok = begin;
+
+    for (uint32_t i = 0; ok && i < n; i++)
+        ok = journal_write(&out[i]);
+
+    if (ok) {
+        ok = params_exec("COMMIT");
+    }
+
+    if (!ok) {
+        LV_LOG_ERROR("Journal flush failed: %s, %u rows kept", sqlite3_errmsg(db), n);
+
+        if (begin && !sqlite3_get_autocommit(db)) {
+            params_exec("ROLLBACK");
         }
 
-        if (params_load_str(&params.callsign, name, t)) continue;
+        journal_restore(out, n);
     }
-    
-    sqlite3_finalize(stmt);
-    return true;
-}
 
-static bool params_exec(const char *sql) {
-    char    *err = 0;
-    int     rc;
-    
-    rc = sqlite3_exec(db, sql, NULL, NULL, &err);
-    
-    if (rc != SQLITE_OK) {
-        LV_LOG_ERROR(err);
-        return false;
+    free(out);
+
+    uint32_t us = get_usec() - start;
+
+    journal_stats.flushes++;
+    journal_stats.last_us = us;
+
+    if (ok) {
+        journal_stats.rows += n;
     }
-    
-    return true;
+
+    if (us > journal_stats.max_us) {
+        journal_stats.max_us = us;
+    }
+
+    if (us > JOURNAL_SLOW_US) {
+        LV_LOG_INFO("Slow journal flush: %u rows in %u us", n, us);
+    }
+
+    pthread_mutex_unlock(&db_mux);
 }
 
-static void params_write_int(const char *name, int data, bool *durty) {
-    sqlite3_bind_text(write_stmt, 1, name, strlen(name), 0);
-    sqlite3_bind_int(write_stmt, 2, data);
-    sqlite3_step(write_stmt);
-    sqlite3_reset(write_stmt);
-    sqlite3_clear_bindings(write_stmt);
-    
-    *durty = false;
+void params_journal_stats(params_journal_stats_t *stats) {
+    pthread_mutex_lock(&db_mux);
+    *stats = journal_stats;
+    pthread_mutex_unlock(&db_mux);
 }
 
-static void params_write_int64(const char *name, uint64_t data, bool *durty) {
-    sqlite3_bind_text(write_stmt, 1, name, strlen(name), 0);
-    sqlite3_bind_int64(write_stmt, 2, data);
-    sqlite3_step(write_stmt);
-    sqlite3_reset(write_stmt);
-    sqlite3_clear_bindings(write_stmt);
-    
-    *durty = false;
+/* Journal every durty field of base and keep the cache in step */
+
+static void schema_save(journal_table_t table, int32_t id, void *base, const param_schema_t *schema, size_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+        const param_schema_t    *p = &schema[i];
+        bool                    *durty = (bool *) ((uint8_t *) base + p->durty);
+
+        if (!*durty) {
+            continue;
+        }
+
+        const char  *text = (p->type == PARAM_TEXT) ? (const char *) base + p->offset : NULL;
+        int64_t     val = param_get(base, p);
+
+        journal_add(table, id, p->name, val, text);
+
+        if (table == JOURNAL_BAND || table == JOURNAL_MEMORY || table == JOURNAL_MODE) {
+            cache_put(table, id, i, val, text);
+        }
+
+        *durty = false;
+    }
 }
 
-static void params_write_text(const char *name, const char *data, bool *durty) {
-    sqlite3_bind_text(write_stmt, 1, name, strlen(name), 0);
-    sqlite3_bind_text(write_stmt, 2, data, strlen(data), 0);
-    sqlite3_step(write_stmt);
-    sqlite3_reset(write_stmt);
-    sqlite3_clear_bindings(write_stmt);
-    
-    *durty = false;
+/* Mode params */
+
+void params_mode_load() {
+    cache_apply(JOURNAL_MODE, radio_current_mode(), &params_mode, mode_schema, SCHEMA_SIZE(mode_schema));
 }
 
-static void params_save_bool(params_bool_t *var) {
-    if (var->durty) {
-        params_write_int(var->name, var->x, &var->durty);
-    }
+void params_mode_save() {
+    schema_save(JOURNAL_MODE, radio_current_mode(), &params_mode, mode_schema, SCHEMA_SIZE(mode_schema));
 }
 
-static void params_save_uint8(params_uint8_t *var) {
-    if (var->durty) {
-        params_write_int(var->name, var->x, &var->durty);
-    }
+/* Memory/Bands params */
+
+void params_memory_load(uint16_t id) {
+    params_mb_load(JOURNAL_MEMORY, id);
 }
 
-static void params_save_uint16(params_uint16_t *var) {
-    if (var->durty) {
-        params_write_int(var->name, var->x, &var->durty);
+void params_band_load() {
+    if (params.band < 0) {
+        return;
     }
+
+    params_mb_load(JOURNAL_BAND, params.band);
 }
 
-static void params_save_str(params_str_t *var) {
-    if (var->durty) {
-        params_write_text(var->name, var->x, &var->durty);
-    }
+static void params_mb_load(journal_table_t table, int32_t id) {
+    memset(params_band.label, 0, sizeof(params_band.label));
+    cache_apply(table, id, &params_band, band_schema, SCHEMA_SIZE(band_schema));
+    params_mode_load();
 }
 
-static void params_save() {
-    if (!params_exec("BEGIN")) {
+void params_band_save() {
+    if (params.band < 0) {
         return;
     }
 
-    if (params.durty.band)                  params_write_int("band", params.band, &params.durty.band);
-    if (params.durty.vol)                   params_write_int("vol", params.vol, &params.durty.vol);
-    if (params.durty.rfg)                   params_write_int("rfg", params.rfg, &params.durty.rfg);
-    if (params.durty.sql)                   params_write_int("sql", params.sql, &params.durty.sql);
-    if (params.durty.atu)                   params_write_int("atu", params.atu, &params.durty.atu);
-    if (params.durty.pwr)                   params_write_int("pwr", params.pwr * 10, &params.durty.pwr);
-
-    if (params.durty.spectrum_beta)         params_write_int("spectrum_beta", params.spectrum_beta, &params.durty.spectrum_beta);
-    if (params.durty.spectrum_filled)       params_write_int("spectrum_filled", params.spectrum_filled, &params.durty.spectrum_filled);
-    if (params.durty.spectrum_peak)         params_write_int("spectrum_peak", params.spectrum_peak, &params.durty.spectrum_peak);
-    if (params.durty.spectrum_peak_hold)    params_write_int("spectrum_peak_hold", params.spectrum_peak_hold, &params.durty.spectrum_peak_hold);
-    if (params.durty.spectrum_peak_speed)   params_write_int("spectrum_peak_speed", params.spectrum_peak_speed * 10, &params.durty.spectrum_peak_speed);
-
-    if (params.durty.key_speed)             params_write_int("key_speed", params.key_speed, &params.durty.key_speed);
-    if (params.durty.key_mode)              params_write_int("key_mode", params.key_mode, &params.durty.key_mode);
-    if (params.durty.iambic_mode)           params_write_int("iambic_mode", params.iambic_mode, &params.durty.iambic_mode);
-    if (params.durty.key_tone)              params_write_int("key_tone", params.key_tone, &params.durty.key_tone);
-    if (params.durty.key_vol)               params_write_int("key_vol", params.key_vol, &params.durty.key_vol);
-    if (params.durty.key_train)             params_write_int("key_train", params.key_train, &params.durty.key_train);
-    if (params.durty.qsk_time)              params_write_int("qsk_time", params.qsk_time, &params.durty.qsk_time);
-    if (params.durty.key_ratio)             params_write_int("key_ratio", params.key_ratio, &params.durty.key_ratio);
-
-    if (params.durty.mic)                   params_write_int("mic", params.mic, &params.durty.mic);
-    if (params.durty.hmic)                  params_write_int("hmic", params.hmic, &params.durty.hmic);
-    if (params.durty.imic)                  params_write_int("imic", params.imic, &params.durty.imic);
-
-    if (params.durty.charger)               params_write_int("charger", params.charger, &params.durty.charger);
-
-    if (params.durty.dnf)                   params_write_int("dnf", params.dnf, &params.durty.dnf);
-    if (params.durty.dnf_center)            params_write_int("dnf_center", params.dnf_center, &params.durty.dnf_center);
-    if (params.durty.dnf_width)             params_write_int("dnf_width", params.dnf_width, &params.durty.dnf_width);
-    if (params.durty.nb)                    params_write_int("nb", params.nb, &params.durty.nb);
-    if (params.durty.nb_level)              params_write_int("nb_level", params.nb_level, &params.durty.nb_level);
-    if (params.durty.nb_width)              params_write_int("nb_width", params.nb_width, &params.durty.nb_width);
-    if (params.durty.nr)                    params_write_int("nr", params.nr, &params.durty.nr);
-    if (params.durty.nr_level)              params_write_int("nr_level", params.nr_level, &params.durty.nr_level);
-
-    if (params.durty.agc_hang)              params_write_int("agc_hang", params.agc_hang, &params.durty.agc_hang);
-    if (params.durty.agc_knee)              params_write_int("agc_knee", params.agc_knee, &params.durty.agc_knee);
-    if (params.durty.agc_slope)             params_write_int("agc_slope", params.agc_slope, &params.durty.agc_slope);
-
-    if (params.durty.cw_decoder)            params_write_int("cw_decoder", params.cw_decoder, &params.durty.cw_decoder);
-    if (params.durty.cw_decoder_snr)        params_write_int("cw_decoder_snr", params.cw_decoder_snr * 10, &params.durty.cw_decoder_snr);
-    if (params.durty.cw_decoder_peak_beta)  params_write_int("cw_decoder_peak_beta", params.cw_decoder_peak_beta * 100, &params.durty.cw_decoder_peak_beta);
-    if (params.durty.cw_decoder_noise_beta) params_write_int("cw_decoder_noise_beta", params.cw_decoder_noise_beta * 100, &params.durty.cw_decoder_noise_beta);
-
-    if (params.durty.cw_encoder_period)     params_write_int("cw_encoder_period", params.cw_encoder_period, &params.durty.cw_encoder_period);
-    if (params.durty.voice_msg_period)      params_write_int("voice_msg_period", params.voice_msg_period, &params.durty.voice_msg_period);
-
-    if (params.durty.vol_modes)             params_write_int64("vol_modes", params.vol_modes, &params.durty.vol_modes);
-    if (params.durty.mfk_modes)             params_write_int64("mfk_modes", params.mfk_modes, &params.durty.mfk_modes);
-
-    if (params.durty.rtty_rate)             params_write_int("rtty_rate", params.rtty_rate, &params.durty.rtty_rate);
-    if (params.durty.rtty_shift)            params_write_int("rtty_shift", params.rtty_shift, &params.durty.rtty_shift);
-    if (params.durty.rtty_center)           params_write_int("rtty_center", params.rtty_center, &params.durty.rtty_center);
-    if (params.durty.rtty_reverse)          params_write_int("rtty_reverse", params.rtty_reverse, &params.durty.rtty_reverse);
-
-    if (params.durty.ant)                   params_write_int("ant", params.ant, &params.durty.ant);
-    if (params.durty.rit)                   params_write_int("rit", params.rit, &params.durty.rit);
-    if (params.durty.xit)                   params_write_int("xit", params.xit, &params.durty.xit);
-
-    if (params.durty.line_in)               params_write_int("line_in", params.line_in, &params.durty.line_in);
-    if (params.durty.line_out)              params_write_int("line_out", params.line_out, &params.durty.line_out);
-
-    if (params.durty.moni)                  params_write_int("moni", params.moni, &params.durty.moni);
-
-    if (params.durty.brightness_normal)     params_write_int("brightness_normal", params.brightness_normal, &params.durty.brightness_normal);
-    if (params.durty.brightness_idle)       params_write_int("brightness_idle", params.brightness_idle, &params.durty.brightness_idle);
-    if (params.durty.brightness_timeout)    params_write_int("brightness_timeout", params.brightness_timeout, &params.durty.brightness_timeout);
-    if (params.durty.brightness_buttons)    params_write_int("brightness_buttons", params.brightness_buttons, &params.durty.brightness_buttons);
-
-    if (params.durty.clock_view)            params_write_int("clock_view", params.clock_view, &params.durty.clock_view);
-    if (params.durty.clock_time_timeout)    params_write_int("clock_time_timeout", params.clock_time_timeout, &params.durty.clock_time_timeout);
-    if (params.durty.clock_power_timeout)   params_write_int("clock_power_timeout", params.clock_power_timeout, &params.durty.clock_power_timeout);
-    if (params.durty.clock_tx_timeout)      params_write_int("clock_tx_timeout", params.clock_tx_timeout, &params.durty.clock_tx_timeout);
-
-    if (params.durty.swrscan_linear)        params_write_int("swrscan_linear", params.swrscan_linear, &params.durty.swrscan_linear);
-    if (params.durty.swrscan_span)          params_write_int("swrscan_span", params.swrscan_span, &params.durty.swrscan_span);
-
-    if (params.durty.ft8_show_all)          params_write_int("ft8_show_all", params.ft8_show_all, &params.durty.ft8_show_all);
-    if (params.durty.ft8_band)              params_write_int("ft8_band", params.ft8_band, &params.durty.ft8_band);
-    if (params.durty.ft8_protocol)          params_write_int("ft8_protocol", params.ft8_protocol, &params.durty.ft8_protocol);
-
-    if (params.durty.long_gen)              params_write_int("long_gen", params.long_gen, &params.durty.long_gen);
-    if (params.durty.long_app)              params_write_int("long_app", params.long_app, &params.durty.long_app);
-    if (params.durty.long_key)              params_write_int("long_key", params.long_key, &params.durty.long_key);
-    if (params.durty.long_msg)              params_write_int("long_msg", params.long_msg, &params.durty.long_msg);
-    if (params.durty.long_dfn)              params_write_int("long_dfn", params.long_dfn, &params.durty.long_dfn);
-    if (params.durty.long_dfl)              params_write_int("long_dfl", params.long_dfl, &params.durty.long_dfl);
-
-    if (params.durty.press_f1)              params_write_int("press_f1", params.press_f1, &params.durty.press_f1);
-    if (params.durty.press_f2)              params_write_int("press_f2", params.press_f2, &params.durty.press_f2);
-    if (params.durty.long_f1)               params_write_int("long_f1", params.long_f1, &params.durty.long_f1);
-    if (params.durty.long_f2)               params_write_int("long_f2", params.long_f2, &params.durty.long_f2);
-
-    if (params.durty.play_gain)             params_write_int("play_gain", params.play_gain, &params.durty.play_gain);
-    if (params.durty.rec_gain)              params_write_int("rec_gain", params.rec_gain, &params.durty.rec_gain);
-
-    params_save_uint8(&params.voice_mode);
-    params_save_uint8(&params.voice_lang);
-    params_save_uint8(&params.voice_rate);
-    params_save_uint8(&params.voice_pitch);
-    params_save_uint8(&params.voice_volume);
-    params_save_uint8(&params.freq_accel);
-
-    params_save_uint16(&params.ft8_tx_freq);
-
-    params_save_bool(&params.mag_freq);
-    params_save_bool(&params.mag_info);
-    params_save_bool(&params.mag_alc);
-    params_save_bool(&params.spectrum_auto_min);
-    params_save_bool(&params.spectrum_auto_max);
-    params_save_bool(&params.waterfall_auto_min);
-    params_save_bool(&params.waterfall_auto_max);
-    params_save_bool(&params.spmode);
-    params_save_bool(&params.ft8_auto);
-
-    params_save_str(&params.qth);
-    params_save_str(&params.callsign);
-
-    params_exec("COMMIT");
+    params_mb_save(JOURNAL_BAND, params.band);
 }
 
-/* Transverter */
+void params_memory_save(uint16_t id) {
+    params_band.durty.vfo = true;
 
-bool transverter_load() {
+    for (uint8_t i = X6100_VFO_A; i <= X6100_VFO_B; i++) {
+        params_band.vfo_x[i].durty.freq = true;
+        params_band.vfo_x[i].durty.att = true;
+        params_band.vfo_x[i].durty.pre = true;
+        params_band.vfo_x[i].durty.mode = true;
+        params_band.vfo_x[i].durty.agc = true;
+    }
+
+    params_band.durty.grid_min = true;
+    params_band.durty.grid_max = true;
+
+    params_mb_save(JOURNAL_MEMORY, id);
+}
+
+static void params_mb_save(journal_table_t table, uint16_t id) {
+    schema_save(table, id, &params_band, band_schema, SCHEMA_SIZE(band_schema));
+    params_mode_save();
+}
+
+/* System params */
+
+static bool params_load() {
     sqlite3_stmt    *stmt;
+    bool            band = false;
     int             rc;
-    
-    rc = sqlite3_prepare_v2(db, "SELECT * FROM transverter", -1, &stmt, 0);
-    
+
+    rc = sqlite3_prepare_v2(db, "SELECT name,val FROM params", -1, &stmt, 0);
+
     if (rc != SQLITE_OK) {
         return false;
     }
-    
-    while (sqlite3_step(stmt) != SQLITE_DONE) {
-        const int       id = sqlite3_column_int(stmt, 0);
-        const char      *name = sqlite3_column_text(stmt, 1);
-        const uint64_t  val = sqlite3_column_int64(stmt, 2);
-
-        if (strcmp(name, "from") == 0) {
-            params_transverter[id].from = val;
-        } else if (strcmp(name, "to") == 0) {
-            params_transverter[id].to = val;
-        } else if (strcmp(name, "shift") == 0) {
-            params_transverter[id].shift = val;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const param_schema_t *p = schema_find(params_schema, SCHEMA_SIZE(params_schema), (const char *) sqlite3_column_text(stmt, 0));
+
+        if (!p) {
+            continue;
+        }
+
+        param_set_column(&params, p, stmt, 1);
+
+        if (p->offset == offsetof(params_t, band)) {
+            band = true;
+        } else if (p->offset == offsetof(params_t, qth.x)) {
+            qth_update(params.qth.x);
         }
     }
 
     sqlite3_finalize(stmt);
+
+    if (band) {
+        params_band_load();
+    }
+
     return true;
 }
 
-static void transverter_write(sqlite3_stmt *stmt, uint8_t id, const char *name, uint64_t data, bool *durty) {
-    sqlite3_bind_int64(stmt, 1, id);
-    sqlite3_bind_text(stmt, 2, name, strlen(name), 0);
-    sqlite3_bind_int64(stmt, 3, data);
-    sqlite3_step(stmt);
-    sqlite3_reset(stmt);
-    sqlite3_clear_bindings(stmt);
-    
-    *durty = false;
+static bool params_exec(const char *sql) {
+    char    *err = 0;
+    int     rc;
+
+    rc = sqlite3_exec(db, sql, NULL, NULL, &err);
+
+    if (rc != SQLITE_OK) {
+        LV_LOG_ERROR(err);
+        return false;
+    }
+
+    return true;
 }
 
-void transverter_save() {
+static void params_save() {
+    schema_save(JOURNAL_PARAMS, 0, &params, params_schema, SCHEMA_SIZE(params_schema));
+}
+
+/* Transverter */
+
+bool transverter_load() {
     sqlite3_stmt    *stmt;
     int             rc;
 
-    rc = sqlite3_prepare_v2(db, "INSERT INTO transverter(id, name, val) VALUES(?, ?, ?)", -1, &stmt, 0);
+    rc = sqlite3_prepare_v2(db, "SELECT id,name,val FROM transverter", -1, &stmt, 0);
 
     if (rc != SQLITE_OK) {
-        return;
+        return false;
     }
 
-    if (!params_exec("BEGIN")) {
-        return;
-    }
-    
-    for (uint8_t i = 0; i < TRANSVERTER_NUM; i++) {
-        transverter_t *transverter = &params_transverter[i];
-        
-        if (transverter->durty.from)    transverter_write(stmt, i, "from", transverter->from, &transverter->durty.from);
-        if (transverter->durty.to)      transverter_write(stmt, i, "to", transverter->to, &transverter->durty.to);
-        if (transverter->durty.shift)   transverter_write(stmt, i, "shift", transverter->shift, &transverter->durty.shift);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const int               id = sqlite3_column_int(stmt, 0);
+        const param_schema_t    *p = schema_find(transverter_schema, SCHEMA_SIZE(transverter_schema), (const char *) sqlite3_column_text(stmt, 1));
+
+        if (p && id >= 0 && id < TRANSVERTER_NUM) {
+            param_set_column(&params_transverter[id], p, stmt, 2);
+        }
     }
 
-    params_exec("COMMIT");
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+void transverter_save() {
+    for (uint8_t i = 0; i < TRANSVERTER_NUM; i++)
+        schema_save(JOURNAL_TRANSVERTER, i, &params_transverter[i], transverter_schema, SCHEMA_SIZE(transverter_schema));
 }
 
 /* * */
@@ -971,7 +980,7 @@ static void * params_thread(void *arg) {
         if (durty_time) {
             uint64_t    now = get_time();
             int32_t     d = now - durty_time;
-    
+
             if (d > PARAMS_SAVE_TIMEOUT) {
                 durty_time = 0;
 
@@ -981,70 +990,70 @@ static void * params_thread(void *arg) {
                 transverter_save();
             }
         }
-        
+
         pthread_mutex_unlock(&params_mux);
+        journal_flush();
         usleep(100000);
     }
 }
 
-void params_init() {
-    int rc = sqlite3_open("/mnt/params.db", &db);
-    
-    if (rc == SQLITE_OK) {
-        if (!params_load()) {
-            LV_LOG_ERROR("Load params");
-            sqlite3_close(db);
-            db = NULL;
-        }
+static bool params_prepare(const char *sql, sqlite3_stmt **stmt) {
+    if (sqlite3_prepare_v2(db, sql, -1, stmt, 0) != SQLITE_OK) {
+        LV_LOG_ERROR("Prepare: %s", sql);
+        return false;
+    }
 
-        rc = sqlite3_prepare_v2(db, "INSERT INTO params(name, val) VALUES(?, ?)", -1, &write_stmt, 0);
+    return true;
+}
 
-        if (rc != SQLITE_OK) {
-            LV_LOG_ERROR("Prepare write");
-        }
+void params_init() {
+    uint64_t    start = get_usec();
+    int         rc = sqlite3_open("/mnt/params.db", &db);
 
-        rc = sqlite3_prepare_v2(db, "INSERT INTO mode_params(mode, name, val) VALUES(?, ?, ?)", -1, &write_mode_stmt, 0);
+    schema_sort(params_schema, SCHEMA_SIZE(params_schema));
+    schema_sort(band_schema, SCHEMA_SIZE(band_schema));
+    schema_sort(mode_schema, SCHEMA_SIZE(mode_schema));
+    schema_sort(transverter_schema, SCHEMA_SIZE(transverter_schema));
 
-        if (rc != SQLITE_OK) {
-            LV_LOG_ERROR("Prepare mode write");
-        }
+    if (rc == SQLITE_OK) {
+        params_exec("PRAGMA journal_mode=WAL");
+        params_exec("PRAGMA synchronous=NORMAL");
 
-        rc = sqlite3_prepare_v2(db, "INSERT INTO atu(ant, freq, val) VALUES(?, ?, ?)", -1, &save_atu_stmt, 0);
+        params_prepare("INSERT INTO params(name, val) VALUES(?, ?)", &journal_stmt[JOURNAL_PARAMS]);
+        params_prepare("INSERT INTO band_params(bands_id, name, val) VALUES(?, ?, ?)", &journal_stmt[JOURNAL_BAND]);
+        params_prepare("INSERT INTO memory(id, name, val) VALUES(?, ?, ?)", &journal_stmt[JOURNAL_MEMORY]);
+        params_prepare("INSERT INTO mode_params(mode, name, val) VALUES(?, ?, ?)", &journal_stmt[JOURNAL_MODE]);
+        params_prepare("INSERT INTO transverter(id, name, val) VALUES(?, ?, ?)", &journal_stmt[JOURNAL_TRANSVERTER]);
 
-        if (rc != SQLITE_OK) {
-            LV_LOG_ERROR("Prepare atu save");
-        }
+        params_prepare("INSERT INTO atu(ant, freq, val) VALUES(?, ?, ?)", &journal_stmt[JOURNAL_ATU]);
 
-        rc = sqlite3_prepare_v2(db, "SELECT val FROM atu WHERE ant = ? AND freq = ?", -1, &load_atu_stmt, 0);
+        params_prepare("SELECT id,val FROM msg_cw", &msg_cw_load_stmt);
+        params_prepare("INSERT INTO msg_cw (val) VALUES(?)", &msg_cw_new_stmt);
+        params_prepare("UPDATE msg_cw SET val = ? WHERE id = ?", &msg_cw_edit_stmt);
+        params_prepare("DELETE FROM msg_cw WHERE id = ?", &msg_cw_delete_stmt);
 
-        if (rc != SQLITE_OK) {
-            LV_LOG_ERROR("Prepare atu load");
+        if (!params_bands_load()) {
+            LV_LOG_ERROR("Load bands");
         }
 
-        rc = sqlite3_prepare_v2(db, 
-            "SELECT id,name,start_freq,stop_freq,type FROM bands "
-                "WHERE (stop_freq BETWEEN ? AND ?) OR (start_freq BETWEEN ? AND ?) OR (start_freq <= ? AND stop_freq >= ?) "
-                "ORDER BY start_freq ASC", 
-                -1, &bands_find_all_stmt, 0
-        );
+        cache_preload(JOURNAL_BAND, "SELECT bands_id,name,val FROM band_params", band_schema, SCHEMA_SIZE(band_schema));
+        cache_preload(JOURNAL_MEMORY, "SELECT id,name,val FROM memory", band_schema, SCHEMA_SIZE(band_schema));
+        cache_preload(JOURNAL_MODE, "SELECT mode,name,val FROM mode_params", mode_schema, SCHEMA_SIZE(mode_schema));
+        atu_preload();
 
-        if (rc != SQLITE_OK) {
-            LV_LOG_ERROR("Prepare bands all find");
+        if (!params_load()) {
+            LV_LOG_ERROR("Load params");
         }
 
-        rc = sqlite3_prepare_v2(db,  "SELECT id,name,start_freq,stop_freq,type FROM bands WHERE (? BETWEEN start_freq AND stop_freq)", -1, &bands_find_stmt, 0);
-
-        if (rc != SQLITE_OK) {
-            LV_LOG_ERROR("Prepare bands find");
-        }
-        
         if (!transverter_load()) {
             LV_LOG_ERROR("Load transverter");
         }
+
+        LV_LOG_INFO("Params loaded in %u us", (uint32_t) (get_usec() - start));
     } else {
         LV_LOG_ERROR("Open params.db");
     }
-    
+
     pthread_mutex_init(&params_mux, NULL);
 
     durty_time = 0;
@@ -1076,45 +1085,49 @@ void params_band_freq_set(uint64_t freq) {
 }
 
 void params_atu_save(uint32_t val) {
-    uint64_t freq = params_band.vfo_x[params_band.vfo].freq;
-
-    params_lock();
+    uint32_t key = atu_key(params.ant, params_band.vfo_x[params_band.vfo].freq);
 
-    sqlite3_bind_int(save_atu_stmt, 1, params.ant);
-    sqlite3_bind_int(save_atu_stmt, 2, freq / 50000);
-    sqlite3_bind_int(save_atu_stmt, 3, val);
-    
-    sqlite3_step(save_atu_stmt);
-    sqlite3_reset(save_atu_stmt);
-    sqlite3_clear_bindings(save_atu_stmt);
-    
-    params_unlock(NULL);
+    atu_put(key, val);
+    journal_add(JOURNAL_ATU, key, NULL, val, NULL);
 }
 
-uint32_t params_atu_load(bool *loaded) {
+uint32_t params_atu_find(uint8_t ant, uint64_t freq, bool *loaded) {
+    uint32_t    key = atu_key(ant, freq);
     uint32_t    res = 0;
-    uint64_t    freq = params_band.vfo_x[params_band.vfo].freq;
-    
+
     *loaded = false;
 
-    params_lock();
+    pthread_mutex_lock(&atu_mux);
 
-    sqlite3_bind_int(load_atu_stmt, 1, params.ant);
-    sqlite3_bind_int(load_atu_stmt, 2, freq / 50000);
+    uint32_t i = atu_lower(key);
 
-    if (sqlite3_step(load_atu_stmt) != SQLITE_DONE) {
-        res = sqlite3_column_int64(load_atu_stmt, 0);
+    if (i < atu_count && atu[i].key == key) {
+        res = atu[i].val;
         *loaded = true;
+    } else {
+        /* Neighbours of the same antenna, the closest one wins */
+
+        uint32_t best = ATU_NEAREST + 1;
+
+        if (i < atu_count && (atu[i].key >> 24) == ant && atu[i].key - key < best) {
+            best = atu[i].key - key;
+            res = atu[i].val;
+        }
+
+        if (i > 0 && (atu[i - 1].key >> 24) == ant && key - atu[i - 1].key < best) {
+            res = atu[i - 1].val;
+        }
     }
 
-    sqlite3_reset(load_atu_stmt);
-    sqlite3_clear_bindings(load_atu_stmt);
+    pthread_mutex_unlock(&atu_mux);
 
-    params_unlock(NULL);
-    
     return res;
 }
 
+uint32_t params_atu_load(bool *loaded) {
+    return params_atu_find(params.ant, params_band.vfo_x[params_band.vfo].freq, loaded);
+}
+
 void params_band_vfo_clone() {
     params_vfo_t *a = &params_band.vfo_x[X6100_VFO_A];
     params_vfo_t *b = &params_band.vfo_x[X6100_VFO_B];
@@ -1139,163 +1152,285 @@ void params_band_vfo_clone() {
 }
 
 void params_msg_cw_load() {
-    sqlite3_stmt    *stmt;
-    int             rc;
-    
-    rc = sqlite3_prepare_v2(db, "SELECT id,val FROM msg_cw", -1, &stmt, 0);
-    
-    if (rc != SQLITE_OK) {
-        return;
-    }
-    
-    while (sqlite3_step(stmt) != SQLITE_DONE) {
-        int         id = sqlite3_column_int(stmt, 0);
-        const char  *val = sqlite3_column_text(stmt, 1);
+    pthread_mutex_lock(&db_mux);
+
+    while (sqlite3_step(msg_cw_load_stmt) == SQLITE_ROW) {
+        int         id = sqlite3_column_int(msg_cw_load_stmt, 0);
+        const char  *val = sqlite3_column_text(msg_cw_load_stmt, 1);
         
         dialog_msg_cw_append(id, val);
     }
     
-    sqlite3_finalize(stmt);
+    sqlite3_reset(msg_cw_load_stmt);
+    pthread_mutex_unlock(&db_mux);
 }
 
 void params_msg_cw_new(const char *val) {
-    sqlite3_stmt    *stmt;
-    int             rc;
-    
-    rc = sqlite3_prepare_v2(db, "INSERT INTO msg_cw (val) VALUES(?)", -1, &stmt, 0);
-    
-    if (rc != SQLITE_OK) {
-        return;
-    }
+    pthread_mutex_lock(&db_mux);
 
-    sqlite3_bind_text(stmt, 1, val, strlen(val), 0);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_bind_text(msg_cw_new_stmt, 1, val, strlen(val), 0);
+    sqlite3_step(msg_cw_new_stmt);
+    sqlite3_reset(msg_cw_new_stmt);
+    sqlite3_clear_bindings(msg_cw_new_stmt);
+
+    int64_t id = sqlite3_last_insert_rowid(db);
 
-    dialog_msg_cw_append(sqlite3_last_insert_rowid(db), val);
+    pthread_mutex_unlock(&db_mux);
+
+    dialog_msg_cw_append(id, val);
 }
 
 void params_msg_cw_edit(uint32_t id, const char *val) {
-    sqlite3_stmt    *stmt;
-    int             rc;
-    
-    rc = sqlite3_prepare_v2(db, "UPDATE msg_cw SET val = ? WHERE id = ?", -1, &stmt, 0);
-    
-    if (rc != SQLITE_OK) {
-        return;
-    }
+    pthread_mutex_lock(&db_mux);
 
-    sqlite3_bind_text(stmt, 1, val, strlen(val), 0);
-    sqlite3_bind_int(stmt, 2, id);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_bind_text(msg_cw_edit_stmt, 1, val, strlen(val), 0);
+    sqlite3_bind_int(msg_cw_edit_stmt, 2, id);
+    sqlite3_step(msg_cw_edit_stmt);
+    sqlite3_reset(msg_cw_edit_stmt);
+    sqlite3_clear_bindings(msg_cw_edit_stmt);
+
+    pthread_mutex_unlock(&db_mux);
 }
 
 void params_msg_cw_delete(uint32_t id) {
-    sqlite3_stmt    *stmt;
-    int             rc;
-    
-    rc = sqlite3_prepare_v2(db, "DELETE FROM msg_cw WHERE id = ?", -1, &stmt, 0);
-    
-    if (rc != SQLITE_OK) {
-        return;
-    }
+    pthread_mutex_lock(&db_mux);
 
-    sqlite3_bind_int(stmt, 1, id);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_bind_int(msg_cw_delete_stmt, 1, id);
+    sqlite3_step(msg_cw_delete_stmt);
+    sqlite3_reset(msg_cw_delete_stmt);
+    sqlite3_clear_bindings(msg_cw_delete_stmt);
+
+    pthread_mutex_unlock(&db_mux);
 }
 
-band_t * params_bands_find_all(uint64_t freq, int32_t half_width, uint16_t *count) {
-    uint64_t    left = freq - half_width;
-    uint64_t    right = freq + half_width;
-    band_t      *res = NULL;
-    uint16_t    n = 0;
+/* Bands index. The table is small and only changes with params.db, so it is searched in memory */
 
-    sqlite3_bind_int64(bands_find_all_stmt, 1, left);
-    sqlite3_bind_int64(bands_find_all_stmt, 2, right);
-    sqlite3_bind_int64(bands_find_all_stmt, 3, left);
-    sqlite3_bind_int64(bands_find_all_stmt, 4, right);
-    sqlite3_bind_int64(bands_find_all_stmt, 5, left);
-    sqlite3_bind_int64(bands_find_all_stmt, 6, right);
-    
-    while (sqlite3_step(bands_find_all_stmt) != SQLITE_DONE) {
-        n++;
-        res = realloc(res, sizeof(band_t) * n);
-        
-        band_t *current = &res[n - 1];
+typedef struct {
+    band_t          *bands;         /* Sorted by start_freq */
+    uint64_t        *max_stop;      /* Largest stop_freq of bands[0..i] */
+    uint16_t        count;
+
+    uint16_t        *by_start;      /* Bands with type != 0, sorted by start_freq */
+    uint16_t        *by_stop;       /* Same bands, sorted by stop_freq */
+    uint16_t        *prev;          /* Band with the largest start_freq among by_stop[0..i] */
+    uint16_t        active;
+} bands_index_t;
+
+static bands_index_t    bands_index;
 
-        current->id = sqlite3_column_int(bands_find_all_stmt, 0);
-        current->name = strdup(sqlite3_column_text(bands_find_all_stmt, 1));
-        current->start_freq = sqlite3_column_int64(bands_find_all_stmt, 2);
-        current->stop_freq = sqlite3_column_int64(bands_find_all_stmt, 3);
-        current->type = sqlite3_column_int(bands_find_all_stmt, 4);
+static int band_start_cmp(const void *a, const void *b) {
+    const band_t *x = a;
+    const band_t *y = b;
+
+    if (x->start_freq != y->start_freq) {
+        return x->start_freq < y->start_freq ? -1 : 1;
     }
 
-    sqlite3_reset(bands_find_all_stmt);
-    sqlite3_clear_bindings(bands_find_all_stmt);
-    
-    *count = n;
-    return res;
+    return x->id - y->id;
 }
 
-bool params_bands_find(uint64_t freq, band_t *band) {
-    bool res = false;
+static int band_stop_cmp(const void *a, const void *b) {
+    const band_t *x = &bands_index.bands[*(const uint16_t *) a];
+    const band_t *y = &bands_index.bands[*(const uint16_t *) b];
 
-    sqlite3_bind_int64(bands_find_stmt, 1, freq);
-
-    if (sqlite3_step(bands_find_stmt) == SQLITE_ROW) {
-        if (band->name)
-            free(band->name);
-    
-        band->id = sqlite3_column_int(bands_find_stmt, 0);
-        band->name = strdup(sqlite3_column_text(bands_find_stmt, 1));
-        band->start_freq = sqlite3_column_int64(bands_find_stmt, 2);
-        band->stop_freq = sqlite3_column_int64(bands_find_stmt, 3);
-        band->type = sqlite3_column_int(bands_find_stmt, 4);
-        
-        res = true;
+    if (x->stop_freq != y->stop_freq) {
+        return x->stop_freq < y->stop_freq ? -1 : 1;
     }
 
-    sqlite3_reset(bands_find_stmt);
-    sqlite3_clear_bindings(bands_find_stmt);
-    
-    return res;
+    return x->id - y->id;
 }
 
-bool params_bands_find_next(uint64_t freq, bool up, band_t *band) {
-    bool            res = false;
+static void bands_index_free() {
+    for (uint16_t i = 0; i < bands_index.count; i++)
+        free(bands_index.bands[i].name);
+
+    free(bands_index.bands);
+    free(bands_index.max_stop);
+    free(bands_index.by_start);
+    free(bands_index.by_stop);
+    free(bands_index.prev);
+
+    memset(&bands_index, 0, sizeof(bands_index));
+}
+
+bool params_bands_load() {
     sqlite3_stmt    *stmt;
-    int             rc;
-    
-    if (up) {
-        rc = sqlite3_prepare_v2(db, "SELECT id,name,start_freq,stop_freq,type FROM bands WHERE (? < start_freq AND type != 0) ORDER BY start_freq ASC", -1, &stmt, 0);
-    } else {
-        rc = sqlite3_prepare_v2(db, "SELECT id,name,start_freq,stop_freq,type FROM bands WHERE (? > stop_freq AND type != 0) ORDER BY start_freq DESC", -1, &stmt, 0);
-    }
-    
-    if (rc != SQLITE_OK) {
+    band_t          *bands = NULL;
+    uint16_t        n = 0;
+
+    if (sqlite3_prepare_v2(db, "SELECT id,name,start_freq,stop_freq,type FROM bands", -1, &stmt, 0) != SQLITE_OK) {
         return false;
     }
 
-    sqlite3_bind_int64(stmt, 1, freq);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        band_t *next = realloc(bands, (n + 1) * sizeof(band_t));
+
+        if (!next) {
+            break;
+        }
+
+        bands = next;
+
+        band_t *band = &bands[n++];
 
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        if (band->name)
-            free(band->name);
-    
         band->id = sqlite3_column_int(stmt, 0);
-        band->name = strdup(sqlite3_column_text(stmt, 1));
+        band->name = strdup((const char *) sqlite3_column_text(stmt, 1));
         band->start_freq = sqlite3_column_int64(stmt, 2);
         band->stop_freq = sqlite3_column_int64(stmt, 3);
         band->type = sqlite3_column_int(stmt, 4);
-
-        res = true;
     }
 
     sqlite3_finalize(stmt);
+    bands_index_free();
 
-    return res;
+    if (n == 0) {
+        return true;
+    }
+
+    qsort(bands, n, sizeof(band_t), band_start_cmp);
+
+    bands_index.bands = bands;
+    bands_index.count = n;
+    bands_index.max_stop = malloc(n * sizeof(uint64_t));
+    bands_index.by_start = malloc(n * sizeof(uint16_t));
+    bands_index.by_stop = malloc(n * sizeof(uint16_t));
+    bands_index.prev = malloc(n * sizeof(uint16_t));
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint64_t prev = i ? bands_index.max_stop[i - 1] : 0;
+
+        bands_index.max_stop[i] = bands[i].stop_freq > prev ? bands[i].stop_freq : prev;
+
+        if (bands[i].type != 0) {
+            bands_index.by_start[bands_index.active] = i;
+            bands_index.by_stop[bands_index.active] = i;
+            bands_index.active++;
+        }
+    }
+
+    qsort(bands_index.by_stop, bands_index.active, sizeof(uint16_t), band_stop_cmp);
+
+    for (uint16_t i = 0; i < bands_index.active; i++) {
+        uint16_t x = bands_index.by_stop[i];
+
+        if (i > 0 && bands[bands_index.prev[i - 1]].start_freq > bands[x].start_freq) {
+            x = bands_index.prev[i - 1];
+        }
+
+        bands_index.prev[i] = x;
+    }
+
+    return true;
+}
+
+/* Range of bands[] that can contain [left, right]: max_stop >= left and start_freq <= right */
+
+static void bands_range(int64_t left, int64_t right, uint16_t *from, uint16_t *to) {
+    uint16_t lo = 0;
+    uint16_t hi = bands_index.count;
+
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+
+        if ((int64_t) bands_index.max_stop[mid] < left) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *from = lo;
+    hi = bands_index.count;
+
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) / 2;
+
+        if ((int64_t) bands_index.bands[mid].start_freq <= right) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *to = lo;
+}
+
+uint16_t params_bands_find_all(uint64_t freq, int32_t half_width, const band_t **list, uint16_t max) {
+    int64_t     left = (int64_t) freq - half_width;
+    int64_t     right = (int64_t) freq + half_width;
+    uint16_t    from, to;
+    uint16_t    n = 0;
+
+    bands_range(left, right, &from, &to);
+
+    for (uint16_t i = from; i < to && n < max; i++)
+        if ((int64_t) bands_index.bands[i].stop_freq >= left) {
+            list[n++] = &bands_index.bands[i];
+        }
+
+    return n;
+}
+
+bool params_bands_find(uint64_t freq, band_t *band) {
+    const band_t    *res = NULL;
+    uint16_t        from, to;
+
+    bands_range(freq, freq, &from, &to);
+
+    for (uint16_t i = from; i < to; i++) {
+        const band_t *x = &bands_index.bands[i];
+
+        if (x->stop_freq >= freq && (!res || x->id < res->id)) {
+            res = x;
+        }
+    }
+
+    if (res) {
+        *band = *res;
+    }
+
+    return res != NULL;
+}
+
+bool params_bands_find_next(uint64_t freq, bool up, band_t *band) {
+    uint16_t    lo = 0;
+    uint16_t    hi = bands_index.active;
+
+    if (up) {
+        while (lo < hi) {
+            uint16_t mid = (lo + hi) / 2;
+
+            if (bands_index.bands[bands_index.by_start[mid]].start_freq <= freq) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if (lo == bands_index.active) {
+            return false;
+        }
+
+        *band = bands_index.bands[bands_index.by_start[lo]];
+    } else {
+        while (lo < hi) {
+            uint16_t mid = (lo + hi) / 2;
+
+            if (bands_index.bands[bands_index.by_stop[mid]].stop_freq < freq) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if (lo == 0) {
+            return false;
+        }
+
+        *band = bands_index.bands[bands_index.prev[lo - 1]];
+    }
+
+    return true;
 }
 
 void params_bool_set(params_bool_t *var, bool x) {
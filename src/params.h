@@ -106,6 +106,12 @@ typedef enum {
     FREQ_ACCEL_STRONG,
 } freq_accel_t;
 
+typedef enum {
+    REC_FORMAT_WAV = 0,
+    REC_FORMAT_FLAC,
+    REC_FORMAT_MP3,
+} rec_format_t;
+
 /* Params items */
 
 typedef struct {
@@ -243,6 +249,7 @@ typedef struct {
     bool                spectrum_filled;
     params_bool_t       spectrum_auto_min;
     params_bool_t       spectrum_auto_max;
+    params_bool_t       spectrum_aa;
     params_bool_t       waterfall_auto_min;
     params_bool_t       waterfall_auto_max;
     params_bool_t       mag_freq;
@@ -271,6 +278,7 @@ typedef struct {
     float               cw_decoder_snr_gist;
     float               cw_decoder_peak_beta;
     float               cw_decoder_noise_beta;
+    params_bool_t       cw_skimmer;
 
     /* Msg */
     
@@ -298,6 +306,7 @@ typedef struct {
     uint8_t             ft8_band;
     params_uint16_t     ft8_tx_freq;
     params_bool_t       ft8_auto;
+    params_uint16_t     ft8_budget;
 
     /* Long press actions */
     
@@ -319,6 +328,8 @@ typedef struct {
 
     uint16_t            play_gain;
     uint16_t            rec_gain;
+    params_uint8_t      rec_format;
+    params_uint8_t      iq_format;
     
     /* Voice */
 
@@ -447,6 +458,13 @@ typedef struct {
 
 #define TRANSVERTER_NUM 2
 
+typedef struct {
+    uint32_t        flushes;
+    uint32_t        rows;
+    uint32_t        last_us;
+    uint32_t        max_us;
+} params_journal_stats_t;
+
 extern params_t params;
 extern params_band_t params_band;
 extern params_mode_t params_mode;
@@ -456,6 +474,10 @@ void params_init();
 void params_lock();
 void params_unlock(bool *durty);
 
+/* Counters of the write-behind journal */
+
+void params_journal_stats(params_journal_stats_t *stats);
+
 void params_bool_set(params_bool_t *var, bool x);
 void params_uint8_set(params_uint8_t *var, uint8_t x);
 void params_uint16_set(params_uint16_t *var, uint16_t x);
@@ -474,9 +496,15 @@ void params_mode_load();
 
 void params_band_freq_set(uint64_t freq);
 
+/* ATU networks live in memory, saves go through the write-behind journal */
+
 void params_atu_save(uint32_t val);
 uint32_t params_atu_load(bool *loaded);
 
+/* Network for any antenna and frequency, the nearest neighbour when there is no exact one */
+
+uint32_t params_atu_find(uint8_t ant, uint64_t freq, bool *loaded);
+
 void params_band_vfo_clone();
 
 void params_msg_cw_load();
@@ -484,6 +512,9 @@ void params_msg_cw_new(const char *val);
 void params_msg_cw_edit(uint32_t id, const char *val);
 void params_msg_cw_delete(uint32_t id);
 
-band_t * params_bands_find_all(uint64_t freq, int32_t half_width, uint16_t *count);
+/* Bands are kept in memory, names belong to the index and stay valid until the next params_bands_load() */
+
+bool params_bands_load();
+uint16_t params_bands_find_all(uint64_t freq, int32_t half_width, const band_t **list, uint16_t max);
 bool params_bands_find(uint64_t freq, band_t *band);
 bool params_bands_find_next(uint64_t freq, bool up, band_t *band);
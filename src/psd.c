@@ -0,0 +1,321 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <string.h>
+#include <math.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "psd.h"
+
+void psd_init(psd_t *psd, uint16_t nfft, uint16_t hop) {
+    psd->nfft = nfft;
+    psd->hop = hop;
+    psd->acc_num = 0;
+
+    psd->window = (float *) malloc(nfft * sizeof(float));
+    psd->history = (float complex *) malloc(nfft * sizeof(float complex));
+    psd->fft_in = (float complex *) malloc(nfft * sizeof(float complex));
+    psd->fft_out = (float complex *) malloc(nfft * sizeof(float complex));
+    psd->fft = fft_create_plan(nfft, psd->fft_in, psd->fft_out, LIQUID_FFT_FORWARD, 0);
+
+    /* Same window scale as spgramcf, so levels stay calibrated */
+
+    float g = 0.0f;
+
+    for (uint16_t i = 0; i < nfft; i++) {
+        psd->window[i] = liquid_hann(i, nfft);
+        g += psd->window[i] * psd->window[i];
+    }
+
+    g = M_SQRT2 / (sqrtf(g / nfft) * sqrtf(nfft));
+
+    for (uint16_t i = 0; i < nfft; i++)
+        psd->window[i] *= g;
+
+    psd_reset(psd);
+}
+
+void psd_reset(psd_t *psd) {
+    memset(psd->history, 0, psd->nfft * sizeof(float complex));
+
+    psd->history_pos = 0;
+    psd->timer = psd->hop;
+}
+
+void psd_attach(psd_t *psd, psd_acc_t *acc) {
+    if (psd->acc_num < PSD_ACC_MAX) {
+        psd->acc[psd->acc_num++] = acc;
+    }
+}
+
+void psd_detach_all(psd_t *psd) {
+    psd->acc_num = 0;
+}
+
+static void psd_step(psd_t *psd) {
+    uint16_t    nfft = psd->nfft;
+    uint16_t    tail = nfft - psd->history_pos;
+
+    /* Oldest sample first */
+
+    for (uint16_t i = 0; i < tail; i++)
+        psd->fft_in[i] = psd->history[psd->history_pos + i] * psd->window[i];
+
+    for (uint16_t i = tail; i < nfft; i++)
+        psd->fft_in[i] = psd->history[i - tail] * psd->window[i];
+
+    fft_execute(psd->fft);
+
+    for (uint8_t n = 0; n < psd->acc_num; n++) {
+        psd_acc_t   *acc = psd->acc[n];
+
+        for (uint16_t i = 0; i < nfft; i++) {
+            float complex x = psd->fft_out[i];
+
+            acc->sum[i] += crealf(x) * crealf(x) + cimagf(x) * cimagf(x);
+        }
+
+        acc->count++;
+    }
+}
+
+void psd_write(psd_t *psd, float complex *buf, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        psd->history[psd->history_pos] = buf[i];
+        psd->history_pos = (psd->history_pos + 1) % psd->nfft;
+
+        if (--psd->timer == 0) {
+            psd->timer = psd->hop;
+            psd_step(psd);
+        }
+    }
+}
+
+void psd_acc_init(psd_acc_t *acc, uint16_t nfft) {
+    acc->nfft = nfft;
+    acc->sum = (float *) malloc(nfft * sizeof(float));
+
+    psd_acc_reset(acc);
+}
+
+void psd_acc_reset(psd_acc_t *acc) {
+    memset(acc->sum, 0, acc->nfft * sizeof(float));
+    acc->count = 0;
+}
+
+bool psd_acc_get(psd_acc_t *acc, float *psd, float offset) {
+    if (acc->count == 0) {
+        return false;
+    }
+
+    uint16_t    nfft = acc->nfft;
+    uint16_t    half = nfft / 2;
+
+    /* Average in dB, zero frequency in the middle */
+
+    offset -= 10.0f * log10f(acc->count);
+
+    for (uint16_t i = 0; i < nfft; i++) {
+        uint16_t k = (i + half) % nfft;
+
+        psd[i] = 10.0f * log10f(acc->sum[k] + 1e-20f) + offset;
+    }
+
+    return true;
+}
+
+/* * */
+
+void psd_traces_init(psd_traces_t *traces, uint16_t nfft) {
+    traces->nfft = nfft;
+    traces->flags = 0;
+    traces->beta = 0.7f;
+    traces->avg_beta = 0.95f;
+    traces->hold = 0.0f;
+    traces->speed = 0.5f;
+
+    traces->main = (float *) malloc(nfft * sizeof(float));
+    traces->peak = (float *) malloc(nfft * sizeof(float));
+    traces->peak_hold = (float *) malloc(nfft * sizeof(float));
+    traces->avg = (float *) malloc(nfft * sizeof(float));
+    traces->min = (float *) malloc(nfft * sizeof(float));
+    traces->min_hold = (float *) malloc(nfft * sizeof(float));
+
+    psd_traces_reset(traces, -INFINITY);
+}
+
+/* Infinite peak and min are taken over by the next frame */
+
+static void traces_restart(psd_traces_t *traces, uint16_t from, uint16_t to) {
+    for (uint16_t i = from; i < to; i++) {
+        traces->peak[i] = -INFINITY;
+        traces->peak_hold[i] = 0.0f;
+        traces->avg[i] = traces->main[i];
+        traces->min[i] = INFINITY;
+        traces->min_hold[i] = 0.0f;
+    }
+}
+
+void psd_traces_reset(psd_traces_t *traces, float x) {
+    for (uint16_t i = 0; i < traces->nfft; i++)
+        traces->main[i] = x;
+
+    traces_restart(traces, 0, traces->nfft);
+}
+
+void psd_traces_clear(psd_traces_t *traces) {
+    traces_restart(traces, 0, traces->nfft);
+}
+
+static inline void trace_shift(float *x, uint16_t nfft, int16_t n) {
+    if (n > 0) {
+        memmove(x + n, x, (nfft - n) * sizeof(float));
+    } else {
+        memmove(x, x - n, (nfft + n) * sizeof(float));
+    }
+}
+
+void psd_traces_shift(psd_traces_t *traces, int16_t n) {
+    uint16_t nfft = traces->nfft;
+
+    if (n == 0) {
+        return;
+    }
+
+    if (abs(n) >= nfft) {
+        psd_traces_clear(traces);
+        return;
+    }
+
+    trace_shift(traces->peak, nfft, n);
+    trace_shift(traces->peak_hold, nfft, n);
+    trace_shift(traces->avg, nfft, n);
+    trace_shift(traces->min, nfft, n);
+    trace_shift(traces->min_hold, nfft, n);
+
+    if (n > 0) {
+        traces_restart(traces, 0, n);
+    } else {
+        traces_restart(traces, nfft + n, nfft);
+    }
+}
+
+/*
+ * Peak follows main up at once and holds, then falls by speed per frame, but never below main.
+ * Min is the same upside down
+ */
+
+static inline void traces_update_bin(psd_traces_t *traces, uint16_t i, float x) {
+    float m = traces->main[i] * traces->beta + x * (1.0f - traces->beta);
+
+    traces->main[i] = m;
+
+    if (traces->flags & PSD_TRACE_PEAK) {
+        float p = traces->peak[i];
+        float h = traces->peak_hold[i];
+
+        if (m > p) {
+            traces->peak[i] = m;
+            traces->peak_hold[i] = traces->hold;
+        } else if (h > 0.0f) {
+            traces->peak_hold[i] = h - 1.0f;
+        } else {
+            traces->peak[i] = fmaxf(p - traces->speed, m);
+        }
+    }
+
+    if (traces->flags & PSD_TRACE_AVG) {
+        traces->avg[i] = traces->avg[i] * traces->avg_beta + m * (1.0f - traces->avg_beta);
+    }
+
+    if (traces->flags & PSD_TRACE_MIN) {
+        float n = traces->min[i];
+        float h = traces->min_hold[i];
+
+        if (m < n) {
+            traces->min[i] = m;
+            traces->min_hold[i] = traces->hold;
+        } else if (h > 0.0f) {
+            traces->min_hold[i] = h - 1.0f;
+        } else {
+            traces->min[i] = fminf(n + traces->speed, m);
+        }
+    }
+}
+
+#ifdef __ARM_NEON
+
+void psd_traces_update(psd_traces_t *traces, const float *psd) {
+    uint16_t    nfft = traces->nfft;
+    uint16_t    i = 0;
+    bool        peak = traces->flags & PSD_TRACE_PEAK;
+    bool        avg = traces->flags & PSD_TRACE_AVG;
+    bool        min = traces->flags & PSD_TRACE_MIN;
+
+    float32x4_t beta = vdupq_n_f32(traces->beta);
+    float32x4_t beta_inv = vdupq_n_f32(1.0f - traces->beta);
+    float32x4_t avg_beta = vdupq_n_f32(traces->avg_beta);
+    float32x4_t avg_beta_inv = vdupq_n_f32(1.0f - traces->avg_beta);
+    float32x4_t hold = vdupq_n_f32(traces->hold);
+    float32x4_t speed = vdupq_n_f32(traces->speed);
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t one = vdupq_n_f32(1.0f);
+
+    for (; i + 4 <= nfft; i += 4) {
+        float32x4_t m = vmlaq_f32(vmulq_f32(vld1q_f32(psd + i), beta_inv), vld1q_f32(traces->main + i), beta);
+
+        vst1q_f32(traces->main + i, m);
+
+        if (peak) {
+            float32x4_t p = vld1q_f32(traces->peak + i);
+            float32x4_t h = vld1q_f32(traces->peak_hold + i);
+            uint32x4_t  up = vcgtq_f32(m, p);
+            uint32x4_t  held = vcgtq_f32(h, zero);
+
+            p = vmaxq_f32(vbslq_f32(held, p, vsubq_f32(p, speed)), m);
+            h = vbslq_f32(up, hold, vmaxq_f32(vsubq_f32(h, one), zero));
+
+            vst1q_f32(traces->peak + i, p);
+            vst1q_f32(traces->peak_hold + i, h);
+        }
+
+        if (avg) {
+            float32x4_t a = vld1q_f32(traces->avg + i);
+
+            vst1q_f32(traces->avg + i, vmlaq_f32(vmulq_f32(m, avg_beta_inv), a, avg_beta));
+        }
+
+        if (min) {
+            float32x4_t n = vld1q_f32(traces->min + i);
+            float32x4_t h = vld1q_f32(traces->min_hold + i);
+            uint32x4_t  down = vcltq_f32(m, n);
+            uint32x4_t  held = vcgtq_f32(h, zero);
+
+            n = vminq_f32(vbslq_f32(held, n, vaddq_f32(n, speed)), m);
+            h = vbslq_f32(down, hold, vmaxq_f32(vsubq_f32(h, one), zero));
+
+            vst1q_f32(traces->min + i, n);
+            vst1q_f32(traces->min_hold + i, h);
+        }
+    }
+
+    for (; i < nfft; i++)
+        traces_update_bin(traces, i, psd[i]);
+}
+
+#else
+
+void psd_traces_update(psd_traces_t *traces, const float *psd) {
+    for (uint16_t i = 0; i < traces->nfft; i++)
+        traces_update_bin(traces, i, psd[i]);
+}
+
+#endif
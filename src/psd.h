@@ -0,0 +1,94 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <liquid/liquid.h>
+
+#define PSD_ACC_MAX     2
+
+/* Averaged power spectrum since the last reset */
+
+typedef struct {
+    uint16_t        nfft;
+    float           *sum;
+    uint32_t        count;
+} psd_acc_t;
+
+/* Windowed FFT with overlap. One magnitude frame per hop fed to all attached accumulators */
+
+typedef struct {
+    uint16_t        nfft;
+    uint16_t        hop;
+    uint16_t        timer;
+
+    float           *window;
+    float complex   *history;
+    uint16_t        history_pos;
+
+    float complex   *fft_in;
+    float complex   *fft_out;
+    fftplan         fft;
+
+    psd_acc_t       *acc[PSD_ACC_MAX];
+    uint8_t         acc_num;
+} psd_t;
+
+void psd_init(psd_t *psd, uint16_t nfft, uint16_t hop);
+void psd_reset(psd_t *psd);
+void psd_write(psd_t *psd, float complex *buf, size_t size);
+
+void psd_attach(psd_t *psd, psd_acc_t *acc);
+void psd_detach_all(psd_t *psd);
+
+void psd_acc_init(psd_acc_t *acc, uint16_t nfft);
+void psd_acc_reset(psd_acc_t *acc);
+bool psd_acc_get(psd_acc_t *acc, float *psd, float offset);
+
+/* Display traces of PSD frames, dB. Hold and decay are counted in frames */
+
+typedef enum {
+    PSD_TRACE_PEAK  = 1 << 0,
+    PSD_TRACE_AVG   = 1 << 1,
+    PSD_TRACE_MIN   = 1 << 2
+} psd_trace_t;
+
+typedef struct {
+    uint16_t        nfft;
+    uint8_t         flags;          /* psd_trace_t, traces to update */
+
+    float           beta;           /* Smoothing of main */
+    float           avg_beta;
+    float           hold;           /* Frames before peak and min start to move */
+    float           speed;          /* dB per frame after the hold */
+
+    float           *main;
+    float           *peak;
+    float           *peak_hold;     /* Frames left */
+    float           *avg;
+    float           *min;
+    float           *min_hold;
+} psd_traces_t;
+
+void psd_traces_init(psd_traces_t *traces, uint16_t nfft);
+
+/* Main and avg to x, peak and min are restarted */
+
+void psd_traces_reset(psd_traces_t *traces, float x);
+
+/* Peak, min and avg restart from main */
+
+void psd_traces_clear(psd_traces_t *traces);
+void psd_traces_update(psd_traces_t *traces, const float *psd);
+
+/* Move peak, min and avg by n bins up (down if negative), vacated bins are restarted */
+
+void psd_traces_shift(psd_traces_t *traces, int16_t n);
@@ -28,6 +28,7 @@
 #include "info.h"
 #include "dialog_swrscan.h"
 #include "voice.h"
+#include "iq_recorder.h"
 
 #define FLOW_RESTART_TIMOUT 300
 #define IDLE_TIMEOUT        (3 * 1000)
@@ -72,6 +73,14 @@ bool radio_tick() {
             clock_update_power(pack->vext * 0.1f, pack->vbat*0.1f, pack->batcap);
         }
 
+        if (iq_recorder_is_on()) {
+            iq_recorder_put_samples(pack->samples);
+        }
+
+        if (iq_player_is_on()) {
+            iq_player_get_samples(pack->samples);
+        }
+
         dsp_samples(pack->samples, RADIO_SAMPLES);
 
         switch (state) {
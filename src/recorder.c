@@ -6,64 +6,186 @@
  *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
  */
 
+#include <stdio.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
 #include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sndfile.h>
 
+#include "lvgl/lvgl.h"
 #include "audio.h"
 #include "dialog_recorder.h"
 #include "recorder.h"
 #include "msg.h"
 #include "params.h"
 
-char            *recorder_path = "/mnt/rec";
+#define RING_SIZE   (1 << 18)       /* About 6 seconds */
+#define WRITE_SIZE  4096
+#define WRITER_NICE 10
 
-static bool     on = false;
-static SNDFILE  *file = NULL;
+char                    *recorder_path = "/mnt/rec";
+
+static atomic_bool      on = false;
+static SNDFILE          *file = NULL;
+
+/* Single producer (capture callback), single consumer (writer thread) */
+
+static int16_t          ring[RING_SIZE];
+static atomic_size_t    ring_head = 0;
+static atomic_size_t    ring_tail = 0;
+static atomic_uint      overruns = 0;
+static atomic_uint      samples_total = 0;
+
+static pthread_t        writer;
+static sem_t            writer_sem;
+static atomic_bool      writer_run = false;
+static atomic_bool      writer_busy = false;   /* Until the file is closed */
+static bool             writer_sem_init = false;
 
 static bool create_file() {
-    SF_INFO sfinfo;
+    SF_INFO     sfinfo;
+    const char  *ext;
 
     memset(&sfinfo, 0, sizeof(sfinfo));
 
     sfinfo.samplerate = AUDIO_CAPTURE_RATE;
     sfinfo.channels = 1;
-    sfinfo.format = SF_FORMAT_MPEG | SF_FORMAT_MPEG_LAYER_III;
-    
+
+    switch (params.rec_format.x) {
+        case REC_FORMAT_WAV:
+            sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+            ext = "wav";
+            break;
+
+        case REC_FORMAT_FLAC:
+            sfinfo.format = SF_FORMAT_FLAC | SF_FORMAT_PCM_16;
+            ext = "flac";
+            break;
+
+        default:
+            sfinfo.format = SF_FORMAT_MPEG | SF_FORMAT_MPEG_LAYER_III;
+            ext = "mp3";
+            break;
+    }
+
     char        filename[64];
     time_t      now = time(NULL);
     struct tm   *t = localtime(&now);
 
     snprintf(filename, sizeof(filename),
-        "%s/REC_%04i%02i%02i_%02i%02i%02i.mp3", 
-        recorder_path, t->tm_year + 1900, t->tm_mon + 1, t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec
+        "%s/REC_%04i%02i%02i_%02i%02i%02i.%s",
+        recorder_path, t->tm_year + 1900, t->tm_mon + 1, t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec, ext
     );
-    
+
     file = sf_open(filename, SFM_WRITE, &sfinfo);
-    
+
     if (file == NULL) {
         return false;
     }
 
-    double q = 0.25;
-    sf_command(file, SFC_SET_VBR_ENCODING_QUALITY, &q, sizeof(q));
+    if (params.rec_format.x == REC_FORMAT_MP3) {
+        double q = 0.25;
+        sf_command(file, SFC_SET_VBR_ENCODING_QUALITY, &q, sizeof(q));
+    }
 
     return true;
 }
 
+/* Write everything queued so far, in runs that do not wrap the ring */
+
+static void writer_flush() {
+    size_t tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+
+    while (tail != head) {
+        size_t pos = tail & (RING_SIZE - 1);
+        size_t n = head - tail;
+
+        if (n > RING_SIZE - pos) {
+            n = RING_SIZE - pos;
+        }
+
+        if (n > WRITE_SIZE) {
+            n = WRITE_SIZE;
+        }
+
+        sf_write_short(file, &ring[pos], n);
+
+        tail += n;
+        atomic_store_explicit(&ring_tail, tail, memory_order_release);
+    }
+}
+
+static void * writer_thread(void *arg) {
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), WRITER_NICE);
+
+    while (atomic_load(&writer_run)) {
+        sem_wait(&writer_sem);
+        writer_flush();
+    }
+
+    /* Tail of the ring, MP3 may take seconds. Reported through the event queue */
+
+    writer_flush();
+    sf_close(file);
+    file = NULL;
+
+    uint32_t n = atomic_load(&overruns);
+
+    if (n) {
+        LV_LOG_WARN("Recorder overruns: %u", n);
+    }
+
+    msg_set_text_fmt("Recorder is off");
+    atomic_store(&writer_busy, false);
+
+    return NULL;
+}
+
 void recorder_set_on(bool x) {
+    if (x == on) {
+        return;
+    }
+
     if (x) {
+        if (atomic_load(&writer_busy)) {
+            msg_set_text_fmt("Recorder is saving the file");
+            return;
+        }
+
         if (!create_file()) {
             msg_set_text_fmt("Problem with create file");
             return;
         } else {
             msg_set_text_fmt("Recorder is on");
         }
+
+        atomic_store(&ring_head, 0);
+        atomic_store(&ring_tail, 0);
+        atomic_store(&overruns, 0);
+        atomic_store(&samples_total, 0);
+        atomic_store(&writer_run, true);
+        atomic_store(&writer_busy, true);
+
+        if (!writer_sem_init) {
+            sem_init(&writer_sem, 0, 0);
+            writer_sem_init = true;
+        }
+
+        pthread_create(&writer, NULL, writer_thread, NULL);
+        pthread_detach(writer);
         on = true;
     } else {
-        msg_set_text_fmt("Recorder is off");
         on = false;
-        sf_close(file);
+
+        atomic_store(&writer_run, false);
+        sem_post(&writer_sem);
     }
 
     dialog_recorder_set_on(on);
@@ -73,9 +195,44 @@ bool recorder_is_on() {
     return on;
 }
 
+uint32_t recorder_overruns() {
+    return atomic_load(&overruns);
+}
+
+uint32_t recorder_samples() {
+    return atomic_load(&samples_total);
+}
+
+/* Called from the capture callback: no locks, no allocation, no IO */
+
 void recorder_put_audio_samples(size_t nsamples, int16_t *samples) {
-    int16_t *out_samples = audio_gain(samples, nsamples, params.rec_gain * 6);
+    size_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+
+    if (RING_SIZE - (head - tail) < nsamples) {
+        atomic_fetch_add(&overruns, 1);
+        return;
+    }
+
+    float   gain = params.rec_gain * 6 / 100.0f;
+    size_t  total = nsamples;
+
+    while (nsamples > 0) {
+        size_t pos = head & (RING_SIZE - 1);
+        size_t n = RING_SIZE - pos;
+
+        if (n > nsamples) {
+            n = nsamples;
+        }
+
+        audio_gain(samples, &ring[pos], n, gain);
+
+        samples += n;
+        nsamples -= n;
+        head += n;
+    }
 
-    sf_write_short(file, out_samples, nsamples);
-    free(out_samples);
+    atomic_fetch_add(&samples_total, total);
+    atomic_store_explicit(&ring_head, head, memory_order_release);
+    sem_post(&writer_sem);
 }
@@ -10,9 +10,15 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 
 extern char *recorder_path;
 
 void recorder_set_on(bool on);
 bool recorder_is_on();
+
+/* Capture blocks dropped because the writer could not keep up, samples recorded */
+
+uint32_t recorder_overruns();
+uint32_t recorder_samples();
 void recorder_put_audio_samples(size_t nsamples, int16_t *samples);
@@ -232,7 +232,7 @@ static void add_symbol(float pwr) {
     }
 }
 
-void rtty_put_audio_samples(unsigned int n, float complex *samples) {
+void rtty_put_audio_samples(unsigned int n, const float complex *samples) {
     pthread_mutex_lock(&rtty_mux);
 
     if (!ready) {
@@ -240,7 +240,7 @@ void rtty_put_audio_samples(unsigned int n, float complex *samples) {
         return;
     }
 
-    cbuffercf_write(rx_buf, samples, n);
+    cbuffercf_write(rx_buf, (float complex *) samples, n);
     
     x6100_mode_t    mode = radio_current_mode();
 
@@ -7,6 +7,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 
 #include "styles.h"
@@ -19,6 +20,10 @@
 #include "meter.h"
 #include "rtty.h"
 #include "recorder.h"
+#include "backlight.h"
+#include "spectrum_render.h"
+
+#define SPECTRUM_RUNS   32
 
 float                   spectrum_auto_min;
 float                   spectrum_auto_max;
@@ -36,90 +41,125 @@ static float            *spectrum_buf = NULL;
 
 static int16_t          delta_surplus = 0;
 
+static float            *peak_buf;
+
+static pthread_mutex_t  data_mux;
+
+static spectrum_render_t    render;
+static spectrum_run_t       runs[SPECTRUM_RUNS];
+
+/* Everything drawn over the trace. The whole widget is redrawn when it changes */
+
 typedef struct {
-    float       val;
-    uint64_t    time;
-} peak_t;
+    int32_t     filter_from;
+    int32_t     filter_to;
+    int16_t     spectrum_factor;
+    int16_t     visor_height;
+    bool        dnf;
+    uint16_t    dnf_center;
+    uint16_t    dnf_width;
+    bool        rtty;
+    uint16_t    rtty_center;
+    uint16_t    rtty_shift;
+    bool        recorder;
+} overlay_t;
+
+static overlay_t        overlay;
+
+static void overlay_get(overlay_t *x) {
+    memset(x, 0, sizeof(*x));
+
+    radio_filter_get(&x->filter_from, &x->filter_to);
+
+    x->spectrum_factor = params_mode.spectrum_factor;
+    x->visor_height = visor_height;
+    x->dnf = params.dnf;
+    x->dnf_center = params.dnf_center;
+    x->dnf_width = params.dnf_width;
+    x->rtty = rtty_get_state() != RTTY_OFF;
+    x->rtty_center = params.rtty_center;
+    x->rtty_shift = params.rtty_shift;
+    x->recorder = recorder_is_on();
+}
 
-static peak_t           *spectrum_peak;
+/* New data, UI thread. Columns are rasterized here, only changed ones are invalidated */
 
-static pthread_mutex_t  data_mux;
+static void spectrum_update_cb(lv_event_t * e) {
+    overlay_t   new_overlay;
+    bool        full;
+
+    if (!backlight_is_on()) {
+        return;
+    }
+
+    lv_coord_t  w = lv_obj_get_width(obj);
+    lv_coord_t  h = lv_obj_get_height(obj);
+
+    full = spectrum_render_resize(&render, w, h);
+
+    render.filled = params.spectrum_filled;
+    render.aa = params.spectrum_aa.x;
+
+    float min = params.spectrum_auto_min.x ? spectrum_auto_min + 6.0f : grid_min;
+    float max = params.spectrum_auto_max.x ? spectrum_auto_max + 10.0f : grid_max;
+
+    pthread_mutex_lock(&data_mux);
+
+    uint16_t n = spectrum_render_update(&render, spectrum_buf, params.spectrum_peak ? peak_buf : NULL, spectrum_size,
+        min, max, runs, SPECTRUM_RUNS);
+
+    pthread_mutex_unlock(&data_mux);
+
+    overlay_get(&new_overlay);
+
+    if (memcmp(&new_overlay, &overlay, sizeof(overlay)) != 0) {
+        overlay = new_overlay;
+        full = true;
+    }
+
+    if (full) {
+        lv_obj_invalidate(obj);
+        return;
+    }
+
+    lv_coord_t  x1 = obj->coords.x1;
+
+    for (uint16_t i = 0; i < n; i++) {
+        lv_area_t area = {
+            .x1 = x1 + runs[i].from,
+            .y1 = obj->coords.y1,
+            .x2 = x1 + runs[i].to,
+            .y2 = obj->coords.y2
+        };
+
+        lv_obj_invalidate_area(obj, &area);
+    }
+}
 
 static void spectrum_draw_cb(lv_event_t * e) {
     lv_obj_t            *obj = lv_event_get_target(e);
     lv_draw_ctx_t       *draw_ctx = lv_event_get_draw_ctx(e);
     lv_draw_line_dsc_t  main_line_dsc;
-    lv_draw_line_dsc_t  peak_line_dsc;
+    lv_point_t          main_a, main_b;
     
     if (!spectrum_buf) {
         return;
     }
 
-    /* Lines */
-    
-    lv_draw_line_dsc_init(&main_line_dsc);
-    
-    main_line_dsc.color = lv_color_hex(0xAAAAAA);
-    main_line_dsc.width = 2;
-
-    lv_draw_line_dsc_init(&peak_line_dsc);
-    
-    peak_line_dsc.color = lv_color_hex(0x555555);
-    peak_line_dsc.width = 1;
-
     lv_coord_t x1 = obj->coords.x1;
     lv_coord_t y1 = obj->coords.y1;
 
     lv_coord_t w = lv_obj_get_width(obj);
     lv_coord_t h = lv_obj_get_height(obj);
-    
-    lv_point_t main_a, main_b;
-    lv_point_t peak_a, peak_b;
-    
-    if (!params.spectrum_filled) {
-        main_b.x = x1;
-        main_b.y = y1 + h;
-    }
 
-    peak_b.x = x1;
-    peak_b.y = y1 + h;
+    /* Trace and peak */
 
-    float min = params.spectrum_auto_min.x ? spectrum_auto_min + 6.0f : grid_min;
-    float max = params.spectrum_auto_max.x ? spectrum_auto_max + 10.0f : grid_max;
-    
-    for (uint16_t i = 0; i < spectrum_size; i++) {
-        float       v = (spectrum_buf[i] - min) / (max - min);
-        uint16_t    x = i * w / spectrum_size;
+    spectrum_render_draw(&render, draw_ctx->buf, draw_ctx->buf_area, draw_ctx->clip_area, x1, y1);
 
-        /* Peak */
-        
-        if (params.spectrum_peak) {
-            float v_peak = (spectrum_peak[i].val - min) / (max - min);
-
-            peak_a.x = x1 + x;
-            peak_a.y = y1 + (1.0f - v_peak) * h;
-
-            lv_draw_line(draw_ctx, &peak_line_dsc, &peak_a, &peak_b);
-
-            peak_b = peak_a;
-        }
-
-        /* Main */
-
-        main_a.x = x1 + x;
-        main_a.y = y1 + (1.0f - v) * h;
-
-        if (params.spectrum_filled) {
-            main_b.x = main_a.x;
-            main_b.y = y1 + h;
-        }
-        
-        lv_draw_line(draw_ctx, &main_line_dsc, &main_a, &main_b);
-        
-        if (!params.spectrum_filled) {
-            main_b = main_a;
-        }
-    }
+    lv_draw_line_dsc_init(&main_line_dsc);
+    
+    main_line_dsc.color = lv_color_hex(0xAAAAAA);
+    main_line_dsc.width = 2;
 
     /* Filter */
     
@@ -220,12 +260,15 @@ lv_obj_t * spectrum_init(lv_obj_t * parent) {
     pthread_mutex_init(&data_mux, NULL);
 
     spectrum_buf = malloc(spectrum_size * sizeof(float));
-    spectrum_peak = malloc(spectrum_size * sizeof(peak_t));
+    peak_buf = malloc(spectrum_size * sizeof(float));
+
+    spectrum_render_init(&render);
 
     obj = lv_obj_create(parent);
 
     lv_obj_add_style(obj, &spectrum_style, 0);
     lv_obj_add_event_cb(obj, spectrum_draw_cb, LV_EVENT_DRAW_MAIN_END, NULL);
+    lv_obj_add_event_cb(obj, spectrum_update_cb, LV_EVENT_VALUE_CHANGED, NULL);
     lv_obj_add_event_cb(obj, tx_cb, EVENT_RADIO_TX, NULL);
     lv_obj_add_event_cb(obj, rx_cb, EVENT_RADIO_RX, NULL);
 
@@ -235,31 +278,21 @@ lv_obj_t * spectrum_init(lv_obj_t * parent) {
     return obj;
 }
 
-void spectrum_data(float *data_buf, uint16_t size) {
-    uint64_t now = get_time();
+void spectrum_data(const psd_traces_t *traces) {
+    uint16_t size = traces->nfft;
 
     pthread_mutex_lock(&data_mux);
 
-    for (uint16_t i = 0; i < size; i++) {
-        spectrum_buf[i] = data_buf[size - i - 1];
-        
-        if (params.spectrum_peak) {
-            float   v = spectrum_buf[i];
-            peak_t  *peak = &spectrum_peak[i];
-
-            if (v > peak->val) {
-                peak->time = now;
-                peak->val = v;
-            } else {
-                if (now - peak->time > params.spectrum_peak_hold) {
-                    peak->val -= params.spectrum_peak_speed;
-                }
-            }
-        }
+    for (uint16_t i = 0; i < size; i++)
+        spectrum_buf[i] = traces->main[size - i - 1];
+
+    if (traces->flags & PSD_TRACE_PEAK) {
+        for (uint16_t i = 0; i < size; i++)
+            peak_buf[i] = traces->peak[size - i - 1];
     }
 
     pthread_mutex_unlock(&data_mux);
-    event_send(obj, LV_EVENT_REFRESH, NULL);
+    event_send(obj, LV_EVENT_VALUE_CHANGED, NULL);
 }
 
 void spectrum_band_set() {
@@ -280,18 +313,16 @@ void spectrum_set_min(int db) {
 }
 
 void spectrum_clear() {
-    uint64_t now = get_time();
+    pthread_mutex_lock(&data_mux);
 
-    for (uint16_t i = 0; i < spectrum_size; i++) {
-        spectrum_peak[i].val = S_MIN;
-        spectrum_peak[i].time = now;
-    }
+    for (uint16_t i = 0; i < spectrum_size; i++)
+        peak_buf[i] = S_MIN;
+
+    pthread_mutex_unlock(&data_mux);
+    dsp_spectrum_clear();
 }
 
 void spectrum_change_freq(int16_t df) {
-    peak_t      *from, *to;
-    uint64_t    time = get_time();
-
     uint16_t    div = width_hz / spectrum_size / params_mode.spectrum_factor;
     int16_t     surplus = df % div;
     int32_t     delta = df / div;
@@ -311,31 +342,7 @@ void spectrum_change_freq(int16_t df) {
         return;
     }
 
-    if (delta > 0) {
-        for (int16_t i = 0; i < spectrum_size - 1; i++) {
-            to = &spectrum_peak[i];
-
-            if (i >= spectrum_size - delta) {
-                to->val = S_MIN;
-                to->time = time;
-            } else {
-                from = &spectrum_peak[i + delta];
-                *to = *from;
-            }
-        }
-    } else {
-        delta = -delta;
-
-        for (int16_t i = spectrum_size - 1; i > 0; i--) {
-            to = &spectrum_peak[i];
-        
-            if (i <= delta) {
-                to->val = S_MIN;
-                to->time = time;
-            } else {
-                from = &spectrum_peak[i - delta];
-                *to = *from;
-            }
-        }
-    }
+    /* Peaks are held in the DSP, in reverse bin order */
+
+    dsp_spectrum_shift(delta);
 }
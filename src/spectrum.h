@@ -12,12 +12,13 @@
 #include <stdint.h>
 
 #include "lvgl/lvgl.h"
+#include "psd.h"
 
 extern float spectrum_auto_min;
 extern float spectrum_auto_max;
 
 lv_obj_t * spectrum_init(lv_obj_t * parent);
-void spectrum_data(float *data_buf, uint16_t size);
+void spectrum_data(const psd_traces_t *traces);
 void spectrum_band_set();
 void spectrum_mode_set();
 
@@ -0,0 +1,243 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "spectrum_render.h"
+
+#define MAIN_WIDTH  2       /* Line trace thickness */
+#define PEAK_WIDTH  1
+#define RUN_GAP     8       /* Changed columns closer than this go into one run */
+
+void spectrum_render_init(spectrum_render_t *r) {
+    memset(r, 0, sizeof(*r));
+
+    r->filled = true;
+    r->main_color = lv_color_hex(0xAAAAAA);
+    r->peak_color = lv_color_hex(0x555555);
+}
+
+void spectrum_render_free(spectrum_render_t *r) {
+    free(r->columns);
+
+    r->columns = NULL;
+    r->width = 0;
+    r->height = 0;
+}
+
+bool spectrum_render_resize(spectrum_render_t *r, uint16_t width, uint16_t height) {
+    if (r->columns && r->width == width && r->height == height) {
+        return false;
+    }
+
+    free(r->columns);
+
+    r->width = width;
+    r->height = height;
+    r->columns = calloc(width, sizeof(spectrum_column_t));
+
+    for (uint16_t x = 0; x < width; x++) {
+        r->columns[x].main_top = height;
+        r->columns[x].main_bottom = height;
+        r->columns[x].peak_top = height;
+        r->columns[x].peak_bottom = height;
+    }
+
+    return true;
+}
+
+/* Screen y of a value, fractional, 0 is the top */
+
+static inline float value_y(float v, float min, float scale, uint16_t h) {
+    float y = (1.0f - (v - min) * scale) * h;
+
+    if (y < 0.0f) {
+        return 0.0f;
+    }
+
+    if (y > h) {
+        return h;
+    }
+
+    return y;
+}
+
+/* Value of bins under column x, linear between bins */
+
+static inline float column_value(const float *bins, uint16_t size, uint32_t x, uint16_t w) {
+    uint32_t    pos = x * size * 256 / w;
+    uint32_t    i = pos >> 8;
+    float       frac = (pos & 0xFF) * (1.0f / 256.0f);
+
+    if (i + 1 >= size) {
+        return bins[size - 1];
+    }
+
+    return bins[i] + (bins[i + 1] - bins[i]) * frac;
+}
+
+/* Span from top to bottom, the pixel above gets partial coverage with aa */
+
+static inline void make_span(float top, int16_t bottom, bool aa, int16_t *out_top, int16_t *out_bottom, uint8_t *opa) {
+    if (aa) {
+        int16_t t = ceilf(top);
+
+        *out_top = t;
+        *opa = (t - top) * 255.0f;
+    } else {
+        *out_top = lrintf(top);
+        *opa = 0;
+    }
+
+    *out_bottom = bottom > *out_top ? bottom : *out_top;
+}
+
+static inline void line_span(float y, float prev, uint16_t width, uint16_t h, bool aa, int16_t *top, int16_t *bottom, uint8_t *opa) {
+    float   lo = y < prev ? y : prev;
+    float   hi = y < prev ? prev : y;
+    int16_t b = lrintf(hi) + width;
+
+    if (b > h) {
+        b = h;
+    }
+
+    make_span(lo, b, aa, top, bottom, opa);
+}
+
+uint16_t spectrum_render_update(spectrum_render_t *r, const float *bins, const float *peak, uint16_t size,
+    float min, float max, spectrum_run_t *runs, uint16_t max_runs)
+{
+    uint16_t    w = r->width;
+    uint16_t    h = r->height;
+    float       scale = 1.0f / (max - min);
+    float       main_prev = 0.0f;
+    float       peak_prev = 0.0f;
+    uint16_t    n = 0;
+
+    if (!r->columns || size == 0) {
+        return 0;
+    }
+
+    for (uint16_t x = 0; x < w; x++) {
+        spectrum_column_t   col;
+        float               y = value_y(column_value(bins, size, x, w), min, scale, h);
+
+        if (x == 0) {
+            main_prev = y;
+        }
+
+        if (r->filled) {
+            make_span(y, h, r->aa, &col.main_top, &col.main_bottom, &col.main_opa);
+        } else {
+            line_span(y, main_prev, MAIN_WIDTH, h, r->aa, &col.main_top, &col.main_bottom, &col.main_opa);
+        }
+
+        main_prev = y;
+
+        if (peak) {
+            float py = value_y(column_value(peak, size, x, w), min, scale, h);
+
+            if (x == 0) {
+                peak_prev = py;
+            }
+
+            line_span(py, peak_prev, PEAK_WIDTH, h, r->aa, &col.peak_top, &col.peak_bottom, &col.peak_opa);
+            peak_prev = py;
+        } else {
+            col.peak_top = h;
+            col.peak_bottom = h;
+            col.peak_opa = 0;
+        }
+
+        spectrum_column_t *old = &r->columns[x];
+
+        if (old->main_top == col.main_top && old->main_bottom == col.main_bottom && old->main_opa == col.main_opa &&
+            old->peak_top == col.peak_top && old->peak_bottom == col.peak_bottom && old->peak_opa == col.peak_opa)
+        {
+            continue;
+        }
+
+        *old = col;
+
+        if (max_runs == 0) {
+            continue;
+        }
+
+        if (n > 0 && (x - runs[n - 1].to <= RUN_GAP || n == max_runs)) {
+            runs[n - 1].to = x;
+        } else {
+            runs[n].from = x;
+            runs[n].to = x;
+            n++;
+        }
+    }
+
+    return n;
+}
+
+static inline void fill(lv_color_t *px, lv_coord_t stride, int16_t from, int16_t to, lv_color_t color) {
+    for (int16_t y = from; y < to; y++) {
+        *px = color;
+        px += stride;
+    }
+}
+
+/* Span [top, bottom) of one column, clipped to [y1, y2) in widget coordinates */
+
+static inline void draw_span(lv_color_t *col, lv_coord_t stride, int16_t top, int16_t bottom, uint8_t opa,
+    lv_coord_t y1, lv_coord_t y2, lv_color_t color)
+{
+    if (opa && top - 1 >= y1 && top - 1 < y2) {
+        lv_color_t *px = col + (top - 1) * stride;
+
+        *px = lv_color_mix(color, *px, opa);
+    }
+
+    if (top < y1) {
+        top = y1;
+    }
+
+    if (bottom > y2) {
+        bottom = y2;
+    }
+
+    if (top < bottom) {
+        fill(col + top * stride, stride, top, bottom, color);
+    }
+}
+
+void spectrum_render_draw(const spectrum_render_t *r, lv_color_t *buf, const lv_area_t *buf_area,
+    const lv_area_t *clip, lv_coord_t x0, lv_coord_t y0)
+{
+    if (!r->columns) {
+        return;
+    }
+
+    lv_coord_t  stride = lv_area_get_width(buf_area);
+    lv_coord_t  x1 = LV_MAX(clip->x1, x0);
+    lv_coord_t  x2 = LV_MIN(clip->x2, x0 + r->width - 1);
+    lv_coord_t  y1 = LV_MAX(clip->y1, y0) - y0;
+    lv_coord_t  y2 = LV_MIN(clip->y2, y0 + r->height - 1) - y0 + 1;
+
+    if (x1 > x2 || y1 >= y2) {
+        return;
+    }
+
+    /* Pixel (x0 + x, y0 + y) is origin[y * stride + x] */
+
+    lv_color_t *origin = buf + (y0 - buf_area->y1) * stride + (x0 - buf_area->x1);
+
+    for (lv_coord_t x = x1 - x0; x <= x2 - x0; x++) {
+        const spectrum_column_t *col = &r->columns[x];
+
+        draw_span(origin + x, stride, col->peak_top, col->peak_bottom, col->peak_opa, y1, y2, r->peak_color);
+        draw_span(origin + x, stride, col->main_top, col->main_bottom, col->main_opa, y1, y2, r->main_color);
+    }
+}
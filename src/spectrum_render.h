@@ -0,0 +1,66 @@
+/*
+ *  SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ *  Xiegu X6100 LVGL GUI
+ *
+ *  Copyright (c) 2022-2023 Belousov Oleg aka R1CBU
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*
+ * Spectrum trace rasterizer. Bins are turned into one vertical span per screen column,
+ * then spans are written straight into the draw buffer. Columns are compared with
+ * the previous frame, so only the changed ones have to be invalidated
+ */
+
+typedef struct {
+    int16_t     main_top;
+    int16_t     main_bottom;        /* Exclusive */
+    int16_t     peak_top;
+    int16_t     peak_bottom;
+    uint8_t     main_opa;           /* Coverage of the pixel above the span, anti-aliasing */
+    uint8_t     peak_opa;
+} spectrum_column_t;
+
+typedef struct {
+    int16_t     from;
+    int16_t     to;                 /* Inclusive */
+} spectrum_run_t;
+
+typedef struct {
+    uint16_t            width;
+    uint16_t            height;
+
+    bool                filled;
+    bool                aa;
+    lv_color_t          main_color;
+    lv_color_t          peak_color;
+
+    spectrum_column_t   *columns;
+} spectrum_render_t;
+
+void spectrum_render_init(spectrum_render_t *r);
+void spectrum_render_free(spectrum_render_t *r);
+
+/* Returns true if the size changed, everything has to be redrawn then */
+
+bool spectrum_render_resize(spectrum_render_t *r, uint16_t width, uint16_t height);
+
+/*
+ * Map bins (and peak, if not NULL) to columns, min and max are dB at the bottom and the top.
+ * Changed columns are returned as up to max_runs runs, close runs are merged
+ */
+
+uint16_t spectrum_render_update(spectrum_render_t *r, const float *bins, const float *peak, uint16_t size,
+    float min, float max, spectrum_run_t *runs, uint16_t max_runs);
+
+/* Rasterize into buf, which covers buf_area. Only pixels inside clip are written. x0, y0 is the widget origin */
+
+void spectrum_render_draw(const spectrum_render_t *r, lv_color_t *buf, const lv_area_t *buf_area,
+    const lv_area_t *clip, lv_coord_t x0, lv_coord_t y0);
@@ -18,8 +18,7 @@
 #include "meter.h"
 #include "backlight.h"
 #include "dsp.h"
-
-#define PX_BYTES    4
+#include "widgets/lv_waterfall.h"
 
 float                   waterfall_auto_min;
 float                   waterfall_auto_max;
@@ -30,15 +29,10 @@ static lv_obj_t         *img;
 static lv_coord_t       width;
 static lv_coord_t       height;
 static int32_t          width_hz = 100000;
-static uint32_t         line_len;
-static uint8_t          *line_buf = NULL;
 
 static int              grid_min = -70;
 static int              grid_max = -40;
 
-static lv_img_dsc_t     *frame;
-static lv_color_t       palette[256];
-static int16_t          scroll_hor = 0;
 static int16_t          scroll_hor_surplus = 0;
 
 lv_obj_t * waterfall_init(lv_obj_t * parent) {
@@ -50,85 +44,12 @@ lv_obj_t * waterfall_init(lv_obj_t * parent) {
     return obj;
 }
 
-static void scroll_down() {
-    uint8_t     *ptr = frame->data + frame->data_size - line_len * 2;
-
-    for (int y = 0; y < height-1; y++) {
-        memcpy(ptr + line_len, ptr, line_len);
-        ptr -= line_len;
-    }
-}
-
-static void scroll_right(int16_t px) {
-    uint8_t     *ptr = frame->data;
-    uint16_t    offset = px * PX_BYTES;
-    uint16_t    tail = (width - px) * PX_BYTES;
-    
-    for (int y = 0; y < height; y++) {
-        memset(line_buf + tail, 0, offset);
-        memcpy(line_buf, ptr + offset, tail);
-        memcpy(ptr, line_buf, line_len);
-        
-        ptr += line_len;
-    }
-}
-
-static void scroll_left(int16_t px) {
-    uint8_t     *ptr = frame->data;
-    uint16_t    offset = px * PX_BYTES;
-    uint16_t    tail = (width - px) * PX_BYTES;
-    
-    for (int y = 0; y < height; y++) {
-        memset(line_buf, 0, offset);
-        memcpy(line_buf + offset, ptr, tail);
-        memcpy(ptr, line_buf, line_len);
-        
-        ptr += line_len;
-    }
-}
-
 void waterfall_data(float *data_buf, uint16_t size) {
-    if (scroll_hor) {
-        return;
-    }
-
-    scroll_down();
-
     float min = params.waterfall_auto_min.x ? waterfall_auto_min + 6.0f : grid_min;
     float max = params.waterfall_auto_max.x ? waterfall_auto_max + 3.0f : grid_max;
 
-    for (int x = 0; x < width; x++) {
-        uint16_t    index = x * size / width;
-        float       v = (data_buf[index] - min) / (max - min);
-        
-        if (v < 0.0f) {
-            v = 0.0f;
-        } else if (v > 1.0f) {
-            v = 1.0f;
-        }
-        
-        uint8_t id = v * 255;
-        
-        lv_img_buf_set_px_color(frame, width - x, 0, palette[id]);
-    }
-    
-    event_send(img, LV_EVENT_REFRESH, NULL);
-}
-
-static void do_scroll_cb(lv_event_t * event) {
-    if (scroll_hor == 0) {
-        return;
-    }
-
-    int16_t px = (abs(scroll_hor) / 10) + 1;
-
-    if (scroll_hor > 0) {
-        scroll_right(px);
-        scroll_hor -= px;
-    } else {
-        scroll_left(px);
-        scroll_hor += px;
-    }
+    lv_waterfall_set_range(img, min, max);
+    lv_waterfall_add_data(img, data_buf, size);
     
     event_send(img, LV_EVENT_REFRESH, NULL);
 }
@@ -143,25 +64,23 @@ void waterfall_set_height(lv_coord_t h) {
     width = 800;
     height = lv_obj_get_height(obj);
 
-    frame = lv_img_buf_alloc(width, height, LV_IMG_CF_TRUE_COLOR);
+    lv_color_t palette[256];
 
-    line_len = frame->data_size / frame->header.h;
-    line_buf = malloc(line_len);
-    
     styles_waterfall_palette(palette, 256);
 
-    img = lv_img_create(obj);
+    img = lv_waterfall_create(obj);
     lv_obj_align(img, LV_ALIGN_CENTER, 0, 0);
-    lv_img_set_src(img, frame);
-    lv_obj_add_event_cb(img, do_scroll_cb, LV_EVENT_DRAW_POST, NULL);
+
+    lv_waterfall_set_palette(img, palette, 256);
+    lv_waterfall_set_mirror(img, true);
+    lv_waterfall_set_size(img, width, height);
     
     waterfall_band_set();
     band_info_init(obj);
 }
 
 void waterfall_clear() {
-    memset(frame->data,0, frame->data_size);
-    scroll_hor = 0;
+    lv_waterfall_clear_data(img);
     scroll_hor_surplus = 0;
 }
 
@@ -205,9 +124,8 @@ void waterfall_change_min(int16_t d) {
 void waterfall_change_freq(int16_t df) {
     uint16_t    div = width_hz / width;
     int16_t     surplus = df % div;
+    int16_t     px = df / div;
 
-    scroll_hor += df / div;
-    
     if (surplus) {
         scroll_hor_surplus += surplus;
     } else {
@@ -215,11 +133,12 @@ void waterfall_change_freq(int16_t df) {
     }
     
     if (abs(scroll_hor_surplus) > div) {
-        scroll_hor += scroll_hor_surplus / div;
+        px += scroll_hor_surplus / div;
         scroll_hor_surplus = scroll_hor_surplus % div;
     }
 
-    if (scroll_hor) {
+    if (px) {
+        lv_waterfall_scroll(img, px);
         lv_obj_invalidate(img);
     }
 }
@@ -21,6 +21,7 @@
  
 static void lv_waterfall_constructor(const lv_obj_class_t * class_p, lv_obj_t * obj);
 static void lv_waterfall_destructor(const lv_obj_class_t * class_p, lv_obj_t * obj);
+static void lv_waterfall_event(const lv_obj_class_t * class_p, lv_event_t * e);
 
 /**********************
  *  STATIC VARIABLES
@@ -29,7 +30,8 @@ static void lv_waterfall_destructor(const lv_obj_class_t * class_p, lv_obj_t * o
 const lv_obj_class_t lv_waterfall_class  = {
     .constructor_cb = lv_waterfall_constructor,
     .destructor_cb = lv_waterfall_destructor,
-    .base_class = &lv_img_class,
+    .base_class = &lv_obj_class,
+    .event_cb = lv_waterfall_event,
     .instance_size = sizeof(lv_waterfall_t),
 };
 
@@ -68,14 +70,37 @@ void lv_waterfall_set_size(lv_obj_t * obj, lv_coord_t w, lv_coord_t h) {
 
     lv_waterfall_t * waterfall = (lv_waterfall_t *)obj;
 
-    waterfall->dsc = lv_img_buf_alloc(w, h, LV_IMG_CF_TRUE_COLOR);
-    memset(waterfall->dsc->data, 0, waterfall->dsc->data_size);
+    waterfall->w = w;
+    waterfall->h = h;
+    waterfall->buf = lv_mem_realloc(waterfall->buf, w * h * sizeof(lv_color_t));
+    waterfall->line_x = lv_mem_realloc(waterfall->line_x, h * sizeof(waterfall->line_x[0]));
 
-    waterfall->line_len = waterfall->dsc->data_size / waterfall->dsc->header.h;
-    waterfall->line_buf = lv_mem_realloc(waterfall->line_buf, waterfall->line_len);
+    lv_waterfall_clear_data(obj);
+}
+
+void lv_waterfall_set_range(lv_obj_t * obj, float min, float max) {
+    LV_ASSERT_OBJ(obj, MY_CLASS);
+
+    lv_waterfall_t * waterfall = (lv_waterfall_t *)obj;
+
+    waterfall->min = min;
+    waterfall->max = max;
+}
+
+void lv_waterfall_set_mirror(lv_obj_t * obj, bool on) {
+    LV_ASSERT_OBJ(obj, MY_CLASS);
+
+    lv_waterfall_t * waterfall = (lv_waterfall_t *)obj;
+
+    waterfall->mirror = on;
+}
+
+void lv_waterfall_scroll(lv_obj_t * obj, int16_t px) {
+    LV_ASSERT_OBJ(obj, MY_CLASS);
+
+    lv_waterfall_t * waterfall = (lv_waterfall_t *)obj;
 
-    lv_img_set_src(obj, waterfall->dsc);
-    lv_img_cache_invalidate_src(waterfall->dsc);
+    waterfall->x += px;
 }
 
 void lv_waterfall_clear_data(lv_obj_t * obj) {
@@ -83,34 +108,39 @@ void lv_waterfall_clear_data(lv_obj_t * obj) {
 
     lv_waterfall_t * waterfall = (lv_waterfall_t *)obj;
 
-    memset(waterfall->dsc->data, 0, waterfall->dsc->data_size);
-    lv_img_cache_invalidate_src(waterfall->dsc);
+    if (!waterfall->buf) {
+        return;
+    }
+
+    memset(waterfall->buf, 0, waterfall->w * waterfall->h * sizeof(lv_color_t));
+
+    for (uint16_t y = 0; y < waterfall->h; y++)
+        waterfall->line_x[y] = waterfall->x;
+
+    waterfall->head = 0;
 }
 
 void lv_waterfall_add_data(lv_obj_t * obj, float * data, uint16_t cnt) {
     LV_ASSERT_OBJ(obj, MY_CLASS);
 
     lv_waterfall_t  *waterfall = (lv_waterfall_t *)obj;
-    lv_img_dsc_t    *dsc = waterfall->dsc;
 
-    if (!dsc || !waterfall->palette) {
+    if (!waterfall->buf || !waterfall->palette) {
         return;
     }
 
-    uint32_t        line_len = waterfall->line_len;
-    uint8_t         *ptr = dsc->data + dsc->data_size - line_len * 2;
-    
-    /* Scroll down */
-    
-    for (uint16_t y = 0; y < dsc->header.h - 1; y++) {
-        memcpy(ptr + line_len, ptr, line_len);
-        ptr -= line_len;
-    }
+    /* New line on top */
+
+    waterfall->head = (waterfall->head + waterfall->h - 1) % waterfall->h;
+    waterfall->line_x[waterfall->head] = waterfall->x;
+
+    lv_color_t  *line = &waterfall->buf[waterfall->head * waterfall->w];
+    uint16_t    max_id = waterfall->palette_cnt - 1;
 
     /* Paint */
     
-    for (uint32_t x = 0; x < dsc->header.w; x++) {
-        uint32_t    index = x * cnt / dsc->header.w;
+    for (uint32_t x = 0; x < waterfall->w; x++) {
+        uint32_t    index = x * cnt / waterfall->w;
         float       d = data[index];
         float       v = (d - waterfall->min) / (waterfall->max - waterfall->min);
         
@@ -120,9 +150,13 @@ void lv_waterfall_add_data(lv_obj_t * obj, float * data, uint16_t cnt) {
             v = 1.0f;
         }
         
-        uint8_t id = v * 255;
+        uint16_t id = v * max_id;
         
-        lv_img_buf_set_px_color(dsc, x, 0, waterfall->palette[id]);
+        if (waterfall->mirror) {
+            line[waterfall->w - 1 - x] = waterfall->palette[id];
+        } else {
+            line[x] = waterfall->palette[id];
+        }
     }
 }
 
@@ -138,10 +172,17 @@ static void lv_waterfall_constructor(const lv_obj_class_t * class_p, lv_obj_t *
 
     waterfall->palette = NULL;
     waterfall->palette_cnt = 0;
-    waterfall->line_len = 0;
-    waterfall->line_buf = NULL;
+    waterfall->buf = NULL;
+    waterfall->w = 0;
+    waterfall->h = 0;
+    waterfall->head = 0;
+    waterfall->line_x = NULL;
+    waterfall->x = 0;
     waterfall->min = -40;
     waterfall->max = 0;
+    waterfall->mirror = false;
+
+    lv_obj_clear_flag(obj, LV_OBJ_FLAG_CLICKABLE);
     
     LV_TRACE_OBJ_CREATE("finished");
 }
@@ -151,5 +192,68 @@ static void lv_waterfall_destructor(const lv_obj_class_t * class_p, lv_obj_t * o
     lv_waterfall_t * waterfall = (lv_waterfall_t *)obj;
     
     if (waterfall->palette) lv_mem_free(waterfall->palette);
-    if (waterfall->line_buf) lv_mem_free(waterfall->line_buf);
+    if (waterfall->buf) lv_mem_free(waterfall->buf);
+    if (waterfall->line_x) lv_mem_free(waterfall->line_x);
+}
+
+/* Draw the ring as a few blits: lines continuous in memory and painted at the same position go together */
+
+static void draw_lines(lv_obj_t * obj, lv_draw_ctx_t * draw_ctx) {
+    lv_waterfall_t      *waterfall = (lv_waterfall_t *)obj;
+    lv_draw_img_dsc_t   img_dsc;
+    lv_img_dsc_t        part;
+    lv_area_t           area;
+
+    if (!waterfall->buf) {
+        return;
+    }
+
+    lv_draw_img_dsc_init(&img_dsc);
+
+    memset(&part, 0, sizeof(part));
+    part.header.cf = LV_IMG_CF_TRUE_COLOR;
+    part.header.w = waterfall->w;
+
+    uint16_t y = 0;
+
+    while (y < waterfall->h) {
+        uint16_t    line = (waterfall->head + y) % waterfall->h;
+        int32_t     line_x = waterfall->line_x[line];
+        int32_t     shift = line_x - waterfall->x;
+        uint16_t    n = 1;
+
+        while (y + n < waterfall->h && line + n < waterfall->h && waterfall->line_x[line + n] == line_x) {
+            n++;
+        }
+
+        if (LV_ABS(shift) < waterfall->w) {
+            part.header.h = n;
+            part.data_size = n * waterfall->w * sizeof(lv_color_t);
+            part.data = (const uint8_t *) &waterfall->buf[line * waterfall->w];
+
+            area.x1 = obj->coords.x1 + shift;
+            area.y1 = obj->coords.y1 + y;
+            area.x2 = area.x1 + waterfall->w - 1;
+            area.y2 = area.y1 + n - 1;
+
+            lv_draw_img(draw_ctx, &img_dsc, &area, &part);
+        }
+
+        y += n;
+    }
+}
+
+static void lv_waterfall_event(const lv_obj_class_t * class_p, lv_event_t * e) {
+    LV_UNUSED(class_p);
+
+    lv_res_t res = lv_obj_event_base(MY_CLASS, e);
+
+    if (res != LV_RES_OK) return;
+
+    lv_event_code_t code = lv_event_get_code(e);
+    lv_obj_t * obj = lv_event_get_target(e);
+
+    if (code == LV_EVENT_DRAW_MAIN) {
+        draw_lines(obj, lv_event_get_draw_ctx(e));
+    }
 }
@@ -21,18 +21,27 @@ extern "C" {
  *      TYPEDEFS
  **********************/
 
+/* Lines are kept in a ring, newest on top. Every line remembers the
+ * horizontal position it was painted at, so a frequency shift only moves
+ * the current position instead of copying the image */
+
 typedef struct {
-    lv_img_t        obj;
-    lv_img_dsc_t    *dsc;
+    lv_obj_t        obj;
+
+    lv_color_t      *buf;
+    lv_coord_t      w;
+    lv_coord_t      h;
+    uint16_t        head;
 
-    uint32_t        line_len;
-    uint8_t         *line_buf;
+    int32_t         *line_x;
+    int32_t         x;
 
     lv_color_t      *palette;
     uint16_t        palette_cnt;
     
-    int16_t         min;
-    int16_t         max;
+    float           min;
+    float           max;
+    bool            mirror;
 } lv_waterfall_t;
 
 extern const lv_obj_class_t lv_waterfall_class;
@@ -49,6 +58,10 @@ lv_obj_t * lv_waterfall_create(lv_obj_t * parent);
 
 void lv_waterfall_set_palette(lv_obj_t * obj, lv_color_t * palette, uint16_t cnt);
 void lv_waterfall_set_size(lv_obj_t * obj, lv_coord_t w, lv_coord_t h);
+void lv_waterfall_set_range(lv_obj_t * obj, float min, float max);
+void lv_waterfall_set_mirror(lv_obj_t * obj, bool on);
+
+void lv_waterfall_scroll(lv_obj_t * obj, int16_t px);
 
 void lv_waterfall_clear_data(lv_obj_t * obj);
 void lv_waterfall_add_data(lv_obj_t * obj, float * data, uint16_t cnt);